@@ -5,38 +5,37 @@
 #include <ctype.h>
 #include <time.h>
 #include <string.h>
+#include <limits.h>
 #include <mpi.h>
 #include <time.h>
 
+#include "cleText.h"
 #include "textProcessingFunctions.h"
 
 /** \brief struct to manage the variables of a chunk*/
 struct ParRes {
-    int numberOfWords;  /* Total number of words*/
-    int vowelWords[6];  /* Number of words containing each vowel (a,e,i,o,u,y) */
-    int fileID;         /* File id of the chunk */
+    long numberOfWords;  /* Total number of words*/
+    long vowelWords[6];  /* Number of words containing each vowel (a,e,i,o,u,y) */
+    int fileID;          /* File id of the chunk */
 };
 
 /** \brief worker life cycle routine */
 static void worker(int rank);
 
 /** \brief function to process each chunk */
-static void processTextChunk(unsigned char *chunk_pointer, int size, struct ParRes *partialResults);
+static void processTextChunk(struct cle_text *text, unsigned char *chunk_pointer, long size, struct ParRes *partialResults);
 
 /** \brief function created to check the next chunk of text, and returns true if it was successful */
 static bool readTextChunk(struct Chunk *chunk, struct ParRes *parRes, int workerID);
 
-/** \brief function to split the text file into chunks */
-int splitTextIntoChunks(FILE *file, char **chunks);
+/** \brief function to split the text file into chunks and send them to the workers */
+long splitTextIntoChunks(FILE *file, int fileId, int chunkSize);
 
-/** \brief function that returns the Unicode code points for the characters in the chunk */
-int f_getc(unsigned char chunk_pointer, struct State *state);
+/** \brief function to send a chunk, or a piece of one, to the next worker */
+static void sendChunk(char *chunk, long length, int fileId, bool piece);
 
-/** \brief function that check what vowel a byte is */
-char is_vowel(int c);
-
-/** \brief function to check if a byte is an alpha numeric one */
-int is_alpha_numeric(int c, bool inWord);
+/** \brief function to pick the chunk size of a file */
+static int pickChunkSize(long fileSize);
 
 /** \brief execution time measurement */
 static double get_delta_time(void);
@@ -50,8 +49,26 @@ int nProcesses;
 /** \brief work status */
 int workStatus;
 
-/** \brief number of worker threads */
-#define CHUNK_SIZE 4096
+/** \brief work status of a piece of a chunk, the chunk goes on in the next message sent to the same worker */
+#define WORK_PIECE 2
+
+/** \brief chunk size set with -c (0: picked from the size of each file) */
+int chunkSize = 0;
+
+/** \brief rank of the worker process the next chunk is sent to */
+static int nextProcess = 1;
+
+/** \brief number of chunks sent whose results were not received yet */
+static long chunksSent = 0;
+
+/** \brief smallest chunk size picked for a file */
+#define MIN_CHUNK_SIZE 4096
+
+/** \brief largest chunk size picked for a file */
+#define MAX_CHUNK_SIZE (1024 * 1024)
+
+/** \brief number of chunks of each file per worker aimed at when picking the chunk size */
+#define CHUNKS_PER_WORKER 8
 
 int main(int argc, char *argv[]) {
     int provided;
@@ -65,9 +82,11 @@ int main(int argc, char *argv[]) {
     if (rank == 0) {
         char **files = NULL;
         int nFiles = 0;
+        bool verbose = false;
+        char *suffix;
 
         int c;
-        while ((c = getopt(argc, argv, "f:h")) != -1) {
+        while ((c = getopt(argc, argv, "f:c:vh")) != -1) {
             switch (c) {
                 case 'f':
                     nFiles = argc - optind + 1;
@@ -80,11 +99,40 @@ int main(int argc, char *argv[]) {
                         files[i] = argv[optind + i - 1];
                     }
                     break;
+                case 'c': {
+                    long value = strtol(optarg, &suffix, 10);
+                    bool digits = (suffix != optarg);
+                    int shift = 0;
+
+                    if (*suffix == 'k' || *suffix == 'K') shift = 10, suffix++;
+                    else if (*suffix == 'm' || *suffix == 'M') shift = 20, suffix++;
+                    if (*suffix != '\0' || !digits) {
+                        fprintf(stderr, "%s: invalid chunk size `%s'\n", argv[0], optarg);
+                        printUsage(argv[0]);
+                        return EXIT_FAILURE;
+                    }
+                    if (value <= 0) {
+                        fprintf(stderr, "%s: non positive chunk size\n", argv[0]);
+                        printUsage(argv[0]);
+                        return EXIT_FAILURE;
+                    }
+                    /* a chunk is sent with a single MPI_Send, whose count is an int */
+                    if (value > (INT_MAX >> shift)) {
+                        fprintf(stderr, "%s: chunk size larger than %d bytes\n", argv[0], INT_MAX);
+                        printUsage(argv[0]);
+                        return EXIT_FAILURE;
+                    }
+                    chunkSize = (int) (value << shift);
+                    break;
+                }
+                case 'v':
+                    verbose = true;
+                    break;
                 case 'h':
                     printUsage(argv[0]);
                     return EXIT_SUCCESS;
                 case '?':
-                    if (optopt == 'f') {
+                    if (optopt == 'f' || optopt == 'c') {
                         fprintf(stderr, "%s: option -%c requires an argument\n", argv[0], optopt);
                     } else if (isprint(optopt)) {
                         fprintf(stderr, "%s: unknown option `-%c'\n", argv[0], optopt);
@@ -106,9 +154,6 @@ int main(int argc, char *argv[]) {
 
         (void) get_delta_time ();
 
-        int current_process = 1;  // rank of the process to assign next chunk
-        int chunks_sent = 0;      // chunks that were send by the dispatcher
-
         /* save filenames in the shared region and initialize counters to 0 */
         char *fileNames[nFiles];
         processFileName(nFiles, files, fileNames);
@@ -125,39 +170,17 @@ int main(int argc, char *argv[]) {
                 exit(EXIT_FAILURE);
             }
 
-            fseek(fp, 0, SEEK_END);
-            long file_size = ftell(fp);
+            fseeko(fp, 0, SEEK_END);
+            off_t file_size = ftello(fp);
             rewind(fp);
-            
-            char **chunks = malloc(file_size + 1); /* allocate memory for all chunks */
-            if (chunks == NULL) {
-                perror("Failed to allocate memory");
-                return 1;
-            }
-
-            int chunk_index = splitTextIntoChunks(fp, chunks);
 
-            /* save the chunks */
-            for (int j = 0; j < chunk_index; j++) {
-
-                int length = (int) strlen(chunks[j]);
-                /* send to the worker: */
-                MPI_Send(&workStatus, 1, MPI_INT, current_process, 0, MPI_COMM_WORLD); /* a flag saying if there is work to do */
-                MPI_Send(&length, 1, MPI_INT, current_process, 0, MPI_COMM_WORLD);/* the size of the chunk */
-                MPI_Send(&i, 1, MPI_INT, current_process, 0, MPI_COMM_WORLD);/* the fileID */
-                MPI_Send(chunks[j], CHUNK_SIZE, MPI_UNSIGNED_CHAR, current_process, 0, MPI_COMM_WORLD);/* the chunk buffer */
-
-                /* Update current_worker_to_receive_work and number_of_chunks_sent variables */
-                current_process = (current_process%nProcesses)+1;
-                chunks_sent++;
+            /* the chunks are sent to the workers as soon as they are cut, so only one is held at a time */
+            int size = (chunkSize > 0) ? chunkSize : pickChunkSize(file_size);
+            long chunk_index = splitTextIntoChunks(fp, i, size);
+            if (verbose) {
+                fprintf(stderr, "%s: %ld chunks, chunk size %d bytes\n", files[i], chunk_index, size);
             }
 
-            /* free memory */
-            for (int i = 0; i < chunk_index; i++) {
-                free(chunks[i]);
-            }
-            free(chunks);
-            
             fclose(fp);
         }
 
@@ -169,17 +192,18 @@ int main(int argc, char *argv[]) {
 
         free(files);
 
-        while (chunks_sent > 0){
-            for (int i = 1; i <= nProcesses && chunks_sent > 0; i++) {
-                int nWords, file, nVowels[6];
+        while (chunksSent > 0){
+            for (int i = 1; i <= nProcesses && chunksSent > 0; i++) {
+                int file;
+                long nWords, nVowels[6];
                 /* Receive the processing results from each worker process */
                 MPI_Recv(&file, 1, MPI_INT, i, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-                MPI_Recv(&nWords, 1, MPI_INT, i, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-                MPI_Recv(&nVowels, 6, MPI_INT, i, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+                MPI_Recv(&nWords, 1, MPI_LONG, i, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+                MPI_Recv(&nVowels, 6, MPI_LONG, i, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
 
                 savePartialResults(nWords, nVowels[0], nVowels[1], nVowels[2], nVowels[3], nVowels[4], nVowels[5], file);
 
-                chunks_sent--;
+                chunksSent--;
             }
         }
 
@@ -209,25 +233,35 @@ static void worker(int rank) {
 
     struct ParRes parRes;
     struct Chunk chunk;
+    struct cle_text text;
 
-    // Alocate memory to read the chunk information
-    chunk.chunk_pointer = (unsigned char*) malloc(CHUNK_SIZE);
+    // Alocate memory to read the chunk information, it grows with the chunks received
+    chunk.chunk_pointer = NULL;
+    chunk.capacity = 0;
+    cle_text_init(&text);
     
     while (readTextChunk(&chunk, &parRes, rank)){
 
+        /* the pieces of a token longer than a chunk are counted in order, the chunk that ends it is answered */
+        if (workStatus == WORK_PIECE) {
+            cle_text_feed(&text, chunk.chunk_pointer, chunk.size);
+            continue;
+        }
+
         /* perform text processing on the chunk */
-        processTextChunk(chunk.chunk_pointer, chunk.size, &parRes);
+        processTextChunk(&text, chunk.chunk_pointer, chunk.size, &parRes);
 
         /* save partial results */      
         MPI_Send(&parRes.fileID, 1, MPI_INT, 0, 0, MPI_COMM_WORLD);
-        MPI_Send(&parRes.numberOfWords, 1, MPI_INT, 0, 0, MPI_COMM_WORLD);
-        MPI_Send(&parRes.vowelWords, 6, MPI_INT, 0, 0, MPI_COMM_WORLD);
+        MPI_Send(&parRes.numberOfWords, 1, MPI_LONG, 0, 0, MPI_COMM_WORLD);
+        MPI_Send(&parRes.vowelWords, 6, MPI_LONG, 0, 0, MPI_COMM_WORLD);
 
         /* free the memory of the buffer if it was allocated */
         // free(chunk.chunk_pointer);
         // printf("free\n");
     }
-    
+    free(chunk.chunk_pointer);
+
 }
 
 /**
@@ -244,10 +278,20 @@ static bool readTextChunk(struct Chunk* chunk, struct ParRes* parRes, int worker
     /* checks if there are no more chunks to process */
     if (workStatus == 0) return false;
 
-    MPI_Recv(&chunk->size, 1, MPI_INT, 0, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    MPI_Recv(&chunk->size, 1, MPI_LONG, 0, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
     MPI_Recv(&chunk->fileId, 1, MPI_INT, 0, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
 
-    MPI_Recv(chunk->chunk_pointer, CHUNK_SIZE, MPI_UNSIGNED_CHAR, 0, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    /* the chunk size is picked for each file, grow the buffer when it is too small */
+    if (chunk->size > chunk->capacity) {
+        free(chunk->chunk_pointer);
+        if ((chunk->chunk_pointer = malloc(chunk->size)) == NULL) {
+            perror("Failed to allocate memory");
+            MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+        }
+        chunk->capacity = chunk->size;
+    }
+
+    MPI_Recv(chunk->chunk_pointer, (int) chunk->size, MPI_UNSIGNED_CHAR, 0, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
 
    /* initialize the vars in parRes*/
    parRes->fileID = chunk->fileId;
@@ -261,133 +305,140 @@ static bool readTextChunk(struct Chunk* chunk, struct ParRes* parRes, int worker
 
 /**
  *  \brief Function created to process one text chunk.
- * 
+ *
+ *  The text state holds the pieces of the chunk received before it, if any, and is started again for the next one.
+ *
+ *  \param text state of the text of the chunk
  *  \param chunk_pointer pointer to a chunk of text
  *  \param size size of the chunk
  *  \param parRes pointer to a partial results struct
  */
-static void processTextChunk(unsigned char * chunk_pointer, int size, struct ParRes * partialResults){
-
-   int words = 0; int as = 0; int es = 0; int is = 0; int os = 0; int us = 0; int ys = 0;
-   int previousVowelCheck[6] = {0,0,0,0,0,0};
-   bool inWord = false;
-   int byte;
-   char vowel;
-   struct State state = {0};
-   for (size_t i = 0; i < size; i++) {
-      unsigned char ch = chunk_pointer[i]; // read the byte at index i
-      byte = f_getc(ch, &state);
-      if (byte != -1 ){
-         if (is_alpha_numeric(byte, inWord)){
-            if (inWord == false){
-               inWord = true;
-               words++;
-            }
-            vowel = is_vowel(byte);
-            if (vowel == 'A' && previousVowelCheck[0] == 0){
-               as++;
-               previousVowelCheck[0] = 1;
-            }
-            else if (vowel == 'E' && previousVowelCheck[1] == 0){
-               es++;
-               previousVowelCheck[1] = 1;
-            }
-            else if (vowel == 'I' && previousVowelCheck[2] == 0){
-               is++;
-               previousVowelCheck[2] = 1;
-            }
-            else if (vowel == 'O' && previousVowelCheck[3] == 0){
-               os++;
-               previousVowelCheck[3] = 1;
-            }
-            else if (vowel == 'U' && previousVowelCheck[4] == 0){
-               us++;
-               previousVowelCheck[4] = 1;
-            }
-            else if (vowel == 'Y' && previousVowelCheck[5] == 0){
-               ys++;
-               previousVowelCheck[5] = 1;
-            }
-         }
-         else{
-            previousVowelCheck[0] = 0;
-            previousVowelCheck[1] = 0;
-            previousVowelCheck[2] = 0;
-            previousVowelCheck[3] = 0;
-            previousVowelCheck[4] = 0;
-            previousVowelCheck[5] = 0;
-            inWord = false;
-         }
-      }
+static void processTextChunk(struct cle_text *text, unsigned char * chunk_pointer, long size, struct ParRes * partialResults){
+
+   struct cle_text_counts counts;
+
+   cle_text_feed(text, chunk_pointer, size);
+   cle_text_finish(text, &counts);
+   cle_text_init(text);
+
+   partialResults->numberOfWords = counts.words;
+   for (int v = 0; v < 6; v++) {
+      partialResults->vowelWords[v] = counts.vowels[v];
    }
-   partialResults->numberOfWords = words;
-   partialResults->vowelWords[0] = as;
-   partialResults->vowelWords[1] = es;
-   partialResults->vowelWords[2] = is;
-   partialResults->vowelWords[3] = os;
-   partialResults->vowelWords[4] = us;
-   partialResults->vowelWords[5] = ys;
 
 }
 
 /**
- *  \brief Function created to check split the text file into several text chunks.
- * 
+ *  \brief Function created to pick the chunk size of a file.
+ *
+ *  The file is divided in about CHUNKS_PER_WORKER chunks per worker process, which balances the load on small files
+ *  and amortizes the message latency on big ones, within MIN_CHUNK_SIZE and MAX_CHUNK_SIZE.
+ *
+ *  \param fileSize number of bytes of the file
+ *
+ *  \return chunk size
+ */
+static int pickChunkSize(long fileSize) {
+   long target = fileSize / ((long) nProcesses * CHUNKS_PER_WORKER);
+   int size = MIN_CHUNK_SIZE;
+
+   while (size < target && size < MAX_CHUNK_SIZE) {
+      size <<= 1;
+   }
+   return size;
+}
+
+/**
+ *  \brief Function created to send a chunk to the next worker, in turn.
+ *
+ *  A piece of a chunk is sent to the same worker as the rest of the chunk, which answers once, after its last piece.
+ *
+ *  \param chunk pointer to the start of the chunk
+ *  \param length number of bytes of the chunk
+ *  \param fileId file identifier
+ *  \param piece flag telling if the chunk goes on in the next one sent
+ */
+static void sendChunk(char *chunk, long length, int fileId, bool piece) {
+   int status = piece ? WORK_PIECE : workStatus;
+
+   MPI_Send(&status, 1, MPI_INT, nextProcess, 0, MPI_COMM_WORLD);                      /* a flag saying if there is work to do */
+   MPI_Send(&length, 1, MPI_LONG, nextProcess, 0, MPI_COMM_WORLD);                     /* the size of the chunk */
+   MPI_Send(&fileId, 1, MPI_INT, nextProcess, 0, MPI_COMM_WORLD);                      /* the fileID */
+   MPI_Send(chunk, (int) length, MPI_UNSIGNED_CHAR, nextProcess, 0, MPI_COMM_WORLD);   /* the chunk buffer */
+
+   if (piece) return;
+   nextProcess = (nextProcess % nProcesses) + 1;
+   chunksSent++;
+}
+
+/**
+ *  \brief Function created to split the text file into several text chunks and send them to the workers.
+ *
+ *  Each chunk is read into the same buffer and sent as soon as it is cut, so the memory used does not depend on the
+ *  size of the file. A chunk ends after its last byte that can not be part of a word, and the bytes after it are
+ *  carried to the start of the next one; the last chunk takes everything left. A token that fills the whole buffer is
+ *  sent in pieces of the chunk size to the same worker, which carries the state of the text from one to the next, so
+ *  a token of any length is counted without growing the buffer.
+ *
  *  \param file pointer to a file
- *  \param chunks pointer to a pointer to a character, which represents a dynamic array of strings
+ *  \param fileId file identifier
+ *  \param chunkSize maximum number of bytes of a chunk, unless a token is longer
+ *
+ *  \return number of chunks sent
  */
-int splitTextIntoChunks(FILE *file, char **chunks) {
-   int chunk_index = 0;
-   int start_index = 0;
-   int bytes_to_read;
-
-   while (!feof(file)) {
-      /* allocate memory for each chunk separately */
-      char *buffer = malloc(CHUNK_SIZE + 1);
-      if (buffer == NULL) {
-         perror("Failed to allocate memory");
-         return -1;
-      }
-      bytes_to_read = CHUNK_SIZE - start_index;
-      int bytes_read = fread(&buffer[start_index], 1, bytes_to_read, file);
-      int num_bytes_read = start_index + bytes_read;
+long splitTextIntoChunks(FILE *file, int fileId, int chunkSize) {
+   long chunk_index = 0;
+   long capacity = chunkSize;
+   long carry_size = 0;
+   bool inToken = false;                      /* flag telling if the pieces of a token were sent, up to the buffer */
+   char *buffer = malloc(capacity);
+
+   if (buffer == NULL) {
+      perror("Failed to allocate memory");
+      MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+   }
+
+   while (true) {
+      long bytes_to_read = capacity - carry_size;
+      long bytes_read = fread(&buffer[carry_size], 1, bytes_to_read, file);
+      long num_bytes_read = carry_size + bytes_read;
 
-      if (bytes_read == 0) {
-         free(buffer);
+      /* a short read is the end of the file: the last chunk takes everything left */
+      if (bytes_read < bytes_to_read) {
+         if (num_bytes_read > 0 || inToken) {
+            sendChunk(buffer, num_bytes_read, fileId, false);
+            chunk_index++;
+         }
          break;
       }
 
-      /* find the last separator before the end of the chunk */
-      int last_separator_index = num_bytes_read - 1;
-      while (last_separator_index >= 0 && !is_separator(buffer[last_separator_index])) {
-         last_separator_index--;
+      /* find the last byte that can not be part of a word, the carried bytes have none */
+      long last_boundary_index = num_bytes_read - 1;
+      while (last_boundary_index >= carry_size && !is_boundary(buffer[last_boundary_index])) {
+         last_boundary_index--;
       }
 
-      /* if no separator was found, roll back to the previous separator and truncate the chunk */
-      if (last_separator_index < 0) {
-         fseek(file, -num_bytes_read, SEEK_CUR);
-         free(buffer);
+      /* if there is none, the buffer holds a single token: send it as a piece and keep reading */
+      if (last_boundary_index < carry_size) {
+         sendChunk(buffer, num_bytes_read, fileId, true);
+         inToken = true;
+         carry_size = 0;
          continue;
       }
 
-      /* add the chunk to the array */
-      char *chunk = malloc(last_separator_index + 2); // increase size by 1 for null terminator
-      if (chunk == NULL) {
-         perror("Failed to allocate memory");
-         free(buffer);
-         return 1;
-      }
-      memcpy(chunk, buffer, last_separator_index + 1);
-      chunk[last_separator_index + 1] = '\0';
-      chunks[chunk_index++] = chunk;
-
-      /* move the file cursor back by the number of remaining bytes */
-      int remaining_bytes = num_bytes_read - last_separator_index - 1;
-      fseek(file, -remaining_bytes, SEEK_CUR);
-      start_index = 0;
+      /* send the chunk, the buffer can be reused once it is sent */
+      sendChunk(buffer, last_boundary_index + 1, fileId, false);
+      inToken = false;
+      chunk_index++;
 
-      free(buffer);
+      /* carry the remaining bytes to the start of the next chunk */
+      carry_size = num_bytes_read - last_boundary_index - 1;
+      memmove(buffer, &buffer[last_boundary_index + 1], carry_size);
+   }
+   if (ferror(file)) {
+      perror("Failed to read the file");
    }
+   free(buffer);
 
    return chunk_index;
 }
@@ -414,6 +465,9 @@ static double get_delta_time(void)
 /* Other function implementations have been omitted for brevity. */
 
 static void printUsage(char *cmdName) {
-    fprintf(stderr, "Usage: %s -f <file1> <file2> ...\n", cmdName);
+    fprintf(stderr, "Usage: %s [-c chunk_size] [-v] -f <file1> <file2> ...\n"
+                    "  -c bytes --- set the chunk size, k/M suffixes allowed, up to 2147483647 bytes (default: picked from the size of\n"
+                    "               each file)\n"
+                    "  -v       --- print the chunk size used for each file to stderr\n", cmdName);
 }
 
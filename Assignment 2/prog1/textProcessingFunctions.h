@@ -1,36 +1,30 @@
 #ifndef TEXT_PROCESSING_FUNCTIONS_H
 #define TEXT_PROCESSING_FUNCTIONS_H
 
-extern int is_alpha_numeric(int c, bool inWord);
-
-extern char is_vowel(int c);
-
 extern int is_separator(char c);
 
+/** \brief tell if a text may be cut after the byte: an ascii byte that is neither part of a word nor an apostrophe */
+extern int is_boundary(unsigned char c);
+
 extern void processFileName(int argc, char **files, char *fileNames[]);
 
-extern void savePartialResults(int numWords, int as, int es, int is, int os, int us, int ys, int fileID);
+extern void savePartialResults(long numWords, long as, long es, long is, long os, long us, long ys, int fileID);
 
 extern void printResults();
 
 /** \brief struct to store the information of one chunk*/
 struct Chunk {
    int fileId;        /* file identifier */  
-   int size;    /* Number of bytes of the chunk */
+   long size;         /* Number of bytes of the chunk */
+   long capacity;     /* Number of bytes allocated for the chunk */
    unsigned char * chunk_pointer;  /* Pointer to the start of the chunk */
 } Chunk;
 
 /** \brief struct to store the counters of a file */
 struct FileCounters {
    char* file_name;                                   /* file name */  
-   int total_num_of_words;                            /* Number of total words */
-   int count_total_vowels[6];                         /* Number of words containing each vowel (a,e,i,o,u,y) */
+   long total_num_of_words;                           /* Number of total words */
+   long count_total_vowels[6];                        /* Number of words containing each vowel (a,e,i,o,u,y) */
 } FileCounters;
 
-extern struct State{
-    unsigned char buffer[4];
-    int buffer_pos;
-    int bytes_remaining;
-} State;
-
 #endif
\ No newline at end of file
@@ -0,0 +1,279 @@
+/**
+ *  \file asyncReader.c (implementation file)
+ *
+ *  \brief Problem name: Count Words.
+ *
+ *  Asynchronous reader (see asyncReader.h).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+#include "asyncReader.h"
+
+/** \brief maximum number of threads of the pread engine */
+#define MAX_READ_THREADS 16
+
+/** \brief engine in use */
+static enum ReaderEngine engineInUse;
+
+/** \brief io_uring file descriptor */
+static int ringFd = -1;
+
+/** \brief mappings of the io_uring */
+static void *sqMap, *cqMap;
+static size_t sqMapSize, cqMapSize;
+static struct io_uring_sqe *sqes;
+static size_t sqesSize;
+
+/** \brief fields of the submission queue */
+static _Atomic unsigned int *sqTail;
+static unsigned int *sqMask, *sqArray;
+
+/** \brief fields of the completion queue */
+static _Atomic unsigned int *cqHead, *cqTail;
+static unsigned int *cqMask;
+static struct io_uring_cqe *cqes;
+
+/** \brief number of submission queue entries filled and not yet handed to the kernel */
+static unsigned int toSubmit;
+
+/** \brief threads of the pread engine */
+static pthread_t readThreads[MAX_READ_THREADS];
+static int nReadThreads;
+
+/** \brief locking flag which warrants mutual exclusion on the request queues of the pread engine */
+static pthread_mutex_t accessQueues = PTHREAD_MUTEX_INITIALIZER;
+
+/** \brief synchronization points of the pread engine */
+static pthread_cond_t requestQueued = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t requestDone = PTHREAD_COND_INITIALIZER;
+
+/** \brief pending and completed requests of the pread engine (lists, in no particular order) */
+static struct ReadRequest *pending, *completed;
+
+/** \brief flag telling the threads of the pread engine to terminate */
+static bool stopping;
+
+/**
+ *  \brief Set up an io_uring.
+ *
+ *  \return 0 on success, -1 if io_uring is not available
+ */
+static int uringInit(unsigned int depth){
+   struct io_uring_params p;
+
+   memset(&p, 0, sizeof(p));
+   if ((ringFd = syscall(__NR_io_uring_setup, depth, &p)) < 0) return -1;
+
+   sqMapSize = p.sq_off.array + p.sq_entries * sizeof(unsigned int);
+   cqMapSize = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+   if (p.features & IORING_FEAT_SINGLE_MMAP) {
+      if (cqMapSize > sqMapSize) sqMapSize = cqMapSize;
+      cqMapSize = sqMapSize;
+   }
+   sqMap = mmap(NULL, sqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+   if (sqMap == MAP_FAILED) goto fail;
+   if (p.features & IORING_FEAT_SINGLE_MMAP) cqMap = sqMap;
+   else {
+      cqMap = mmap(NULL, cqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_CQ_RING);
+      if (cqMap == MAP_FAILED) goto fail;
+   }
+   sqesSize = p.sq_entries * sizeof(struct io_uring_sqe);
+   sqes = mmap(NULL, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES);
+   if (sqes == MAP_FAILED) goto fail;
+
+   sqTail = (_Atomic unsigned int *) ((char *) sqMap + p.sq_off.tail);
+   sqMask = (unsigned int *) ((char *) sqMap + p.sq_off.ring_mask);
+   sqArray = (unsigned int *) ((char *) sqMap + p.sq_off.array);
+   cqHead = (_Atomic unsigned int *) ((char *) cqMap + p.cq_off.head);
+   cqTail = (_Atomic unsigned int *) ((char *) cqMap + p.cq_off.tail);
+   cqMask = (unsigned int *) ((char *) cqMap + p.cq_off.ring_mask);
+   cqes = (struct io_uring_cqe *) ((char *) cqMap + p.cq_off.cqes);
+   toSubmit = 0;
+   return 0;
+
+fail:
+   close(ringFd);
+   ringFd = -1;
+   return -1;
+}
+
+/**
+ *  \brief Life cycle of a thread of the pread engine: serves pending requests until the reader is torn down.
+ */
+static void *readThread(void *par){
+   (void) par;
+
+   pthread_mutex_lock(&accessQueues);
+   for (;;) {
+      while (pending == NULL && !stopping) pthread_cond_wait(&requestQueued, &accessQueues);
+      if (pending == NULL) break;
+
+      struct ReadRequest *request = pending;
+      pending = request->next;
+      pthread_mutex_unlock(&accessQueues);
+
+      long done = 0;
+      while (done < request->length) {
+         ssize_t n = pread(request->fd, request->buffer + done, request->length - done, request->offset + done);
+         if (n < 0 && errno == EINTR) continue;
+         if (n < 0) {
+            done = -errno;
+            break;
+         }
+         if (n == 0) break;
+         done += n;
+      }
+      request->result = done;
+
+      pthread_mutex_lock(&accessQueues);
+      request->next = completed;
+      completed = request;
+      pthread_cond_signal(&requestDone);
+   }
+   pthread_mutex_unlock(&accessQueues);
+   return NULL;
+}
+
+/**
+ *  \brief Set up the reader.
+ *
+ *  \param engine engine to be used (READER_AUTO tries io_uring first)
+ *  \param depth maximum number of reads in flight
+ *
+ *  \return 0 on success, -1 if the engine could not be set up
+ */
+int readerInit(enum ReaderEngine engine, unsigned int depth){
+   if (engine != READER_PREAD && uringInit(depth) == 0) {
+      engineInUse = READER_URING;
+      return 0;
+   }
+   if (engine == READER_URING) return -1;
+
+   engineInUse = READER_PREAD;
+   pending = completed = NULL;
+   stopping = false;
+   nReadThreads = (depth < MAX_READ_THREADS) ? depth : MAX_READ_THREADS;
+   for (int i = 0; i < nReadThreads; i++) {
+      if (pthread_create(&readThreads[i], NULL, readThread, NULL) != 0) {
+         nReadThreads = i;
+         readerDestroy();
+         return -1;
+      }
+   }
+   return 0;
+}
+
+/**
+ *  \brief Submit a read.
+ *
+ *  With io_uring the request is only queued; it is handed to the kernel by the next readerWait, together with the
+ *  other requests submitted in between.
+ *
+ *  \param request read to be done
+ */
+void readerSubmit(struct ReadRequest *request){
+   if (engineInUse == READER_URING) {
+      unsigned int tail = atomic_load_explicit(sqTail, memory_order_relaxed);
+      unsigned int index = tail & *sqMask;
+      struct io_uring_sqe *sqe = &sqes[index];
+
+      memset(sqe, 0, sizeof(*sqe));
+      sqe->opcode = IORING_OP_READ;
+      sqe->fd = request->fd;
+      sqe->addr = (uintptr_t) request->buffer;
+      sqe->len = request->length;
+      sqe->off = request->offset;
+      sqe->user_data = (uintptr_t) request;
+      sqArray[index] = index;
+      atomic_store_explicit(sqTail, tail + 1, memory_order_release);
+      toSubmit++;
+      return;
+   }
+
+   pthread_mutex_lock(&accessQueues);
+   request->next = pending;
+   pending = request;
+   pthread_cond_signal(&requestQueued);
+   pthread_mutex_unlock(&accessQueues);
+}
+
+/**
+ *  \brief Wait for a read to complete.
+ *
+ *  \return the completed request, with its result set
+ */
+struct ReadRequest *readerWait(void){
+   struct ReadRequest *request;
+
+   if (engineInUse == READER_URING) {
+      unsigned int head = atomic_load_explicit(cqHead, memory_order_relaxed);
+
+      while (toSubmit > 0 || head == atomic_load_explicit(cqTail, memory_order_acquire)) {
+         unsigned int flags = (head == atomic_load_explicit(cqTail, memory_order_acquire)) ? IORING_ENTER_GETEVENTS : 0;
+         long n = syscall(__NR_io_uring_enter, ringFd, toSubmit, (flags != 0) ? 1 : 0, flags, NULL, 0);
+
+         if (n < 0) {
+            if (errno == EINTR) continue;
+            perror("io_uring_enter");
+            exit(EXIT_FAILURE);
+         }
+         toSubmit -= (toSubmit < (unsigned int) n) ? toSubmit : (unsigned int) n;
+      }
+
+      struct io_uring_cqe *cqe = &cqes[head & *cqMask];
+      request = (struct ReadRequest *) (uintptr_t) cqe->user_data;
+      request->result = cqe->res;
+      atomic_store_explicit(cqHead, head + 1, memory_order_release);
+      return request;
+   }
+
+   pthread_mutex_lock(&accessQueues);
+   while (completed == NULL) pthread_cond_wait(&requestDone, &accessQueues);
+   request = completed;
+   completed = request->next;
+   pthread_mutex_unlock(&accessQueues);
+   return request;
+}
+
+/**
+ *  \brief Get the name of the engine in use.
+ */
+const char *readerEngine(void){
+   return (engineInUse == READER_URING) ? "io_uring" : "pread threads";
+}
+
+/**
+ *  \brief Tear down the reader.
+ *
+ *  Must only be called when no read is in flight.
+ */
+void readerDestroy(void){
+   if (engineInUse == READER_URING) {
+      munmap(sqes, sqesSize);
+      if (cqMap != sqMap) munmap(cqMap, cqMapSize);
+      munmap(sqMap, sqMapSize);
+      close(ringFd);
+      ringFd = -1;
+      return;
+   }
+
+   pthread_mutex_lock(&accessQueues);
+   stopping = true;
+   pthread_cond_broadcast(&requestQueued);
+   pthread_mutex_unlock(&accessQueues);
+   for (int i = 0; i < nReadThreads; i++) {
+      pthread_join(readThreads[i], NULL);
+   }
+   nReadThreads = 0;
+}
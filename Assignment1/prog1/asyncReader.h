@@ -0,0 +1,57 @@
+/**
+ *  \file asyncReader.h (interface file)
+ *
+ *  \brief Problem name: Count Words.
+ *
+ *  Asynchronous reader: keeps several reads of several files in flight.
+ *
+ *  The reads are submitted to an io_uring (set up with raw system calls) or, when io_uring is not available or a
+ *  pread engine is requested, to a pool of threads calling pread. Completions are returned in the order they finish.
+ *  Only one thread submits and collects the reads.
+ *
+ *  Definition of the operations:
+ *     \li readerInit
+ *     \li readerSubmit
+ *     \li readerWait
+ *     \li readerEngine
+ *     \li readerDestroy
+ */
+
+#ifndef ASYNC_READER_H
+#define ASYNC_READER_H
+
+#include <stdbool.h>
+
+/** \brief engines of the asynchronous reader */
+enum ReaderEngine {
+   READER_AUTO,        /* io_uring when available, pread threads otherwise */
+   READER_URING,       /* io_uring */
+   READER_PREAD        /* pool of threads calling pread */
+};
+
+/** \brief one read */
+struct ReadRequest {
+   int fd;                       /* file descriptor */
+   long offset;                  /* offset in the file */
+   unsigned char *buffer;        /* where the bytes are stored */
+   long length;                  /* number of bytes to read */
+   long result;                  /* number of bytes read, or -errno (set on completion) */
+   struct ReadRequest *next;     /* link of the request queues of the pread engine */
+};
+
+/** \brief set up the reader for at most depth reads in flight, returns 0 on success */
+extern int readerInit(enum ReaderEngine engine, unsigned int depth);
+
+/** \brief submit a read (at most depth reads may be in flight) */
+extern void readerSubmit(struct ReadRequest *request);
+
+/** \brief wait for a read to complete */
+extern struct ReadRequest *readerWait(void);
+
+/** \brief name of the engine in use */
+extern const char *readerEngine(void);
+
+/** \brief tear down the reader, once no read is in flight */
+extern void readerDestroy(void);
+
+#endif /* ASYNC_READER_H */
@@ -0,0 +1,243 @@
+/**
+ *  \file chunkDeque.c (implementation file)
+ *
+ *  \brief Problem name: Count Words.
+ *
+ *  Work-stealing scheduler of chunks (see chunkDeque.h).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <limits.h>
+
+#include "chunkDeque.h"
+#include "spinWait.h"
+
+/**
+ *  \brief Initialize the deques.
+ *
+ *  \param sched scheduler to be initialized
+ *  \param nWorkers number of workers (and of deques)
+ *  \param capacity minimum number of slots of each deque (rounded up to a power of two)
+ *
+ *  \return 0 on success, -1 if the memory could not be allocated
+ */
+int stealInit(struct StealScheduler *sched, unsigned int nWorkers, unsigned int capacity){
+   long size = 2;
+
+   while (size < capacity) size <<= 1;
+
+   if ((sched->deques = aligned_alloc(64, nWorkers * sizeof(struct ChunkDeque))) == NULL) return -1;
+   for (unsigned int i = 0; i < nWorkers; i++) {
+      struct ChunkDeque *deque = &sched->deques[i];
+
+      if ((deque->cells = malloc(size * sizeof(struct Chunk))) == NULL) {
+         while (i-- > 0) free(sched->deques[i].cells);
+         free(sched->deques);
+         return -1;
+      }
+      deque->mask = size - 1;
+      atomic_init(&deque->top, 0);
+      atomic_init(&deque->bottom, 0);
+   }
+   sched->nDeques = nWorkers;
+   sched->target = 0;
+   sched->batchLeft = STEAL_BATCH;
+   sched->endTarget = 0;
+   sched->spinLimit = spinLimit();
+   atomic_init(&sched->notEmpty, 0);
+   atomic_init(&sched->emptyWaiters, 0);
+   atomic_init(&sched->notFull, 0);
+   atomic_init(&sched->fullWaiters, 0);
+   atomic_init(&sched->stolen, 0);
+
+   return 0;
+}
+
+/**
+ *  \brief Try to push a chunk at the bottom of a deque, without waiting.
+ *
+ *  Only the producer pushes, so the bottom is never written concurrently.
+ *
+ *  \return true if the chunk was stored, false if the deque is full
+ */
+static bool tryPush(struct ChunkDeque *deque, const struct Chunk *chunk){
+   long b = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+   long t = atomic_load_explicit(&deque->top, memory_order_acquire);
+
+   if (b - t > deque->mask) return false;
+
+   deque->cells[b & deque->mask] = *chunk;
+   atomic_thread_fence(memory_order_release);                  /* the chunk is visible before the new bottom */
+   atomic_store_explicit(&deque->bottom, b + 1, memory_order_relaxed);
+   return true;
+}
+
+/**
+ *  \brief Tell if a chunk is the end chunk of a worker.
+ */
+static bool isEndChunk(const struct Chunk *chunk){
+   return chunk->chunk_pointer == NULL && chunk->fileId == -1;
+}
+
+/**
+ *  \brief Try to take a chunk from the top of a deque, without waiting.
+ *
+ *  \param takeEnd whether the end chunk of the deque may be taken (only by its owner)
+ *
+ *  \return true if a chunk was taken, false if the deque is empty or its top is an end chunk that may not be taken
+ */
+static bool trySteal(struct ChunkDeque *deque, struct Chunk *chunk, bool takeEnd){
+   for (;;) {
+      long t = atomic_load_explicit(&deque->top, memory_order_acquire);
+      atomic_thread_fence(memory_order_seq_cst);
+      long b = atomic_load_explicit(&deque->bottom, memory_order_acquire);
+
+      if (t >= b) return false;
+
+      *chunk = deque->cells[t & deque->mask];
+      if (!takeEnd && isEndChunk(chunk)) return false;
+      if (atomic_compare_exchange_strong_explicit(&deque->top, &t, t + 1, memory_order_seq_cst, memory_order_relaxed)) {
+         return true;
+      }
+      /* another worker took it first, try the next one */
+   }
+}
+
+/**
+ *  \brief Try to push a chunk to the deque being filled, moving on to the next deques when it is full.
+ *
+ *  \return true if the chunk was stored, false if every deque is full
+ */
+static bool tryPushAny(struct StealScheduler *sched, const struct Chunk *chunk){
+   for (unsigned int n = 0; n < sched->nDeques; n++) {
+      if (tryPush(&sched->deques[sched->target], chunk)) {
+         if (--sched->batchLeft == 0) {                           /* batch done, fill the next deque */
+            sched->target = (sched->target + 1) % sched->nDeques;
+            sched->batchLeft = STEAL_BATCH;
+         }
+         return true;
+      }
+      sched->target = (sched->target + 1) % sched->nDeques;
+      sched->batchLeft = STEAL_BATCH;
+   }
+   return false;
+}
+
+/**
+ *  \brief Try to take a chunk from the deque of the worker or, when it is empty, from the deques of the others.
+ *
+ *  The end chunks of the others are left alone, and the worker takes its own only when there is nothing to steal.
+ *
+ *  \return true if a chunk was taken, false if there is none the worker may take
+ */
+static bool tryPopAny(struct StealScheduler *sched, unsigned int workerId, struct Chunk *chunk){
+   if (trySteal(&sched->deques[workerId], chunk, false)) return true;
+
+   for (unsigned int n = 1; n < sched->nDeques; n++) {
+      if (trySteal(&sched->deques[(workerId + n) % sched->nDeques], chunk, false)) {
+         atomic_fetch_add_explicit(&sched->stolen, 1, memory_order_relaxed);
+         return true;
+      }
+   }
+   return trySteal(&sched->deques[workerId], chunk, true);
+}
+
+/**
+ *  \brief Try to push a chunk to the deque of its worker (an end chunk) or to any deque (the other chunks).
+ *
+ *  \return true if the chunk was stored, false if the deque (or every deque) is full
+ */
+static bool tryPushChunk(struct StealScheduler *sched, const struct Chunk *chunk){
+   if (!isEndChunk(chunk)) return tryPushAny(sched, chunk);
+   if (!tryPush(&sched->deques[sched->endTarget], chunk)) return false;
+   sched->endTarget = (sched->endTarget + 1) % sched->nDeques;
+   return true;
+}
+
+/**
+ *  \brief Store a chunk in the deques.
+ *
+ *  Operation carried out by the producer. Spins and then sleeps while the chunk can not be stored: every deque is full
+ *  or, for an end chunk, the deque of its worker.
+ *
+ *  \param sched scheduler
+ *  \param chunk chunk to be stored
+ */
+void stealPush(struct StealScheduler *sched, struct Chunk chunk){
+   int spins = 0;
+
+   while (!tryPushChunk(sched, &chunk)) {
+      if (spins++ < sched->spinLimit) {
+         cpuRelax();
+         continue;
+      }
+
+      /* announce the wait and check again, so a retrieval done in between is not missed */
+      unsigned int seen = atomic_load(&sched->notFull);
+      atomic_fetch_add(&sched->fullWaiters, 1);
+      if (tryPushChunk(sched, &chunk)) {
+         atomic_fetch_sub(&sched->fullWaiters, 1);
+         break;
+      }
+      futexWait(&sched->notFull, seen);
+      atomic_fetch_sub(&sched->fullWaiters, 1);
+   }
+
+   /* let a worker know that a chunk has been stored, all of them for an end chunk, since only its owner may take it */
+   atomic_fetch_add(&sched->notEmpty, 1);
+   if (atomic_load(&sched->emptyWaiters) > 0) futexWake(&sched->notEmpty, isEndChunk(&chunk) ? INT_MAX : 1);
+}
+
+/**
+ *  \brief Retrieve a chunk for a worker.
+ *
+ *  Operation carried out by the workers. Spins and then sleeps while there is no chunk it may take.
+ *
+ *  \param sched scheduler
+ *  \param workerId worker identification
+ *
+ *  \return chunk
+ */
+struct Chunk stealPop(struct StealScheduler *sched, unsigned int workerId){
+   struct Chunk chunk;
+   int spins = 0;
+
+   while (!tryPopAny(sched, workerId, &chunk)) {
+      if (spins++ < sched->spinLimit) {
+         cpuRelax();
+         continue;
+      }
+
+      /* announce the wait and check again, so an insertion done in between is not missed */
+      unsigned int seen = atomic_load(&sched->notEmpty);
+      atomic_fetch_add(&sched->emptyWaiters, 1);
+      if (tryPopAny(sched, workerId, &chunk)) {
+         atomic_fetch_sub(&sched->emptyWaiters, 1);
+         break;
+      }
+      futexWait(&sched->notEmpty, seen);
+      atomic_fetch_sub(&sched->emptyWaiters, 1);
+   }
+
+   /* let the producer know that a slot has been freed */
+   atomic_fetch_add(&sched->notFull, 1);
+   if (atomic_load(&sched->fullWaiters) > 0) futexWake(&sched->notFull, 1);
+
+   return chunk;
+}
+
+/**
+ *  \brief Release the memory of the deques.
+ *
+ *  \param sched scheduler
+ */
+void stealDestroy(struct StealScheduler *sched){
+   for (unsigned int i = 0; i < sched->nDeques; i++) {
+      free(sched->deques[i].cells);
+   }
+   free(sched->deques);
+   sched->deques = NULL;
+   sched->nDeques = 0;
+}
@@ -0,0 +1,72 @@
+/**
+ *  \file chunkDeque.h (interface file)
+ *
+ *  \brief Problem name: Count Words.
+ *
+ *  Work-stealing scheduler of chunks: one Chase-Lev deque per worker.
+ *
+ *  The producer fills the deques in batches, one deque after the other, pushing at the bottom. A worker takes the
+ *  chunks of its own deque from the top and, when it is empty, steals from the top of the deques of the other workers,
+ *  so no worker stays idle while chunks are waiting anywhere. Since only the producer pushes and every worker takes
+ *  from the top with a compare-and-swap, the owner pop at the bottom of the original algorithm is not needed and the
+ *  chunks of each deque keep their order. A worker that finds every deque empty (or the producer that finds every deque
+ *  full) spins for a while and then sleeps on a futex.
+ *
+ *  The end chunks are not spread in batches: the n-th one goes to the deque of worker n, after the chunks already in
+ *  it, and is never stolen. A worker takes its end chunk only when it finds nothing to steal, and stops on it, so the
+ *  chunks of its deque are always taken before (by itself or by a thief) and no chunk is left behind when a worker
+ *  stops before the producer is done with the other deques.
+ *
+ *  Definition of the operations:
+ *     \li stealInit
+ *     \li stealPush
+ *     \li stealPop
+ *     \li stealDestroy
+ */
+
+#ifndef CHUNK_DEQUE_H
+#define CHUNK_DEQUE_H
+
+#include <stdatomic.h>
+
+#include "sharedRegion.h"
+
+/** \brief number of chunks pushed to a deque before the producer moves to the next one */
+#define STEAL_BATCH 4
+
+/** \brief bounded Chase-Lev deque of chunks */
+struct ChunkDeque {
+   _Alignas(64) atomic_long top;               /* retrieval position, advanced by the workers */
+   _Alignas(64) atomic_long bottom;            /* insertion position, advanced by the producer */
+   long mask;                                  /* capacity - 1 (the capacity is a power of two) */
+   struct Chunk *cells;                        /* slots */
+};
+
+/** \brief deques of all workers */
+struct StealScheduler {
+   struct ChunkDeque *deques;                  /* one deque per worker */
+   unsigned int nDeques;                       /* number of deques */
+   unsigned int target;                        /* deque being filled by the producer */
+   unsigned int batchLeft;                     /* chunks still to be pushed to target in the current batch */
+   unsigned int endTarget;                     /* deque of the next end chunk */
+   _Alignas(64) atomic_uint notEmpty;          /* futex word, bumped after every insertion */
+   atomic_uint emptyWaiters;                   /* number of workers sleeping (or about to) on notEmpty */
+   _Alignas(64) atomic_uint notFull;           /* futex word, bumped after every retrieval */
+   atomic_uint fullWaiters;                    /* number of producers sleeping (or about to) on notFull */
+   _Alignas(64) atomic_ulong stolen;           /* number of chunks taken from the deque of another worker */
+   int spinLimit;                              /* failed attempts before sleeping (0 on a single processor) */
+};
+
+/** \brief initialize nWorkers deques with at least capacity slots each, returns 0 on success */
+extern int stealInit(struct StealScheduler *sched, unsigned int nWorkers, unsigned int capacity);
+
+/** \brief store a chunk (an end chunk in the deque of the next worker), waiting while it can not be stored (only one producer) */
+extern void stealPush(struct StealScheduler *sched, struct Chunk chunk);
+
+/** \brief retrieve a chunk for a worker, from its own deque or stolen from another one (never an end chunk), waiting while there is none */
+extern struct Chunk stealPop(struct StealScheduler *sched, unsigned int workerId);
+
+/** \brief release the memory of the deques */
+extern void stealDestroy(struct StealScheduler *sched);
+
+#endif /* CHUNK_DEQUE_H */
@@ -0,0 +1,247 @@
+/**
+ *  \file chunkPool.c (implementation file)
+ *
+ *  \brief Problem name: Count Words.
+ *
+ *  Pool of recycled chunk buffers (see chunkPool.h).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "chunkPool.h"
+
+/** \brief free buffers kept by a thread */
+struct PoolCache {
+   bool takes;                              /* the thread takes buffers, not only gives them back */
+   unsigned int count;                      /* number of buffers in the cache */
+   unsigned char *buffers[POOL_CACHE];      /* free buffers */
+};
+
+/** \brief cache of the calling thread */
+static _Thread_local struct PoolCache cache;
+
+/** \brief locking flag which warrants mutual exclusion on the shared free list */
+static pthread_mutex_t accessPool = PTHREAD_MUTEX_INITIALIZER;
+
+/** \brief synchronization point when the pool is exhausted */
+static pthread_cond_t bufferReturned = PTHREAD_COND_INITIALIZER;
+
+/** \brief memory from which the buffers are carved */
+static unsigned char *slab = NULL;
+
+/** \brief number of buffers the slab can hold */
+static unsigned int nBuffers = 0;
+
+/** \brief number of buffers carved from the slab (they are at its start) */
+static unsigned int nCarved = 0;
+
+/** \brief number of bytes of each buffer */
+static unsigned int bufferSize = 0;
+
+/** \brief shared free list (used as a stack) */
+static unsigned char **freeList = NULL;
+
+/** \brief number of buffers in the shared free list */
+static unsigned int nFree = 0;
+
+/** \brief number of threads waiting for a buffer */
+static unsigned int nWaiting = 0;
+
+/** \brief number of buffers taken and not yet given back */
+static atomic_uint inUse;
+
+/** \brief maximum value reached by inUse */
+static atomic_uint highWater;
+
+/** \brief number of buffers taken */
+static atomic_ulong takes;
+
+/** \brief number of cache refills */
+static atomic_ulong refills;
+
+/** \brief number of waits for a buffer */
+static atomic_ulong waits;
+
+/**
+ *  \brief Lock the shared free list, terminating the thread on failure.
+ */
+static void lockPool(void){
+   int status;
+
+   if ((status = pthread_mutex_lock(&accessPool)) != 0) {
+      errno = status;                                                                  /* save error in errno */
+      perror("error on entering monitor(POOL)");
+      pthread_exit(NULL);
+   }
+}
+
+/**
+ *  \brief Unlock the shared free list, terminating the thread on failure.
+ */
+static void unlockPool(void){
+   int status;
+
+   if ((status = pthread_mutex_unlock(&accessPool)) != 0) {
+      errno = status;                                                                  /* save error in errno */
+      perror("error on exiting monitor(POOL)");
+      pthread_exit(NULL);
+   }
+}
+
+/**
+ *  \brief Initialize the pool.
+ *
+ *  The slab is only reserved: its pages are touched as the buffers are carved, when the pool runs out of free ones.
+ *
+ *  \param buffers maximum number of buffers
+ *  \param size number of bytes of each buffer
+ *
+ *  \return 0 on success, -1 if the memory could not be allocated
+ */
+int poolInit(unsigned int buffers, unsigned int size){
+   if ((slab = malloc((size_t) buffers * size)) == NULL) return -1;
+   if ((freeList = malloc(buffers * sizeof(unsigned char *))) == NULL) {
+      free(slab);
+      slab = NULL;
+      return -1;
+   }
+
+   nBuffers = buffers;
+   bufferSize = size;
+   nCarved = 0;
+   nFree = 0;
+   atomic_init(&inUse, 0);
+   atomic_init(&highWater, 0);
+   atomic_init(&takes, 0);
+   atomic_init(&refills, 0);
+   atomic_init(&waits, 0);
+   return 0;
+}
+
+/**
+ *  \brief Take a buffer.
+ *
+ *  The buffer comes from the cache of the calling thread; when it is empty, half a cache is moved from the shared
+ *  free list. When the list is empty a new buffer is carved from the slab, and once the slab is used up the thread
+ *  waits for a buffer to be given back.
+ *
+ *  \return buffer of bufferSize bytes
+ */
+unsigned char *poolTake(void){
+   if (cache.count == 0) {
+      lockPool();
+      cache.takes = true;
+      if (nFree == 0 && nCarved < nBuffers) {                                   /* no free buffer, carve a new one */
+         cache.buffers[cache.count++] = slab + (size_t) nCarved++ * bufferSize;
+      }
+      while (nFree == 0 && cache.count == 0) {                                   /* wait for buffers to be given back */
+         int status;
+
+         atomic_fetch_add_explicit(&waits, 1, memory_order_relaxed);
+         nWaiting++;
+         if ((status = pthread_cond_wait(&bufferReturned, &accessPool)) != 0) {
+            errno = status;                                                            /* save error in errno */
+            perror("error on waiting in bufferReturned");
+            pthread_exit(NULL);
+         }
+         nWaiting--;
+      }
+      while (nFree > 0 && cache.count < POOL_CACHE / 2) {
+         cache.buffers[cache.count++] = freeList[--nFree];
+      }
+      unlockPool();
+      atomic_fetch_add_explicit(&refills, 1, memory_order_relaxed);
+   }
+
+   unsigned int used = atomic_fetch_add_explicit(&inUse, 1, memory_order_relaxed) + 1;
+   unsigned int high = atomic_load_explicit(&highWater, memory_order_relaxed);
+   while (used > high && !atomic_compare_exchange_weak_explicit(&highWater, &high, used,
+                                                                memory_order_relaxed, memory_order_relaxed)) {
+   }
+   atomic_fetch_add_explicit(&takes, 1, memory_order_relaxed);
+
+   return cache.buffers[--cache.count];
+}
+
+/**
+ *  \brief Give a buffer back.
+ *
+ *  The buffer goes to the cache of the calling thread; when it is full, half of it is moved to the shared free list.
+ *  A thread that never takes buffers moves the whole cache once it holds half a cache, since it has no use for them,
+ *  and if some thread is waiting for a buffer the whole cache is moved at once, so buffers are never hoarded by a
+ *  thread while another one starves or a new one is carved.
+ *
+ *  \param buffer buffer taken from the pool, or a pointer inside it
+ */
+void poolGive(unsigned char *buffer){
+   buffer = slab + (size_t) (buffer - slab) / bufferSize * bufferSize;       /* start of the buffer */
+   atomic_fetch_sub_explicit(&inUse, 1, memory_order_relaxed);
+   cache.buffers[cache.count++] = buffer;
+
+   if (cache.count == (cache.takes ? POOL_CACHE : POOL_CACHE / 2) || __atomic_load_n(&nWaiting, __ATOMIC_RELAXED) > 0) {
+      int status;
+
+      lockPool();
+      unsigned int keep = (nWaiting > 0 || !cache.takes) ? 0 : POOL_CACHE / 2;
+      while (cache.count > keep) {
+         freeList[nFree++] = cache.buffers[--cache.count];
+      }
+      if (nWaiting > 0 && (status = pthread_cond_broadcast(&bufferReturned)) != 0) {
+         errno = status;                                                               /* save error in errno */
+         perror("error on signaling in bufferReturned");
+         pthread_exit(NULL);
+      }
+      unlockPool();
+   }
+}
+
+/**
+ *  \brief Tell if a buffer belongs to the pool.
+ *
+ *  \param buffer pointer to a buffer, or inside it
+ *
+ *  \return true if the buffer was carved from the slab of the pool
+ */
+bool poolOwns(const unsigned char *buffer){
+   return slab != NULL && buffer >= slab && buffer < slab + (size_t) nBuffers * bufferSize;
+}
+
+/**
+ *  \brief Get the number of bytes of each buffer of the pool.
+ */
+unsigned int poolBufferSize(void){
+   return bufferSize;
+}
+
+/**
+ *  \brief Get the statistics of the pool.
+ *
+ *  \param stats where to store the statistics
+ */
+void poolGetStats(struct PoolStats *stats){
+   stats->buffers = nBuffers;
+   stats->carved = nCarved;
+   stats->bufferSize = bufferSize;
+   stats->highWater = atomic_load(&highWater);
+   stats->takes = atomic_load(&takes);
+   stats->refills = atomic_load(&refills);
+   stats->waits = atomic_load(&waits);
+}
+
+/**
+ *  \brief Release the memory of the pool.
+ *
+ *  Must only be called when no buffer is in use and no other thread will use the pool again.
+ */
+void poolDestroy(void){
+   free(freeList);
+   free(slab);
+   freeList = NULL;
+   slab = NULL;
+   nBuffers = nCarved = nFree = 0;
+   cache.count = 0;
+}
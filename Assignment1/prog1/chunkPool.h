@@ -0,0 +1,65 @@
+/**
+ *  \file chunkPool.h (interface file)
+ *
+ *  \brief Problem name: Count Words.
+ *
+ *  Pool of recycled chunk buffers.
+ *
+ *  The buffers are carved from a single slab, one at a time and only when no free buffer is left, so the memory
+ *  touched follows the buffers the work actually holds at the same time, not the size of the slab. Each thread keeps
+ *  a small cache of free buffers, so taking and giving back a buffer takes no lock in the common case; the shared free
+ *  list is only locked to move half a cache at a time (a thread that only gives buffers back moves all of them, in
+ *  smaller batches, so it keeps none). A thread that finds the pool exhausted waits until another thread gives buffers
+ *  back.
+ *
+ *  Definition of the operations:
+ *     \li poolInit
+ *     \li poolTake
+ *     \li poolGive
+ *     \li poolOwns
+ *     \li poolBufferSize
+ *     \li poolGetStats
+ *     \li poolDestroy
+ */
+
+#ifndef CHUNK_POOL_H
+#define CHUNK_POOL_H
+
+#include <stdbool.h>
+
+/** \brief number of free buffers each thread may keep in its cache */
+#define POOL_CACHE 8
+
+/** \brief statistics of the pool */
+struct PoolStats {
+   unsigned int buffers;             /* number of buffers the slab can hold */
+   unsigned int carved;              /* number of buffers carved from the slab */
+   unsigned int bufferSize;          /* number of bytes of each buffer */
+   unsigned int highWater;           /* maximum number of buffers taken at the same time */
+   unsigned long takes;              /* number of buffers taken */
+   unsigned long refills;            /* number of times a cache was refilled from the shared free list */
+   unsigned long waits;              /* number of times a thread waited for a buffer */
+};
+
+/** \brief reserve a slab for up to nBuffers buffers of bufferSize bytes, carved when needed, returns 0 on success */
+extern int poolInit(unsigned int nBuffers, unsigned int bufferSize);
+
+/** \brief take a buffer, waiting while the pool is exhausted */
+extern unsigned char *poolTake(void);
+
+/** \brief give a buffer back (given any pointer inside it) */
+extern void poolGive(unsigned char *buffer);
+
+/** \brief tell if the buffer belongs to the pool */
+extern bool poolOwns(const unsigned char *buffer);
+
+/** \brief number of bytes of each buffer */
+extern unsigned int poolBufferSize(void);
+
+/** \brief get the statistics of the pool */
+extern void poolGetStats(struct PoolStats *stats);
+
+/** \brief release the memory of the pool */
+extern void poolDestroy(void);
+
+#endif /* CHUNK_POOL_H */
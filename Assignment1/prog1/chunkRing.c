@@ -0,0 +1,176 @@
+/**
+ *  \file chunkRing.c (implementation file)
+ *
+ *  \brief Problem name: Count Words.
+ *
+ *  Lock-free bounded multi-producer / multi-consumer ring of chunks (see chunkRing.h).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "chunkRing.h"
+#include "spinWait.h"
+
+/**
+ *  \brief Initialize the ring.
+ *
+ *  \param ring ring to be initialized
+ *  \param capacity minimum number of slots (rounded up to a power of two)
+ *
+ *  \return 0 on success, -1 if the memory could not be allocated
+ */
+int ringInit(struct ChunkRing *ring, unsigned int capacity){
+   size_t size = 2;
+
+   while (size < capacity) size <<= 1;
+
+   if ((ring->cells = malloc(size * sizeof(struct RingCell))) == NULL) return -1;
+   for (size_t i = 0; i < size; i++) {
+      atomic_init(&ring->cells[i].sequence, i);
+   }
+   ring->mask = size - 1;
+   ring->spinLimit = spinLimit();
+   atomic_init(&ring->head, 0);
+   atomic_init(&ring->tail, 0);
+   atomic_init(&ring->notEmpty, 0);
+   atomic_init(&ring->emptyWaiters, 0);
+   atomic_init(&ring->notFull, 0);
+   atomic_init(&ring->fullWaiters, 0);
+
+   return 0;
+}
+
+/**
+ *  \brief Try to store a chunk without waiting.
+ *
+ *  \return true if the chunk was stored, false if the ring is full
+ */
+static bool tryPush(struct ChunkRing *ring, struct Chunk *chunk){
+   size_t pos = atomic_load_explicit(&ring->head, memory_order_relaxed);
+   struct RingCell *cell;
+
+   for (;;) {
+      cell = &ring->cells[pos & ring->mask];
+      size_t seq = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+      intptr_t dif = (intptr_t) seq - (intptr_t) pos;
+
+      if (dif == 0) {
+         if (atomic_compare_exchange_weak_explicit(&ring->head, &pos, pos + 1, memory_order_relaxed, memory_order_relaxed)) break;
+      }
+      else if (dif < 0) return false;                   /* slot still holds a chunk of the previous lap */
+      else pos = atomic_load_explicit(&ring->head, memory_order_relaxed);
+   }
+
+   cell->chunk = *chunk;
+   atomic_store_explicit(&cell->sequence, pos + 1, memory_order_release);
+   return true;
+}
+
+/**
+ *  \brief Try to retrieve a chunk without waiting.
+ *
+ *  \return true if a chunk was retrieved, false if the ring is empty
+ */
+static bool tryPop(struct ChunkRing *ring, struct Chunk *chunk){
+   size_t pos = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+   struct RingCell *cell;
+
+   for (;;) {
+      cell = &ring->cells[pos & ring->mask];
+      size_t seq = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+      intptr_t dif = (intptr_t) seq - (intptr_t) (pos + 1);
+
+      if (dif == 0) {
+         if (atomic_compare_exchange_weak_explicit(&ring->tail, &pos, pos + 1, memory_order_relaxed, memory_order_relaxed)) break;
+      }
+      else if (dif < 0) return false;                   /* slot not written yet in this lap */
+      else pos = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+   }
+
+   *chunk = cell->chunk;
+   atomic_store_explicit(&cell->sequence, pos + ring->mask + 1, memory_order_release);
+   return true;
+}
+
+/**
+ *  \brief Store a chunk in the ring.
+ *
+ *  Operation carried out by the producers. Spins and then sleeps while the ring is full.
+ *
+ *  \param ring ring
+ *  \param chunk chunk to be stored
+ */
+void ringPush(struct ChunkRing *ring, struct Chunk chunk){
+   int spins = 0;
+
+   while (!tryPush(ring, &chunk)) {
+      if (spins++ < ring->spinLimit) {
+         cpuRelax();
+         continue;
+      }
+
+      /* announce the wait and check again, so a retrieval done in between is not missed */
+      unsigned int seen = atomic_load(&ring->notFull);
+      atomic_fetch_add(&ring->fullWaiters, 1);
+      if (tryPush(ring, &chunk)) {
+         atomic_fetch_sub(&ring->fullWaiters, 1);
+         break;
+      }
+      futexWait(&ring->notFull, seen);
+      atomic_fetch_sub(&ring->fullWaiters, 1);
+   }
+
+   /* let a consumer know that a chunk has been stored */
+   atomic_fetch_add(&ring->notEmpty, 1);
+   if (atomic_load(&ring->emptyWaiters) > 0) futexWake(&ring->notEmpty, 1);
+}
+
+/**
+ *  \brief Retrieve a chunk from the ring.
+ *
+ *  Operation carried out by the consumers. Spins and then sleeps while the ring is empty.
+ *
+ *  \param ring ring
+ *
+ *  \return chunk
+ */
+struct Chunk ringPop(struct ChunkRing *ring){
+   struct Chunk chunk;
+   int spins = 0;
+
+   while (!tryPop(ring, &chunk)) {
+      if (spins++ < ring->spinLimit) {
+         cpuRelax();
+         continue;
+      }
+
+      /* announce the wait and check again, so an insertion done in between is not missed */
+      unsigned int seen = atomic_load(&ring->notEmpty);
+      atomic_fetch_add(&ring->emptyWaiters, 1);
+      if (tryPop(ring, &chunk)) {
+         atomic_fetch_sub(&ring->emptyWaiters, 1);
+         break;
+      }
+      futexWait(&ring->notEmpty, seen);
+      atomic_fetch_sub(&ring->emptyWaiters, 1);
+   }
+
+   /* let a producer know that a slot has been freed */
+   atomic_fetch_add(&ring->notFull, 1);
+   if (atomic_load(&ring->fullWaiters) > 0) futexWake(&ring->notFull, 1);
+
+   return chunk;
+}
+
+/**
+ *  \brief Release the memory of the ring.
+ *
+ *  \param ring ring
+ */
+void ringDestroy(struct ChunkRing *ring){
+   free(ring->cells);
+   ring->cells = NULL;
+}
@@ -0,0 +1,58 @@
+/**
+ *  \file chunkRing.h (interface file)
+ *
+ *  \brief Problem name: Count Words.
+ *
+ *  Lock-free bounded multi-producer / multi-consumer ring of chunks.
+ *
+ *  Each slot carries a sequence number telling if it is ready to be written or read in the current lap, so
+ *  producers and consumers only compete on one atomic counter each and never take a lock. A thread that finds the
+ *  ring full (producers) or empty (consumers) spins for a while and then sleeps on a futex until the other side
+ *  makes progress.
+ *
+ *  Definition of the operations:
+ *     \li ringInit
+ *     \li ringPush
+ *     \li ringPop
+ *     \li ringDestroy
+ */
+
+#ifndef CHUNK_RING_H
+#define CHUNK_RING_H
+
+#include <stdatomic.h>
+
+#include "sharedRegion.h"
+
+/** \brief one slot of the ring */
+struct RingCell {
+   atomic_size_t sequence;   /* lap in which the slot can be written (== position) or read (== position + 1) */
+   struct Chunk chunk;       /* stored chunk */
+};
+
+/** \brief lock-free bounded ring of chunks */
+struct ChunkRing {
+   _Alignas(64) atomic_size_t head;            /* insertion position */
+   _Alignas(64) atomic_size_t tail;            /* retrieval position */
+   _Alignas(64) atomic_uint notEmpty;          /* futex word, bumped after every insertion */
+   atomic_uint emptyWaiters;                   /* number of consumers sleeping (or about to) on notEmpty */
+   _Alignas(64) atomic_uint notFull;           /* futex word, bumped after every retrieval */
+   atomic_uint fullWaiters;                    /* number of producers sleeping (or about to) on notFull */
+   size_t mask;                                /* capacity - 1 (the capacity is a power of two) */
+   int spinLimit;                              /* failed attempts before sleeping (0 on a single processor) */
+   struct RingCell *cells;                     /* slots */
+};
+
+/** \brief initialize the ring with at least capacity slots, returns 0 on success */
+extern int ringInit(struct ChunkRing *ring, unsigned int capacity);
+
+/** \brief store a chunk, waiting while the ring is full */
+extern void ringPush(struct ChunkRing *ring, struct Chunk chunk);
+
+/** \brief retrieve a chunk, waiting while the ring is empty */
+extern struct Chunk ringPop(struct ChunkRing *ring);
+
+/** \brief release the memory of the ring */
+extern void ringDestroy(struct ChunkRing *ring);
+
+#endif /* CHUNK_RING_H */
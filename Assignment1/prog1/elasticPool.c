@@ -0,0 +1,235 @@
+/**
+ *  \file elasticPool.c (implementation file)
+ *
+ *  \brief Problem name: Count Words.
+ *
+ *  Elastic pool of workers, sized at runtime from the pressure on the monitor fifo (see elasticPool.h).
+ *
+ *  The controller compares, over each period, the time main was blocked on fifoFull with half the period, and the
+ *  time the workers were blocked on fifoEmpty, added up, with the whole period: more than a worker idle all along is
+ *  a worker too many. A worker only stops taking chunks between two chunks, so shrinking the pool never holds a
+ *  chunk back, and one still waiting on fifoEmpty when it stops being active takes a chunk before it waits on the
+ *  pool; the workers waiting on the pool are not counted as blocked on fifoEmpty.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <errno.h>
+#include <time.h>
+#include <stdatomic.h>
+
+#include "elasticPool.h"
+#include "sharedRegion.h"
+
+/** \brief period of the controller, in milliseconds */
+#define ELASTIC_PERIOD_MS 20
+
+/** \brief number of periods in a row that must call for a change before it is made */
+#define ELASTIC_PATIENCE 2
+
+/** \brief smallest number of active workers */
+static int minActive;
+
+/** \brief largest number of active workers (the number of workers created) */
+static int maxActive;
+
+/** \brief number of active workers, the workers with a lower identification take chunks */
+static atomic_int activeWorkers;
+
+/** \brief flag signaling the controller must stop and every worker take chunks */
+static bool stopped = false;
+
+/** \brief number of changes of the number of active workers */
+static int changes = 0;
+
+/** \brief number of active workers integrated over time, in workers * nanoseconds */
+static double activeTime = 0;
+
+/** \brief time the controller ran, in nanoseconds */
+static double controlTime = 0;
+
+/** \brief instant the controller started */
+static struct timespec startTime;
+
+/** \brief controller thread */
+static pthread_t controller;
+
+/** \brief locking flag which warrants mutual exclusion inside the monitor */
+static pthread_mutex_t accessPool = PTHREAD_MUTEX_INITIALIZER;
+
+/** \brief workers synchronization point while they are not active */
+static pthread_cond_t poolGrown;
+
+/** \brief controller synchronization point between two periods, signaled when it must stop */
+static pthread_cond_t controllerWake;
+
+/**
+ *  \brief Time between two instants.
+ *
+ *  \return number of nanoseconds
+ */
+static long elapsed(const struct timespec *from, const struct timespec *to){
+
+   return (to->tv_sec - from->tv_sec) * 1000000000L + (to->tv_nsec - from->tv_nsec);
+}
+
+/**
+ *  \brief Enter the monitor of the pool, leaving the program on failure.
+ */
+static void enterPool(void){
+
+   int status;
+
+   if ((status = pthread_mutex_lock(&accessPool)) != 0) {
+      errno = status;
+      perror("error on entering monitor(ELASTIC)");
+      exit(EXIT_FAILURE);
+   }
+}
+
+/**
+ *  \brief Exit the monitor of the pool, leaving the program on failure.
+ */
+static void exitPool(void){
+
+   int status;
+
+   if ((status = pthread_mutex_unlock(&accessPool)) != 0) {
+      errno = status;
+      perror("error on exiting monitor(ELASTIC)");
+      exit(EXIT_FAILURE);
+   }
+}
+
+void elasticInit(int minWorkers, int maxWorkers, int initialWorkers){
+
+   pthread_condattr_t attr;
+
+   minActive = minWorkers;
+   maxActive = maxWorkers;
+   if (initialWorkers < minWorkers) initialWorkers = minWorkers;
+   if (initialWorkers > maxWorkers) initialWorkers = maxWorkers;
+   atomic_store(&activeWorkers, initialWorkers);
+
+   /* the controller waits for the end of its period on the monotonic clock, as the fifo measures its waits */
+   pthread_condattr_init(&attr);
+   pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+   pthread_cond_init(&controllerWake, &attr);
+   pthread_condattr_destroy(&attr);
+   pthread_cond_init(&poolGrown, NULL);
+
+   configureFifoPressure(true);
+}
+
+/**
+ *  \brief Function controller.
+ *
+ *  Every period, compares the time blocked on both ends of the fifo, over the period, and resizes the pool.
+ *
+ *  \param par not used
+ */
+static void *control(void *par){
+
+   struct FifoPressure last, now;
+   struct timespec tick, instant;
+   int growPeriods = 0, shrinkPeriods = 0;
+   const long period = ELASTIC_PERIOD_MS * 1000000L;
+
+   (void) par;
+   getFifoPressure(&last);
+   tick = startTime;
+
+   enterPool();
+   while (!stopped) {
+      tick.tv_nsec += period;
+      if (tick.tv_nsec >= 1000000000L) {
+         tick.tv_sec++;
+         tick.tv_nsec -= 1000000000L;
+      }
+      while (!stopped && pthread_cond_timedwait(&controllerWake, &accessPool, &tick) != ETIMEDOUT)
+         ;
+      if (stopped) break;
+
+      int active = atomic_load(&activeWorkers);
+      getFifoPressure(&now);
+      clock_gettime(CLOCK_MONOTONIC, &instant);
+      long fullNs = now.fullNs - last.fullNs;
+      long emptyNs = now.emptyNs - last.emptyNs;
+      last = now;
+      activeTime += (double) active * period;
+      controlTime += period;
+
+      /* main blocked on a full fifo: the workers do not keep up; workers blocked on an empty fifo: main does not;
+         both in the same period: the input comes in bursts, and the pool is left as it is */
+      bool behind = 2 * fullNs > period || 4 * now.occupancy >= 3 * now.capacity;
+      bool idle = emptyNs > period && 4 * now.occupancy <= now.capacity;
+      bool grow = active < maxActive && behind && !idle;
+      bool shrink = active > minActive && idle && !behind;
+      growPeriods = grow ? growPeriods + 1 : 0;
+      shrinkPeriods = shrink ? shrinkPeriods + 1 : 0;
+      if (growPeriods < ELASTIC_PATIENCE && shrinkPeriods < ELASTIC_PATIENCE) continue;
+
+      int next = active + ((growPeriods >= ELASTIC_PATIENCE) ? 1 : -1);
+      growPeriods = shrinkPeriods = 0;
+      atomic_store(&activeWorkers, next);
+      changes++;
+      if (next > active) pthread_cond_broadcast(&poolGrown);
+
+      fprintf(stderr, "elastic: %.3f s: %d -> %d workers (fifo %u of %u, in the last %d ms main blocked on fifoFull %.1f ms, "
+              "workers blocked on fifoEmpty %.1f ms)\n", 1.0e-9 * elapsed(&startTime, &instant), active, next,
+              now.occupancy, now.capacity, ELASTIC_PERIOD_MS, 1.0e-6 * fullNs, 1.0e-6 * emptyNs);
+   }
+   exitPool();
+
+   return NULL;
+}
+
+int elasticStart(void){
+
+   clock_gettime(CLOCK_MONOTONIC, &startTime);
+   fprintf(stderr, "elastic: %d workers at the start, between %d and %d\n", atomic_load(&activeWorkers), minActive,
+           maxActive);
+
+   return pthread_create(&controller, NULL, control, NULL);
+}
+
+bool elasticPark(unsigned int workerId){
+
+   int status;
+
+   if ((int) workerId < atomic_load_explicit(&activeWorkers, memory_order_relaxed)) return false;
+
+   enterPool();
+   while ((int) workerId >= atomic_load(&activeWorkers) && !stopped) {
+      if ((status = pthread_cond_wait(&poolGrown, &accessPool)) != 0) {
+         errno = status;
+         perror("error on waiting in poolGrown");
+         exit(EXIT_FAILURE);
+      }
+   }
+   exitPool();
+
+   return true;
+}
+
+void elasticStop(void){
+
+   enterPool();
+   stopped = true;
+   pthread_cond_signal(&controllerWake);
+   pthread_cond_broadcast(&poolGrown);
+   exitPool();
+
+   if (pthread_join(controller, NULL) != 0) {
+      perror("error on waiting for the elastic controller");
+      exit(EXIT_FAILURE);
+   }
+}
+
+void elasticPrint(void){
+
+   fprintf(stderr, "elastic: %d changes, %.2f active workers on average (between %d and %d)\n", changes,
+           (controlTime > 0) ? activeTime / controlTime : (double) atomic_load(&activeWorkers), minActive, maxActive);
+}
@@ -0,0 +1,43 @@
+/**
+ *  \file elasticPool.h (interface file)
+ *
+ *  \brief Problem name: Count Words.
+ *
+ *  Elastic pool of workers, sized at runtime from the pressure on the monitor fifo.
+ *
+ *  The maximum number of workers is created at the start, but only the first ones, the active workers, take chunks:
+ *  the others wait, between two chunks, until the pool grows. A controller thread looks at the fifo every period.
+ *  When main was blocked on fifoFull for most of it, or the fifo is nearly full, the workers do not keep up with the
+ *  producer and the pool grows by one worker. When the workers were blocked on fifoEmpty, added up, for longer than
+ *  it and the fifo is nearly empty, the producer (the reads, usually) does not keep up with the workers and the pool
+ *  shrinks by one. A change is only made after two periods in a row call for it, and each change is logged to stderr.
+ *
+ *  Definition of the operations:
+ *     \li elasticInit
+ *     \li elasticStart
+ *     \li elasticPark
+ *     \li elasticStop
+ *     \li elasticPrint
+ */
+
+#ifndef ELASTIC_POOL_H
+#define ELASTIC_POOL_H
+
+#include <stdbool.h>
+
+/** \brief size the pool between minWorkers and maxWorkers, with the given number of active workers at the start */
+extern void elasticInit(int minWorkers, int maxWorkers, int initialWorkers);
+
+/** \brief start the controller thread, returns 0 on success */
+extern int elasticStart(void);
+
+/** \brief wait while the worker is not active, returns true if it waited */
+extern bool elasticPark(unsigned int workerId);
+
+/** \brief stop the controller thread and let every worker take chunks again, so they all get their end chunk */
+extern void elasticStop(void);
+
+/** \brief print the number of changes and the mean number of active workers to stderr */
+extern void elasticPrint(void);
+
+#endif /* ELASTIC_POOL_H */
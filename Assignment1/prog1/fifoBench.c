@@ -0,0 +1,294 @@
+/**
+ *  \file fifoBench.c
+ *
+ *  \brief Problem name: Count Words.
+ *
+ *  Contention benchmark of the chunk fifo implementations.
+ *
+ *  The main thread stores empty chunk views as fast as it can and the workers retrieve them, doing an optional
+ *  amount of busy work per chunk (optionally much larger for some chunks), until they get the end chunk. Every fifo / number of workers combination runs in
+ *  its own process, so the state of the shared region starts clean each time.
+ *
+ *  The chunks retrieved by the workers are counted, and a run where some chunk was not retrieved (a worker got an end
+ *  chunk while chunks were still stored) is reported and makes the benchmark fail. With -r every combination runs
+ *  several times: many short runs stress the end of the transfer, where the workers stop. With -c the end of the
+ *  transfer of the work-stealing deques is checked instead, in a single thread, in an order where the end chunks
+ *  used to be taken while chunks were still stored.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <sys/wait.h>
+
+#include "sharedRegion.h"
+#include "chunkDeque.h"
+
+/** \brief worker threads return status array */
+int *workersStatus;
+
+/** \brief main thread return status */
+int statusMain;
+
+/** \brief return status on monitor initialization */
+int statusInitMon;
+
+/** \brief busy work iterations per chunk */
+static long workPerChunk = 0;
+
+/** \brief every SKEW_PERIOD-th chunk costs skew times the busy work of the others */
+static long skew = 1;
+
+/** \brief period of the expensive chunks */
+#define SKEW_PERIOD 8
+
+/** \brief number of chunks retrieved by each worker */
+static long *workerChunks;
+
+/** \brief worker life cycle routine */
+static void *worker(void *par);
+
+/** \brief run one fifo / number of workers combination, returns false if some chunk was not retrieved */
+static bool runOne(enum FifoType type, const char *name, int nThreads, long nChunks, unsigned int capacity);
+
+/** \brief check that no worker of the work-stealing deques stops while chunks are stored */
+static bool checkStealEnd(void);
+
+/** \brief execution time measurement */
+static double get_delta_time(void);
+
+/** \brief print command usage */
+static void printUsage(char *cmdName);
+
+int main(int argc, char *argv[]){
+   int c;
+   int maxThreads = 32;
+   long nChunks = 1000000;
+   unsigned int capacity = 10;
+   int runs = 1;
+   bool ok = true;
+
+   while ((c = getopt(argc, argv, "t:n:q:w:k:r:ch")) != -1) {
+      switch (c) {
+         case 't':
+            maxThreads = atoi(optarg);
+            break;
+         case 'n':
+            nChunks = atol(optarg);
+            break;
+         case 'q':
+            capacity = atoi(optarg);
+            break;
+         case 'w':
+            workPerChunk = atol(optarg);
+            break;
+         case 'k':
+            skew = atol(optarg);
+            break;
+         case 'r':
+            runs = atoi(optarg);
+            break;
+         case 'c':
+            return checkStealEnd() ? EXIT_SUCCESS : EXIT_FAILURE;
+         case 'h':
+            printUsage(argv[0]);
+            return EXIT_SUCCESS;
+         default:
+            printUsage(argv[0]);
+            return EXIT_FAILURE;
+      }
+   }
+
+   if (maxThreads <= 0 || nChunks <= 0 || capacity == 0 || workPerChunk < 0 || skew <= 0 || runs <= 0) {
+      fprintf(stderr, "%s: arguments must be positive\n", argv[0]);
+      printUsage(argv[0]);
+      return EXIT_FAILURE;
+   }
+
+   printf("fifo,workers,capacity,chunks,seconds,chunks_per_second\n");
+   for (int nThreads = 1; nThreads <= maxThreads; nThreads *= 2) {
+      for (int r = 0; r < runs; r++) {
+         ok &= runOne(FIFO_MONITOR, "monitor", nThreads, nChunks, capacity);
+         ok &= runOne(FIFO_RING, "ring", nThreads, nChunks, capacity);
+         ok &= runOne(FIFO_STEAL, "steal", nThreads, nChunks, capacity);
+      }
+   }
+
+   return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**
+ *  \brief Run one fifo / number of workers combination in a child process and print a csv line.
+ *
+ *  \param type implementation of the fifo
+ *  \param name name of the implementation
+ *  \param nThreads number of workers
+ *  \param nChunks number of chunks to transfer
+ *  \param capacity capacity of the fifo
+ *
+ *  \return true if the workers retrieved every chunk
+ */
+static bool runOne(enum FifoType type, const char *name, int nThreads, long nChunks, unsigned int capacity){
+   pid_t pid;
+
+   fflush(stdout);
+   if ((pid = fork()) < 0) {
+      perror("fork");
+      exit(EXIT_FAILURE);
+   }
+
+   if (pid > 0) {
+      int status;
+      waitpid(pid, &status, 0);
+      return WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS;
+   }
+
+   pthread_t th[nThreads];
+   unsigned int workers[nThreads];
+   workersStatus = malloc(nThreads * sizeof(int));
+   workerChunks = calloc(nThreads, sizeof(long));
+
+   configureFifo(type, capacity, nThreads);
+   (void) get_delta_time();
+
+   for (int i = 0; i < nThreads; i++) {
+      workers[i] = i;
+      if (pthread_create(&th[i], NULL, worker, &workers[i]) != 0) {
+         perror("Failed to create thread");
+         exit(EXIT_FAILURE);
+      }
+   }
+
+   for (long i = 0; i < nChunks; i++) {
+      saveChunkView(0, i, 0);
+   }
+   for (int i = 0; i < nThreads; i++) {
+      saveChunk(NULL, -1, -1);
+   }
+   for (int i = 0; i < nThreads; i++) {
+      pthread_join(th[i], NULL);
+   }
+
+   double elapsed = get_delta_time();
+   long retrieved = 0;
+   for (int i = 0; i < nThreads; i++) {
+      retrieved += workerChunks[i];
+   }
+   printf("%s,%d,%u,%ld,%.6f,%.0f\n", name, nThreads, capacity, nChunks, elapsed, nChunks / elapsed);
+   if (retrieved != nChunks) {
+      fprintf(stderr, "%s, %d workers: %ld of %ld chunks retrieved\n", name, nThreads, retrieved, nChunks);
+   }
+   fflush(stdout);
+   _exit((retrieved == nChunks) ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+/**
+ *  \brief Check the end of the transfer of the work-stealing deques.
+ *
+ *  Two workers and deques of 8 chunks: 5 chunks are stored (a batch of STEAL_BATCH in the first deque, one in the
+ *  second) and then the end chunks, and the workers take turns retrieving chunks, in a single thread, until both got
+ *  an end chunk. A worker that gets an end chunk while chunks are still stored stops early, and a chunk is lost as soon
+ *  as the other one does the same before taking it, so it is reported as an error.
+ *
+ *  \return true if every chunk was retrieved before the workers stopped
+ */
+static bool checkStealEnd(void){
+   struct StealScheduler sched;
+   long stored = STEAL_BATCH + 1;
+   bool stopped[2] = {false, false};
+   bool ok = true;
+
+   if (stealInit(&sched, 2, 8) != 0) {
+      perror("Failed to allocate memory");
+      return false;
+   }
+   for (long i = 0; i < stored; i++) {
+      stealPush(&sched, (struct Chunk) {.fileId = 0, .size = 0, .offset = i, .chunk_pointer = NULL, .piece = NULL});
+   }
+   for (int i = 0; i < 2; i++) {
+      stealPush(&sched, (struct Chunk) {.fileId = -1, .size = -1, .offset = 0, .chunk_pointer = NULL, .piece = NULL});
+   }
+
+   for (unsigned int id = 1; !stopped[0] || !stopped[1]; id = 1 - id) {
+      if (stopped[id]) continue;
+
+      struct Chunk chunk = stealPop(&sched, id);
+      if (chunk.fileId != -1) {
+         stored--;
+      } else {
+         stopped[id] = true;
+         if (stored > 0) {
+            fprintf(stderr, "steal: worker %u got an end chunk while %ld chunks were stored\n", id, stored);
+            ok = false;
+         }
+      }
+   }
+   stealDestroy(&sched);
+   return ok;
+}
+
+/**
+ *  \brief Function worker.
+ *
+ *  Retrieves chunks until it gets the end chunk.
+ *
+ *  \param par pointer to application defined worker identification
+ */
+static void *worker(void *par){
+   unsigned int id = *((unsigned int *) par);
+   volatile long sink = 0;
+   struct Chunk chunk;
+
+   for (;;) {
+      chunk = retrieveChunk(id);
+      if ((chunk.chunk_pointer == NULL) && (chunk.fileId == -1)) break;
+      workerChunks[id]++;
+      long work = (chunk.offset % SKEW_PERIOD == 0) ? skew * workPerChunk : workPerChunk;
+      for (long i = 0; i < work; i++) sink += i;
+   }
+
+   workersStatus[id] = EXIT_SUCCESS;
+   return &workersStatus[id];
+}
+
+/**
+ *  \brief Get the process time that has elapsed since last call of this time.
+ *
+ *  \return process elapsed time
+ */
+static double get_delta_time(void)
+{
+  static struct timespec t0, t1;
+
+  t0 = t1;
+  if(clock_gettime (CLOCK_MONOTONIC, &t1) != 0)
+  {
+    perror ("clock_gettime");
+    exit(1);
+  }
+  return (double) (t1.tv_sec - t0.tv_sec) + 1.0e-9 * (double) (t1.tv_nsec - t0.tv_nsec);
+}
+
+/**
+ *  \brief Print command usage.
+ *
+ *  \param cmdName string with the name of the command
+ */
+static void printUsage(char *cmdName)
+{
+  fprintf (stderr, "\nSynopsis: %s [OPTIONS]\n"
+           "  OPTIONS:\n"
+           "  -t nThreads  --- maximum number of workers, doubled from 1 (default: 32)\n"
+           "  -n nChunks   --- number of chunks transferred per run (default: 1000000)\n"
+           "  -q capacity  --- capacity of the fifo (default: 10)\n"
+           "  -w work      --- busy loop iterations per chunk (default: 0)\n"
+           "  -k skew      --- every 8th chunk does skew times the busy work (default: 1)\n"
+           "  -r runs      --- number of runs of each fifo / number of workers combination (default: 1)\n"
+           "  -c           --- check the end of the transfer of the work-stealing deques, in a single thread, and exit\n"
+           "  -h           --- print this help\n", cmdName);
+}
@@ -0,0 +1,237 @@
+/**
+ *  \file loadClient.c
+ *
+ *  \brief Problem name: Count Words.
+ *
+ *  Load test of the daemon mode (see requestServer.h).
+ *
+ *  Each client thread sends the same request, the files given (made absolute, since the daemon may run in another
+ *  directory), over a new connection, waits for the whole answer and sends the next one, until it sent its share of
+ *  the requests. The latency of every request is kept, and the requests per second and the latency percentiles are
+ *  printed at the end. An answer with an error, or without every file, counts as failed.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <string.h>
+#include <limits.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+/** \brief path of the socket of the daemon */
+static const char *socketPath;
+
+/** \brief text of the request */
+static char *requestText;
+
+/** \brief number of bytes of the request */
+static size_t requestLength;
+
+/** \brief number of files of the request */
+static int requestFiles;
+
+/** \brief number of requests sent by each client */
+static long requestsPerClient = 1000;
+
+/** \brief latency of each request, in seconds, client c keeps its own in latencies[c * requestsPerClient ...] */
+static double *latencies;
+
+/** \brief number of requests that failed, per client */
+static long *failures;
+
+/** \brief client life cycle routine */
+static void *client(void *par);
+
+/** \brief send one request and read its answer, returns true if every file was answered */
+static bool sendRequest(void);
+
+/** \brief comparison of two latencies, for qsort */
+static int compareLatencies(const void *a, const void *b);
+
+/** \brief time since some fixed instant, in seconds */
+static double now(void);
+
+/** \brief print command usage */
+static void printUsage(char *cmdName);
+
+int main(int argc, char *argv[]){
+   int c;
+   int nClients = 4;
+
+   socketPath = NULL;
+   while ((c = getopt(argc, argv, "s:c:n:h")) != -1) {
+      switch (c) {
+         case 's':
+            socketPath = optarg;
+            break;
+         case 'c':
+            nClients = atoi(optarg);
+            break;
+         case 'n':
+            requestsPerClient = atol(optarg);
+            break;
+         case 'h':
+            printUsage(argv[0]);
+            return EXIT_SUCCESS;
+         default:
+            printUsage(argv[0]);
+            return EXIT_FAILURE;
+      }
+   }
+
+   if (socketPath == NULL || optind == argc || nClients <= 0 || requestsPerClient <= 0) {
+      fprintf(stderr, "%s: missing or non positive argument(s)\n", argv[0]);
+      printUsage(argv[0]);
+      return EXIT_FAILURE;
+   }
+
+   /* the request: one absolute path per line, ended by an empty line */
+   requestFiles = argc - optind;
+   requestText = malloc((size_t) requestFiles * (PATH_MAX + 1) + 2);
+   if (requestText == NULL) {
+      perror("Failed to allocate memory");
+      return EXIT_FAILURE;
+   }
+   requestLength = 0;
+   for (int i = optind; i < argc; i++) {
+      char path[PATH_MAX];
+
+      if (realpath(argv[i], path) == NULL) {
+         perror(argv[i]);
+         return EXIT_FAILURE;
+      }
+      requestLength += sprintf(requestText + requestLength, "%s\n", path);
+   }
+   requestText[requestLength++] = '\n';
+
+   pthread_t th[nClients];
+   int clients[nClients];
+   latencies = malloc(nClients * requestsPerClient * sizeof(double));
+   failures = calloc(nClients, sizeof(long));
+   if (latencies == NULL || failures == NULL) {
+      perror("Failed to allocate memory");
+      return EXIT_FAILURE;
+   }
+
+   double start = now();
+   for (int i = 0; i < nClients; i++) {
+      clients[i] = i;
+      if (pthread_create(&th[i], NULL, client, &clients[i]) != 0) {
+         perror("Failed to create thread");
+         return EXIT_FAILURE;
+      }
+   }
+   long failed = 0;
+   for (int i = 0; i < nClients; i++) {
+      pthread_join(th[i], NULL);
+      failed += failures[i];
+   }
+   double elapsed = now() - start;
+
+   long total = nClients * requestsPerClient;
+   qsort(latencies, total, sizeof(double), compareLatencies);
+   printf("clients,files,requests,failed,seconds,requests_per_second,p50_ms,p99_ms,max_ms\n");
+   printf("%d,%d,%ld,%ld,%.6f,%.1f,%.3f,%.3f,%.3f\n", nClients, requestFiles, total, failed, elapsed, total / elapsed,
+          1000 * latencies[total / 2], 1000 * latencies[(total * 99) / 100], 1000 * latencies[total - 1]);
+
+   free(latencies);
+   free(failures);
+   free(requestText);
+   return (failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**
+ *  \brief Function client.
+ *
+ *  Sends its share of the requests, one after the other, measuring the latency of each one.
+ *
+ *  \param par pointer to application defined client identification
+ */
+static void *client(void *par){
+   int id = *((int *) par);
+
+   for (long i = 0; i < requestsPerClient; i++) {
+      double start = now();
+
+      if (!sendRequest()) failures[id]++;
+      latencies[id * requestsPerClient + i] = now() - start;
+   }
+   return NULL;
+}
+
+static bool sendRequest(void){
+   struct sockaddr_un address;
+   char answer[64 * 1024];
+   size_t length = 0;
+   int fd, files = 0;
+   bool error = false;
+
+   memset(&address, 0, sizeof(address));
+   address.sun_family = AF_UNIX;
+   strncpy(address.sun_path, socketPath, sizeof(address.sun_path) - 1);
+   if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) == -1) return false;
+   if (connect(fd, (struct sockaddr *) &address, sizeof(address)) != 0) {
+      close(fd);
+      return false;
+   }
+
+   for (size_t sent = 0; sent < requestLength; ) {
+      ssize_t n = send(fd, requestText + sent, requestLength - sent, MSG_NOSIGNAL);
+      if (n <= 0) {
+         close(fd);
+         return false;
+      }
+      sent += n;
+   }
+
+   /* count the files answered, the answer may come in pieces that divide a line */
+   for (;;) {
+      ssize_t n = read(fd, answer + length, sizeof(answer) - length - 1);
+      if (n <= 0) break;
+      length += n;
+      answer[length] = '\0';
+
+      char *line = answer, *end;
+      while ((end = strchr(line, '\n')) != NULL) {
+         if (strncmp(line, "File name: ", 11) == 0) files++;
+         if (strncmp(line, "Error: ", 7) == 0) error = true;
+         line = end + 1;
+      }
+      length = answer + length - line;
+      memmove(answer, line, length);
+   }
+   close(fd);
+
+   return files == requestFiles && !error;
+}
+
+static int compareLatencies(const void *a, const void *b){
+   double x = *(const double *) a, y = *(const double *) b;
+
+   return (x > y) - (x < y);
+}
+
+static double now(void){
+   struct timespec t;
+
+   clock_gettime(CLOCK_MONOTONIC, &t);
+   return t.tv_sec + 1.0e-9 * t.tv_nsec;
+}
+
+/**
+ *  \brief Print command usage.
+ *
+ *  \param cmdName string with the name of the command
+ */
+static void printUsage(char *cmdName){
+   fprintf(stderr, "\nSynopsis: %s -s socket [OPTIONS] files\n"
+           "  OPTIONS:\n"
+           "  -s socket    --- Unix domain socket of the daemon (prog1 -d socket)\n"
+           "  -c nClients  --- number of clients sending requests at the same time (default: 4)\n"
+           "  -n nRequests --- number of requests sent by each client (default: 1000)\n"
+           "  -h           --- print this help\n", cmdName);
+}
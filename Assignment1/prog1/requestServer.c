@@ -0,0 +1,474 @@
+/**
+ *  \file requestServer.c (implementation file)
+ *
+ *  \brief Problem name: Count Words.
+ *
+ *  Requests of the daemon mode, received over a Unix domain socket (see requestServer.h).
+ *
+ *  Main is the only thread that touches the requests and the slots: it polls the listening socket, the connections
+ *  of the requests still being received and the read end of the pipe. The other threads only write the slot of a
+ *  complete file to the pipe, and the signal handler writes -1 to it. There are never more slots waiting in the pipe
+ *  than slots of files, so the writes do not block as long as they fit in the pipe.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "sharedRegion.h"
+#include "requestServer.h"
+
+/** \brief maximum number of bytes of a request */
+#define MAX_REQUEST (1024 * 1024)
+
+/** \brief number of connections waiting to be accepted */
+#define LISTEN_BACKLOG 128
+
+/** \brief file of a request */
+struct RequestFile {
+   char *name;                        /* path of the file, inside the text of the request */
+   struct FileCounters counters;      /* counters of the file, once complete */
+   bool failed;                       /* flag telling if the file could not be read */
+};
+
+/** \brief request of a client */
+struct Request {
+   int fd;                            /* connection with the client */
+   char *text;                        /* text of the request, received so far */
+   size_t length;                     /* number of bytes of text */
+   size_t capacity;                   /* number of bytes allocated for text */
+   bool received;                     /* flag telling if the whole request was received */
+   struct RequestFile *files;         /* files of the request */
+   int nFiles;                        /* number of files */
+   int nextFile;                      /* next file to be processed */
+   int filesDone;                     /* number of files complete */
+   bool splitting;                    /* flag telling if one of its files is being split by main */
+};
+
+/** \brief use of a slot of files */
+struct SlotUse {
+   struct Request *request;           /* request of the file in the slot (NULL: slot free) */
+   int file;                          /* index of the file in the request */
+};
+
+/** \brief listening socket */
+static int listenFd = -1;
+
+/** \brief path of the listening socket */
+static char *socketPath;
+
+/** \brief pipe where the slots of the files complete are written */
+static int wakePipe[2] = {-1, -1};
+
+/** \brief requests being received or processed, in the order they arrived */
+static struct Request **requests;
+
+/** \brief number of requests */
+static int nRequests = 0;
+
+/** \brief number of requests allocated */
+static int requestCapacity = 0;
+
+/** \brief request from where the next file is looked for, so that the requests take turns */
+static int turn = 0;
+
+/** \brief use of each slot */
+static struct SlotUse *slots;
+
+/** \brief slots free, a stack */
+static int *freeSlots;
+
+/** \brief number of slots free */
+static int nFree;
+
+/** \brief number of requests answered */
+static long answered = 0;
+
+/** \brief flag set by the signal handler */
+static volatile sig_atomic_t stopRequested = 0;
+
+/**
+ *  \brief Ask the server to stop, waking main up.
+ *
+ *  \param signal number of the signal
+ */
+static void requestStop(int signal){
+
+   int stop = -1;
+   int savedErrno = errno;
+
+   (void) signal;
+   stopRequested = 1;
+   if (write(wakePipe[1], &stop, sizeof(int)) < 0) {
+      /* main sees the flag at its next poll anyway */
+   }
+   errno = savedErrno;
+}
+
+int serverOpen(const char *path, int nSlots){
+
+   struct sockaddr_un address;
+   struct sigaction action;
+
+   if (strlen(path) >= sizeof(address.sun_path)) {
+      errno = ENAMETOOLONG;
+      return -1;
+   }
+   slots = calloc(nSlots, sizeof(struct SlotUse));
+   freeSlots = malloc(nSlots * sizeof(int));
+   socketPath = strdup(path);
+   if (slots == NULL || freeSlots == NULL || socketPath == NULL) return -1;
+   for (nFree = 0; nFree < nSlots; nFree++) {
+      freeSlots[nFree] = nSlots - 1 - nFree;
+   }
+
+   if (pipe(wakePipe) != 0) return -1;
+   fcntl(wakePipe[0], F_SETFL, O_NONBLOCK);
+
+   /* a socket left by a server that did not stop cleanly is replaced */
+   memset(&address, 0, sizeof(address));
+   address.sun_family = AF_UNIX;
+   strcpy(address.sun_path, path);
+   unlink(path);
+   if ((listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)) == -1) return -1;
+   if (bind(listenFd, (struct sockaddr *) &address, sizeof(address)) != 0) return -1;
+   if (listen(listenFd, LISTEN_BACKLOG) != 0) return -1;
+
+   /* the handler may run in any thread, it only sets a flag and writes to the pipe */
+   memset(&action, 0, sizeof(action));
+   action.sa_handler = requestStop;
+   sigemptyset(&action.sa_mask);
+   sigaction(SIGINT, &action, NULL);
+   sigaction(SIGTERM, &action, NULL);
+   signal(SIGPIPE, SIG_IGN);
+
+   return 0;
+}
+
+/**
+ *  \brief Close the connection of a request and release it.
+ *
+ *  \param index index of the request
+ */
+static void dropRequest(int index){
+
+   struct Request *request = requests[index];
+
+   close(request->fd);
+   free(request->text);
+   free(request->files);
+   free(request);
+
+   memmove(&requests[index], &requests[index + 1], (nRequests - index - 1) * sizeof(struct Request *));
+   nRequests--;
+   if (turn > index) turn--;
+   if (turn >= nRequests) turn = 0;
+}
+
+/**
+ *  \brief Write the counters of the files of a request to its client.
+ *
+ *  The request was received in full, so the connection only has to be written; it is made blocking, and a client
+ *  that went away is ignored.
+ *
+ *  \param request request to be answered
+ */
+static void answerRequest(struct Request *request){
+
+   size_t size = 0, capacity = 256 * (request->nFiles + 1);
+   char *answer = malloc(capacity);
+
+   if (answer == NULL) return;
+   for (int i = 0; i < request->nFiles; i++) {
+      struct RequestFile *file = &request->files[i];
+      size_t need = strlen(file->name) + 256;
+
+      if (size + need > capacity) {
+         char *larger = realloc(answer, capacity = 2 * (size + need));
+         if (larger == NULL) {
+            free(answer);
+            return;
+         }
+         answer = larger;
+      }
+      if (file->failed) {
+         size += sprintf(answer + size, "\nFile name: %s\nError: the file could not be read\n", file->name);
+         continue;
+      }
+      size += sprintf(answer + size, "\nFile name: %s\n", file->name);
+      size += sprintf(answer + size, "Total number of words = %ld \n", file->counters.total_num_of_words);
+      size += sprintf(answer + size, "A: %ld   E: %ld   I: %ld   O: %ld   U: %ld   Y: %ld\n",
+                      file->counters.count_total_vowels[0], file->counters.count_total_vowels[1],
+                      file->counters.count_total_vowels[2], file->counters.count_total_vowels[3],
+                      file->counters.count_total_vowels[4], file->counters.count_total_vowels[5]);
+   }
+
+   fcntl(request->fd, F_SETFL, fcntl(request->fd, F_GETFL) & ~O_NONBLOCK);
+   for (size_t sent = 0; sent < size; ) {
+      ssize_t n = send(request->fd, answer + sent, size - sent, MSG_NOSIGNAL);
+      if (n <= 0) break;
+      sent += n;
+   }
+   free(answer);
+   answered++;
+}
+
+/**
+ *  \brief Split the text of a request that was received in full into its files.
+ *
+ *  \param request request received
+ *
+ *  \return 0 on success, -1 if the memory could not be allocated
+ */
+static int parseRequest(struct Request *request){
+
+   int lines = 0;
+   char *line = request->text;
+
+   for (size_t i = 0; i < request->length; i++) {
+      if (request->text[i] == '\n') lines++;
+   }
+   if ((request->files = calloc(lines + 1, sizeof(struct RequestFile))) == NULL) return -1;
+
+   /* one path per line, up to the first empty line */
+   request->nFiles = 0;
+   while (line < request->text + request->length) {
+      char *end = memchr(line, '\n', request->text + request->length - line);
+
+      if (end == NULL) end = request->text + request->length;
+      *end = '\0';
+      if (end > line && end[-1] == '\r') end[-1] = '\0';
+      if (*line == '\0') break;
+      request->files[request->nFiles++].name = line;
+      line = end + 1;
+   }
+   request->received = true;
+   return 0;
+}
+
+/**
+ *  \brief Read what a client sent, parsing its request once it is complete.
+ *
+ *  \param index index of the request
+ *
+ *  \return false if the request was dropped
+ */
+static bool receiveRequest(int index){
+
+   struct Request *request = requests[index];
+   char block[4096];
+   ssize_t n;
+
+   while ((n = read(request->fd, block, sizeof(block))) > 0) {
+      if (request->length + n + 1 > request->capacity) {
+         char *larger;
+
+         if (request->length + n + 1 > MAX_REQUEST) {
+            dropRequest(index);
+            return false;
+         }
+         request->capacity = 2 * (request->length + n + 1);
+         if ((larger = realloc(request->text, request->capacity)) == NULL) {
+            dropRequest(index);
+            return false;
+         }
+         request->text = larger;
+      }
+      memcpy(request->text + request->length, block, n);
+      request->length += n;
+      request->text[request->length] = '\0';
+   }
+   if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+      dropRequest(index);
+      return false;
+   }
+
+   /* the request ends with an empty line, or when the client shuts down its side */
+   bool ended = (n == 0) || (request->length > 0 && request->text[0] == '\n') ||
+                (request->text != NULL && strstr(request->text, "\n\n") != NULL);
+   if (!ended) return true;
+   if (request->text == NULL && (request->text = calloc(1, 1)) == NULL) {
+      dropRequest(index);
+      return false;
+   }
+   if (parseRequest(request) != 0) {
+      dropRequest(index);
+      return false;
+   }
+   if (request->nFiles == 0) {
+      answerRequest(request);
+      dropRequest(index);
+      return false;
+   }
+   return true;
+}
+
+/**
+ *  \brief Accept the connections waiting, each one is a new request.
+ */
+static void acceptRequests(void){
+
+   int fd;
+
+   while ((fd = accept(listenFd, NULL, NULL)) != -1) {
+      struct Request *request = calloc(1, sizeof(struct Request));
+
+      fcntl(fd, F_SETFL, O_NONBLOCK);
+      fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+      if (request != NULL && nRequests == requestCapacity) {
+         struct Request **larger = realloc(requests, (2 * requestCapacity + 8) * sizeof(struct Request *));
+         if (larger == NULL) {
+            free(request);
+            request = NULL;
+         }
+         else {
+            requests = larger;
+            requestCapacity = 2 * requestCapacity + 8;
+         }
+      }
+      if (request == NULL) {
+         close(fd);
+         continue;
+      }
+      request->fd = fd;
+      requests[nRequests++] = request;
+   }
+}
+
+/**
+ *  \brief Copy the counters of the files complete to their requests and answer the requests complete.
+ */
+static void collectFiles(void){
+
+   int slot;
+
+   while (read(wakePipe[0], &slot, sizeof(int)) == sizeof(int)) {
+      if (slot < 0) continue;                                      /* written by the signal handler */
+
+      struct Request *request = slots[slot].request;
+      struct RequestFile *file = &request->files[slots[slot].file];
+
+      getFileCounters(slot, &file->counters);
+      slots[slot].request = NULL;
+      freeSlots[nFree++] = slot;
+
+      if (++request->filesDone == request->nFiles) {
+         answerRequest(request);
+         for (int i = 0; i < nRequests; i++) {
+            if (requests[i] == request) {
+               dropRequest(i);
+               break;
+            }
+         }
+      }
+   }
+}
+
+bool serverPoll(bool block){
+
+   struct pollfd fds[nRequests + 2];
+   int index[nRequests + 2];
+   int n = 0;
+
+   if (stopRequested) return false;
+
+   fds[n].fd = wakePipe[0];
+   fds[n++].events = POLLIN;
+   fds[n].fd = listenFd;
+   fds[n++].events = POLLIN;
+   for (int i = 0; i < nRequests; i++) {
+      if (requests[i]->received) continue;
+      index[n] = i;
+      fds[n].fd = requests[i]->fd;
+      fds[n++].events = POLLIN;
+   }
+
+   if (poll(fds, n, block ? -1 : 0) < 0) {
+      if (errno != EINTR) {
+         perror("Failed to wait for requests");
+         exit(EXIT_FAILURE);
+      }
+      return !stopRequested;
+   }
+
+   /* read the requests from the last to the first, a request dropped only moves the ones after it */
+   for (int k = n - 1; k >= 2; k--) {
+      if (fds[k].revents != 0) receiveRequest(index[k]);
+   }
+   if (fds[1].revents != 0) acceptRequests();
+   if (fds[0].revents != 0) collectFiles();
+
+   return !stopRequested;
+}
+
+bool serverNextFile(int *slot, const char **name){
+
+   if (nFree == 0) return false;
+
+   /* the requests take turns, one file each, and a request has a single file being split at a time */
+   for (int k = 0; k < nRequests; k++) {
+      int i = (turn + k) % nRequests;
+      struct Request *request = requests[i];
+
+      if (!request->received || request->splitting || request->nextFile == request->nFiles) continue;
+
+      *slot = freeSlots[--nFree];
+      slots[*slot].request = request;
+      slots[*slot].file = request->nextFile++;
+      *name = request->files[slots[*slot].file].name;
+      resetFile(*slot, request->files[slots[*slot].file].name);
+      request->splitting = true;
+      turn = (i + 1) % nRequests;
+      return true;
+   }
+   return false;
+}
+
+void serverFileSplit(int slot){
+
+   slots[slot].request->splitting = false;
+}
+
+void serverFileFailed(int slot){
+
+   slots[slot].request->files[slots[slot].file].failed = true;
+}
+
+void serverFileDone(int slot){
+
+   if (write(wakePipe[1], &slot, sizeof(int)) != sizeof(int)) {
+      perror("Failed to signal a file complete");
+      exit(EXIT_FAILURE);
+   }
+}
+
+long serverRequests(void){
+
+   return answered;
+}
+
+void serverClose(void){
+
+   while (nRequests > 0) {
+      dropRequest(nRequests - 1);
+   }
+   free(requests);
+   if (listenFd != -1) {
+      close(listenFd);
+      unlink(socketPath);
+   }
+   close(wakePipe[0]);
+   close(wakePipe[1]);
+   free(socketPath);
+   free(slots);
+   free(freeSlots);
+}
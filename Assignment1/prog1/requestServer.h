@@ -0,0 +1,61 @@
+/**
+ *  \file requestServer.h (interface file)
+ *
+ *  \brief Problem name: Count Words.
+ *
+ *  Requests of the daemon mode, received over a Unix domain socket.
+ *
+ *  A client connects, writes the paths of the files to be processed, one per line, and ends the request with an
+ *  empty line or by shutting down its side of the connection. It gets back the counters of the files, in the order
+ *  of the request and in the format of the batch mode, and the connection is closed.
+ *
+ *  The files of all requests are processed in the slots of files of the shared region: main takes the next file of
+ *  the requests in turn, while a slot is free, and splits it into the fifo. A request has one file being split at a
+ *  time, and main splits the files of the requests a few chunks each in turn, so a small request is not held up by
+ *  the large file of another one. When the last chunk of a file is accounted for, the thread that accounts for it
+ *  tells main through a pipe, and main copies the counters of the file to its request and frees the slot. A request
+ *  is answered once all its files are complete. SIGINT and SIGTERM stop the server.
+ *
+ *  Definition of the operations:
+ *     \li serverOpen
+ *     \li serverPoll
+ *     \li serverNextFile
+ *     \li serverFileSplit
+ *     \li serverFileFailed
+ *     \li serverFileDone
+ *     \li serverRequests
+ *     \li serverClose
+ */
+
+#ifndef REQUEST_SERVER_H
+#define REQUEST_SERVER_H
+
+#include <stdbool.h>
+
+/** \brief listen on the socket at path, with nSlots slots of files, returns 0 on success */
+extern int serverOpen(const char *path, int nSlots);
+
+/** \brief accept connections, read requests and answer the complete ones, waiting for an event if block is set,
+           returns false when the server was asked to stop */
+extern bool serverPoll(bool block);
+
+/** \brief take the next file to be processed into a free slot, from a request with no file being split, returns false
+           if there is none (or no free slot) */
+extern bool serverNextFile(int *slot, const char **name);
+
+/** \brief tell that the file of a slot is split, its request may then take its next file */
+extern void serverFileSplit(int slot);
+
+/** \brief mark the file of a slot as not readable, it is answered with an error */
+extern void serverFileFailed(int slot);
+
+/** \brief tell main that the file of a slot is complete, called inside the monitor of the shared region */
+extern void serverFileDone(int slot);
+
+/** \brief number of requests answered */
+extern long serverRequests(void);
+
+/** \brief close the socket and the connections of the requests not answered */
+extern void serverClose(void);
+
+#endif /* REQUEST_SERVER_H */
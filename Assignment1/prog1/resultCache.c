@@ -0,0 +1,610 @@
+/**
+ *  \file resultCache.c (implementation file)
+ *
+ *  \brief Problem name: Count Words.
+ *
+ *  Persistent cache of the counters of each file (see resultCache.h).
+ *
+ *  Each line of the cache file holds one entry:
+ *     size mtime_sec mtime_nsec device inode hash words a e i o u y resumable state codepoint in_word seen
+ *     head_hash end_hash path
+ *  with the hashes in hexadecimal (0 when the content was not hashed) and the path running to the end of the line.
+ *  The decoder state, open word and vowels seen at the end of the file and the hashes of its first and last bytes
+ *  are only meaningful when resumable is 1. Entries written by version 1, without these fields, are still read.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include "resultCache.h"
+
+/** \brief first line of the cache file */
+#define CACHE_HEADER "# count words result cache 2\n"
+
+/** \brief number of bytes read at a time when hashing a file */
+#define HASH_BLOCK (64 * 1024)
+
+/** \brief number of bytes at the start of a file, and before its old end, that must not change to resume it */
+#define TAIL_CHECK 4096
+
+/** \brief state of the lookup of a file */
+enum LookupState {
+   LOOKUP_PENDING,      /* the file was not looked up yet */
+   LOOKUP_HIT,          /* the file did not change, its counters are in the cache */
+   LOOKUP_TAIL,         /* the file only grew, the bytes appended to it must be processed */
+   LOOKUP_MISS          /* the file must be processed */
+};
+
+/** \brief entry of the cache */
+struct CacheEntry {
+   char *path;                   /* absolute path of the file */
+   long size;                    /* number of bytes of the file */
+   long mtimeSec;                /* modification time of the file (seconds) */
+   long mtimeNsec;               /* modification time of the file (nanoseconds) */
+   unsigned long device;         /* device holding the file */
+   unsigned long inode;          /* inode of the file */
+   unsigned long hash;           /* hash of the content of the file (0: not hashed) */
+   long words;                   /* number of words */
+   long vowels[6];               /* number of words containing each vowel (a,e,i,o,u,y) */
+   bool resumable;               /* flag telling if the state at the end of the file is known */
+   struct TailState tail;        /* state of the text at the end of the file */
+   unsigned long headHash;       /* hash of the first TAIL_CHECK bytes of the file */
+   unsigned long endHash;        /* hash of the last TAIL_CHECK bytes of the file */
+   struct CacheEntry *next;      /* next entry of the same bucket */
+};
+
+/** \brief lookup of a file of the run */
+struct FileLookup {
+   enum LookupState state;       /* state of the lookup */
+   bool known;                   /* flag telling if the identity of the file could be read */
+   struct CacheEntry identity;   /* identity of the file (the counters are not used) */
+};
+
+/** \brief locking flag which warrants mutual exclusion on the lookups */
+static pthread_mutex_t accessCache = PTHREAD_MUTEX_INITIALIZER;
+
+/** \brief synchronization point when a lookup is done */
+static pthread_cond_t lookupDone = PTHREAD_COND_INITIALIZER;
+
+/** \brief path of the cache file */
+static char *cachePath = NULL;
+
+/** \brief flag telling if the content of the files is hashed */
+static bool useHash = false;
+
+/** \brief flag telling if the files that grew are resumed from the state at their old end */
+static bool incrementalMode = false;
+
+/** \brief hash table of the entries, indexed by the hash of the path */
+static struct CacheEntry **buckets = NULL;
+
+/** \brief number of buckets (a power of two) */
+static unsigned int nBuckets = 0;
+
+/** \brief number of entries */
+static unsigned int nEntries = 0;
+
+/** \brief lookup of each file of the run */
+static struct FileLookup *lookups = NULL;
+
+/** \brief number of files of the run */
+static int nLookups = 0;
+
+/** \brief names of the files of the run */
+static char **lookupFiles;
+
+/** \brief lookup thread */
+static pthread_t lookupThread;
+
+/** \brief flag telling if the lookup thread was started */
+static bool lookupStarted = false;
+
+/** \brief number of files reported from the cache */
+static int hits = 0;
+
+/** \brief number of files resumed from the state stored in the cache */
+static int resumes = 0;
+
+/**
+ *  \brief Lock the lookups, terminating the thread on failure.
+ */
+static void lockCache(void){
+   int status;
+
+   if ((status = pthread_mutex_lock(&accessCache)) != 0) {
+      errno = status;                                                                  /* save error in errno */
+      perror("error on entering monitor(CACHE)");
+      pthread_exit(NULL);
+   }
+}
+
+/**
+ *  \brief Unlock the lookups, terminating the thread on failure.
+ */
+static void unlockCache(void){
+   int status;
+
+   if ((status = pthread_mutex_unlock(&accessCache)) != 0) {
+      errno = status;                                                                  /* save error in errno */
+      perror("error on exiting monitor(CACHE)");
+      pthread_exit(NULL);
+   }
+}
+
+/**
+ *  \brief FNV-1a hash of a number of bytes, continuing from a previous value.
+ */
+static unsigned long fnv1a(unsigned long hash, const unsigned char *bytes, size_t n){
+   for (size_t i = 0; i < n; i++) {
+      hash = (hash ^ bytes[i]) * 0x100000001b3UL;
+   }
+   return hash;
+}
+
+/**
+ *  \brief Find the entry of a path.
+ *
+ *  \return the entry, NULL if the path is not in the cache
+ */
+static struct CacheEntry *findEntry(const char *path){
+   if (nBuckets == 0) return NULL;
+
+   unsigned long h = fnv1a(0xcbf29ce484222325UL, (const unsigned char *) path, strlen(path));
+   for (struct CacheEntry *e = buckets[h & (nBuckets - 1)]; e != NULL; e = e->next) {
+      if (strcmp(e->path, path) == 0) return e;
+   }
+   return NULL;
+}
+
+/**
+ *  \brief Insert an entry, doubling the table when it gets full.
+ *
+ *  \return 0 on success, -1 if the memory could not be allocated
+ */
+static int insertEntry(struct CacheEntry *entry){
+   if (nEntries >= nBuckets) {
+      unsigned int size = (nBuckets == 0) ? 64 : 2 * nBuckets;
+      struct CacheEntry **table = calloc(size, sizeof(struct CacheEntry *));
+
+      if (table == NULL) return -1;
+      for (unsigned int b = 0; b < nBuckets; b++) {
+         while (buckets[b] != NULL) {
+            struct CacheEntry *e = buckets[b];
+            unsigned long h = fnv1a(0xcbf29ce484222325UL, (const unsigned char *) e->path, strlen(e->path));
+
+            buckets[b] = e->next;
+            e->next = table[h & (size - 1)];
+            table[h & (size - 1)] = e;
+         }
+      }
+      free(buckets);
+      buckets = table;
+      nBuckets = size;
+   }
+
+   unsigned long h = fnv1a(0xcbf29ce484222325UL, (const unsigned char *) entry->path, strlen(entry->path));
+   entry->next = buckets[h & (nBuckets - 1)];
+   buckets[h & (nBuckets - 1)] = entry;
+   nEntries++;
+   return 0;
+}
+
+/**
+ *  \brief Load the cache from its file.
+ *
+ *  A missing cache file is an empty cache, lines that can not be parsed are dropped.
+ *
+ *  \param path path of the cache file
+ *  \param hashContent flag telling if the content of the files must be hashed
+ *  \param incremental flag telling if the files that grew are resumed from the state at their old end
+ *
+ *  \return 0 on success, -1 on error (errno is set)
+ */
+int cacheOpen(const char *path, bool hashContent, bool incremental){
+   FILE *fp;
+   char *line = NULL;
+   size_t capacity = 0;
+   ssize_t length;
+
+   if ((cachePath = strdup(path)) == NULL) return -1;
+   useHash = hashContent;
+   incrementalMode = incremental;
+
+   if ((fp = fopen(path, "r")) == NULL) return (errno == ENOENT) ? 0 : -1;
+   while ((length = getline(&line, &capacity, fp)) != -1) {
+      struct CacheEntry *e;
+      int pathStart = -1;
+
+      if (line[0] == '#') continue;
+      if (length > 0 && line[length - 1] == '\n') line[--length] = '\0';
+      if ((e = calloc(1, sizeof(struct CacheEntry))) == NULL) {
+         fclose(fp);
+         free(line);
+         return -1;
+      }
+      int resumable = 0, inWord = 0;
+      if (sscanf(line, "%ld %ld %ld %lu %lu %lx %ld %ld %ld %ld %ld %ld %ld %d %u %u %d %u %lx %lx %n", &e->size,
+                 &e->mtimeSec, &e->mtimeNsec, &e->device, &e->inode, &e->hash, &e->words, &e->vowels[0],
+                 &e->vowels[1], &e->vowels[2], &e->vowels[3], &e->vowels[4], &e->vowels[5], &resumable,
+                 &e->tail.decoder.state, &e->tail.decoder.codepoint, &inWord, &e->tail.seen, &e->headHash,
+                 &e->endHash, &pathStart) < 20) {
+         resumable = 0;                                             /* written by version 1 */
+         pathStart = -1;
+         sscanf(line, "%ld %ld %ld %lu %lu %lx %ld %ld %ld %ld %ld %ld %ld %n", &e->size, &e->mtimeSec,
+                &e->mtimeNsec, &e->device, &e->inode, &e->hash, &e->words, &e->vowels[0], &e->vowels[1],
+                &e->vowels[2], &e->vowels[3], &e->vowels[4], &e->vowels[5], &pathStart);
+      }
+      e->resumable = (resumable == 1);
+      e->tail.offset = e->size;
+      e->tail.inWord = (inWord == 1);
+      if (pathStart < 0 || line[pathStart] == '\0' || findEntry(line + pathStart) != NULL) {
+         free(e);
+         continue;
+      }
+      if ((e->path = strdup(line + pathStart)) == NULL || insertEntry(e) != 0) {
+         free(e->path);
+         free(e);
+         fclose(fp);
+         free(line);
+         return -1;
+      }
+   }
+   free(line);
+   fclose(fp);
+   return 0;
+}
+
+/**
+ *  \brief Hash a range of a file.
+ *
+ *  \return the hash of the range, 0 if it could not be read
+ */
+static unsigned long hashRange(int fd, long offset, long length){
+   unsigned char block[TAIL_CHECK];
+   unsigned long hash = 0xcbf29ce484222325UL;
+
+   while (length > 0) {
+      ssize_t n = pread(fd, block, (length < TAIL_CHECK) ? length : TAIL_CHECK, offset);
+      if (n <= 0) return 0;
+      hash = fnv1a(hash, block, n);
+      offset += n;
+      length -= n;
+   }
+   return (hash == 0) ? 1 : hash;
+}
+
+/**
+ *  \brief Read the identity of a file, hashing its content if required.
+ *
+ *  The standard input (-) and the files that are not regular files have no identity, they are always processed.
+ *
+ *  \return true on success
+ */
+static bool readIdentity(const char *file, struct CacheEntry *identity){
+   struct stat st;
+   char resolved[PATH_MAX];
+   int fd;
+
+   if (strcmp(file, "-") == 0 || stat(file, &st) == -1 || !S_ISREG(st.st_mode)) return false;
+   if (realpath(file, resolved) == NULL || (fd = open(file, O_RDONLY)) == -1) return false;
+   if (fstat(fd, &st) == -1 || (identity->path = strdup(resolved)) == NULL) {
+      close(fd);
+      return false;
+   }
+   identity->size = st.st_size;
+   identity->mtimeSec = st.st_mtim.tv_sec;
+   identity->mtimeNsec = st.st_mtim.tv_nsec;
+   identity->device = st.st_dev;
+   identity->inode = st.st_ino;
+   identity->hash = 0;
+
+   /* in incremental mode, the first and last bytes tell at the next run if the file only grew */
+   if (incrementalMode) {
+      long check = (st.st_size < TAIL_CHECK) ? st.st_size : TAIL_CHECK;
+      identity->headHash = hashRange(fd, 0, check);
+      identity->endHash = hashRange(fd, st.st_size - check, check);
+   }
+
+   if (useHash) {
+      unsigned char *block = malloc(HASH_BLOCK);
+      unsigned long hash = 0xcbf29ce484222325UL;
+      ssize_t n;
+
+      if (block == NULL) {
+         close(fd);
+         return false;
+      }
+      while ((n = read(fd, block, HASH_BLOCK)) > 0) {
+         hash = fnv1a(hash, block, n);
+      }
+      free(block);
+      if (n < 0) {
+         close(fd);
+         return false;
+      }
+      identity->hash = (hash == 0) ? 1 : hash;                    /* 0 means not hashed */
+   }
+   close(fd);
+   return true;
+}
+
+/**
+ *  \brief Check if a file only grew since its entry was stored: its first bytes and the bytes before its old end
+ *  must not have changed (a file that was truncated or rewritten is processed again from the start).
+ *
+ *  \return true if the file can be resumed from the state stored in the entry
+ */
+static bool grewFrom(const char *file, const struct CacheEntry *e){
+   long check = (e->size < TAIL_CHECK) ? e->size : TAIL_CHECK;
+   int fd;
+
+   if ((fd = open(file, O_RDONLY)) == -1) return false;
+   bool same = hashRange(fd, 0, check) == e->headHash && hashRange(fd, e->size - check, check) == e->endHash;
+   close(fd);
+   return same;
+}
+
+/**
+ *  \brief Lookup thread: checks the files in order and publishes the result of each lookup.
+ *
+ *  The cache is only read here while main processes the files, it is only changed once all files were looked up.
+ */
+static void *lookupFilesInCache(void *par){
+   (void) par;
+
+   for (int i = 0; i < nLookups; i++) {
+      struct FileLookup *lookup = &lookups[i];
+      enum LookupState state = LOOKUP_MISS;
+
+      lookup->known = readIdentity(lookupFiles[i], &lookup->identity);
+      if (lookup->known) {
+         struct CacheEntry *e = findEntry(lookup->identity.path);
+
+         if (e != NULL && e->size == lookup->identity.size && e->mtimeSec == lookup->identity.mtimeSec
+             && e->mtimeNsec == lookup->identity.mtimeNsec && e->device == lookup->identity.device
+             && e->inode == lookup->identity.inode && (!useHash || e->hash == lookup->identity.hash)) {
+            state = LOOKUP_HIT;
+         }
+         else if (incrementalMode && e != NULL && e->resumable && e->size < lookup->identity.size
+                  && e->device == lookup->identity.device && e->inode == lookup->identity.inode
+                  && grewFrom(lookupFiles[i], e)) {
+            state = LOOKUP_TAIL;
+         }
+      }
+
+      lockCache();
+      lookup->state = state;
+      pthread_cond_broadcast(&lookupDone);
+      unlockCache();
+   }
+   return NULL;
+}
+
+/**
+ *  \brief Start the thread that looks the files up in the cache.
+ *
+ *  \param nFiles number of files
+ *  \param files names of the files
+ *
+ *  \return 0 on success, -1 on error
+ */
+int cacheStartLookups(int nFiles, char **files){
+   if ((lookups = calloc(nFiles, sizeof(struct FileLookup))) == NULL) return -1;
+   nLookups = nFiles;
+   lookupFiles = files;
+   if (pthread_create(&lookupThread, NULL, lookupFilesInCache, NULL) != 0) return -1;
+   lookupStarted = true;
+   return 0;
+}
+
+/**
+ *  \brief Wait for the lookup of a file.
+ */
+static enum LookupState waitLookup(int fileId){
+   enum LookupState state;
+
+   lockCache();
+   while ((state = lookups[fileId].state) == LOOKUP_PENDING) {
+      pthread_cond_wait(&lookupDone, &accessCache);
+   }
+   unlockCache();
+   return state;
+}
+
+/**
+ *  \brief Wait for the lookup of a file and get its counters from the cache if it did not change.
+ *
+ *  Operation carried out by main.
+ *
+ *  \param fileId file identifier
+ *  \param counters counters of the file (only set on a hit)
+ *
+ *  \return true if the file can be reported from the cache
+ */
+bool cacheLookup(int fileId, struct FileCounters *counters){
+   if (waitLookup(fileId) != LOOKUP_HIT) return false;
+
+   struct CacheEntry *e = findEntry(lookups[fileId].identity.path);
+   counters->total_num_of_words = e->words;
+   for (int v = 0; v < 6; v++) {
+      counters->count_total_vowels[v] = e->vowels[v];
+   }
+   hits++;
+   return true;
+}
+
+/**
+ *  \brief After a miss, get the counters of a file from the cache and the state at its old end, if it only grew.
+ *
+ *  Operation carried out by main, after cacheLookup.
+ *
+ *  \param fileId file identifier
+ *  \param counters counters of the file up to its old end (only set when it can be resumed)
+ *  \param tail state of the text at the old end of the file (only set when it can be resumed)
+ *
+ *  \return true if only the bytes after the old end of the file must be processed
+ */
+bool cacheResume(int fileId, struct FileCounters *counters, struct TailState *tail){
+   if (waitLookup(fileId) != LOOKUP_TAIL) return false;
+
+   struct CacheEntry *e = findEntry(lookups[fileId].identity.path);
+   counters->total_num_of_words = e->words;
+   for (int v = 0; v < 6; v++) {
+      counters->count_total_vowels[v] = e->vowels[v];
+   }
+   *tail = e->tail;
+   resumes++;
+   return true;
+}
+
+/**
+ *  \brief Number of bytes of a file when it was looked up.
+ *
+ *  In incremental mode the file is processed up to this length, even if it keeps growing, so that the state stored
+ *  at its end matches its identity.
+ *
+ *  \param fileId file identifier
+ *
+ *  \return number of bytes, -1 if the identity of the file could not be read
+ */
+long cacheLength(int fileId){
+   if (waitLookup(fileId) == LOOKUP_PENDING || !lookups[fileId].known) return -1;
+   return lookups[fileId].identity.size;
+}
+
+/**
+ *  \brief Record the state of the text at the end of a file processed in incremental mode.
+ *
+ *  Operation carried out by main, after the file was split, before cacheStore.
+ *
+ *  \param fileId file identifier
+ *  \param tail state at the end of the file (its offset must be the length returned by cacheLength)
+ */
+void cacheStoreTail(int fileId, const struct TailState *tail){
+   lookups[fileId].identity.tail = *tail;
+   lookups[fileId].identity.resumable = true;
+}
+
+/**
+ *  \brief Record the counters of a file that was processed.
+ *
+ *  Operation carried out by main, after the file was processed. Files whose identity could not be read are not
+ *  stored.
+ *
+ *  \param fileId file identifier
+ *  \param counters counters of the file
+ */
+void cacheStore(int fileId, const struct FileCounters *counters){
+   struct FileLookup *lookup = &lookups[fileId];
+
+   /* the lookup thread reads the table until the last file was looked up */
+   waitLookup(nLookups - 1);
+   if (lookup->state == LOOKUP_HIT || !lookup->known || strchr(lookup->identity.path, '\n') != NULL) return;
+
+   struct CacheEntry *e = findEntry(lookup->identity.path);
+   if (e == NULL) {
+      if ((e = calloc(1, sizeof(struct CacheEntry))) == NULL || (e->path = strdup(lookup->identity.path)) == NULL
+          || insertEntry(e) != 0) {
+         perror("Failed to allocate memory");
+         exit(EXIT_FAILURE);
+      }
+   }
+   e->size = lookup->identity.size;
+   e->mtimeSec = lookup->identity.mtimeSec;
+   e->mtimeNsec = lookup->identity.mtimeNsec;
+   e->device = lookup->identity.device;
+   e->inode = lookup->identity.inode;
+   e->hash = lookup->identity.hash;
+   e->resumable = lookup->identity.resumable;
+   e->tail = lookup->identity.tail;
+   e->headHash = lookup->identity.headHash;
+   e->endHash = lookup->identity.endHash;
+   e->words = counters->total_num_of_words;
+   for (int v = 0; v < 6; v++) {
+      e->vowels[v] = counters->count_total_vowels[v];
+   }
+}
+
+/**
+ *  \brief Number of files reported from the cache.
+ */
+int cacheHits(void){
+   return hits;
+}
+
+/**
+ *  \brief Number of files resumed from the state stored in the cache.
+ */
+int cacheResumes(void){
+   return resumes;
+}
+
+/**
+ *  \brief Write the cache back to its file and release it.
+ *
+ *  The cache is written to a temporary file that then replaces the cache file, so an interrupted run leaves the
+ *  previous cache in place.
+ *
+ *  \return 0 on success, -1 on error (errno is set)
+ */
+int cacheClose(void){
+   int status = 0;
+
+   if (lookupStarted) {
+      pthread_join(lookupThread, NULL);
+      lookupStarted = false;
+   }
+
+   size_t length = strlen(cachePath);
+   char *tmpPath = malloc(length + 5);
+   FILE *fp = NULL;
+
+   if (tmpPath == NULL) status = -1;
+   else {
+      memcpy(tmpPath, cachePath, length);
+      memcpy(tmpPath + length, ".tmp", 5);
+      if ((fp = fopen(tmpPath, "w")) == NULL) status = -1;
+   }
+   if (fp != NULL) {
+      fputs(CACHE_HEADER, fp);
+      for (unsigned int b = 0; b < nBuckets; b++) {
+         for (struct CacheEntry *e = buckets[b]; e != NULL; e = e->next) {
+            fprintf(fp, "%ld %ld %ld %lu %lu %lx %ld %ld %ld %ld %ld %ld %ld %d %u %u %d %u %lx %lx %s\n", e->size,
+                    e->mtimeSec, e->mtimeNsec, e->device, e->inode, e->hash, e->words, e->vowels[0], e->vowels[1],
+                    e->vowels[2], e->vowels[3], e->vowels[4], e->vowels[5], e->resumable ? 1 : 0,
+                    e->tail.decoder.state, e->tail.decoder.codepoint, e->tail.inWord ? 1 : 0, e->tail.seen,
+                    e->headHash, e->endHash, e->path);
+         }
+      }
+      if (fclose(fp) != 0 || rename(tmpPath, cachePath) != 0) {
+         status = -1;
+         unlink(tmpPath);
+      }
+   }
+   free(tmpPath);
+
+   for (unsigned int b = 0; b < nBuckets; b++) {
+      while (buckets[b] != NULL) {
+         struct CacheEntry *e = buckets[b];
+
+         buckets[b] = e->next;
+         free(e->path);
+         free(e);
+      }
+   }
+   for (int i = 0; i < nLookups; i++) {
+      free(lookups[i].identity.path);
+   }
+   free(buckets);
+   free(lookups);
+   free(cachePath);
+   return status;
+}
@@ -0,0 +1,76 @@
+/**
+ *  \file resultCache.h (interface file)
+ *
+ *  \brief Problem name: Count Words.
+ *
+ *  Persistent cache of the counters of each file.
+ *
+ *  The cache is a text file holding, for each file processed before, its counters together with its identity: the
+ *  path, size, modification time, device and inode, and optionally a hash of its content. A lookup thread checks the
+ *  files in order while the files that changed are processed, and main asks it, file by file, if the counters of a
+ *  file can be reported from the cache. The counters of the files processed are stored back at the end of the run.
+ *
+ *  In incremental mode the cache also keeps the state of the text at the end of each file, so that a file that only
+ *  grew since it was stored (same device and inode, and the same bytes at its start and where it used to end) is
+ *  resumed from there: only the bytes appended to it are processed and added to the counters stored in the cache.
+ *
+ *  Definition of the operations:
+ *     \li cacheOpen
+ *     \li cacheStartLookups
+ *     \li cacheLookup
+ *     \li cacheResume
+ *     \li cacheLength
+ *     \li cacheStoreTail
+ *     \li cacheStore
+ *     \li cacheHits
+ *     \li cacheResumes
+ *     \li cacheClose
+ */
+
+#ifndef RESULT_CACHE_H
+#define RESULT_CACHE_H
+
+#include <stdbool.h>
+
+#include "sharedRegion.h"
+#include "cleText.h"
+
+/** \brief state of the text at some offset of a file, from where the rest of the file can be processed */
+struct TailState {
+   long offset;                  /* number of bytes of the file before the state */
+   struct State decoder;         /* utf-8 decoder at the offset */
+   bool inWord;                  /* flag telling if a word is open at the offset */
+   unsigned int seen;            /* bit v is set if vowel v was already counted in the open word */
+};
+
+/** \brief load the cache from its file (a missing file is an empty cache), returns 0 on success */
+extern int cacheOpen(const char *path, bool hashContent, bool incremental);
+
+/** \brief start the thread that looks the files up in the cache, returns 0 on success */
+extern int cacheStartLookups(int nFiles, char **files);
+
+/** \brief wait for the lookup of a file, returns true and its counters if they can be reported from the cache */
+extern bool cacheLookup(int fileId, struct FileCounters *counters);
+
+/** \brief after a miss, returns true, the counters and the state at its old end if the file only grew */
+extern bool cacheResume(int fileId, struct FileCounters *counters, struct TailState *tail);
+
+/** \brief number of bytes of a file when it was looked up, -1 if the file has no identity */
+extern long cacheLength(int fileId);
+
+/** \brief record the state at the end of a file that was processed in incremental mode */
+extern void cacheStoreTail(int fileId, const struct TailState *tail);
+
+/** \brief record the counters of a file that was processed */
+extern void cacheStore(int fileId, const struct FileCounters *counters);
+
+/** \brief number of files reported from the cache */
+extern int cacheHits(void);
+
+/** \brief number of files resumed from the state stored in the cache */
+extern int cacheResumes(void);
+
+/** \brief write the cache back to its file and release it, returns 0 on success */
+extern int cacheClose(void);
+
+#endif /* RESULT_CACHE_H */
@@ -0,0 +1,231 @@
+/**
+ *  \file sampling.c (implementation file)
+ *
+ *  \brief Problem name: Count Words.
+ *
+ *  Approximate counters of each file, estimated from a stratified random sample of its text (see sampling.h).
+ *
+ *  A file of N units with n of them sampled has stratum h made of units floor(h * N / n) to floor((h + 1) * N / n)
+ *  - 1, so the sizes N_h of the strata differ by one at most. The total of a counter is estimated by the sum of
+ *  N_h * y_h, y_h being the counter of the unit sampled in stratum h. With a single unit per stratum there is no
+ *  variance within the strata to be measured, so it is estimated from successive differences,
+ *
+ *     v = (1 - n / N) * n / (2 * (n - 1)) * sum over h >= 1 of (N_h * y_h - N_{h-1} * y_{h-1})^2,
+ *
+ *  which is conservative when the text changes slowly along the file. A file sampled whole is exact, and the
+ *  estimates (and the variances) of all files add up to the ones of all files.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+
+#include "sampling.h"
+
+/** \brief normal quantile of a two-sided 95% confidence interval */
+#define Z_95 1.959964
+
+/** \brief minimum number of units sampled of a file, so that the variance can be estimated */
+#define MIN_UNITS 2
+
+/** \brief unit sampled, with its counters once processed */
+struct SampledUnit {
+   int fileId;                /* file identifier */
+   long offset;               /* offset of the unit in its file */
+   long weight;               /* number of units of its stratum */
+   long counters[7];          /* number of words, and of words containing each vowel (a,e,i,o,u,y) */
+};
+
+/** \brief units sampled, the units of each file in order */
+static struct SampledUnit *units;
+
+/** \brief index of the first unit sampled of each file, firstUnit[numFiles] is the number of units sampled */
+static long *firstUnit;
+
+/** \brief number of units of each file */
+static long *fileUnits;
+
+/** \brief number of files */
+static int numFiles;
+
+/** \brief number of bytes of a unit */
+static long unitBytes;
+
+/** \brief fraction of the units of each file that is sampled */
+static double sampleFraction;
+
+/** \brief seed of the units picked */
+static unsigned long sampleSeed;
+
+/**
+ *  \brief Next number of a splitmix64 generator.
+ *
+ *  \param state state of the generator
+ *
+ *  \return 64 random bits
+ */
+static uint64_t nextRandom(uint64_t *state){
+
+   uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+
+   z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+   z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+   return z ^ (z >> 31);
+}
+
+int samplingInit(int nFiles, const long *fileSizes, long unitSize, double fraction, unsigned long seed){
+
+   numFiles = nFiles;
+   unitBytes = unitSize;
+   sampleFraction = fraction;
+   sampleSeed = seed;
+
+   firstUnit = malloc((nFiles + 1) * sizeof(long));
+   fileUnits = malloc(nFiles * sizeof(long));
+   if (firstUnit == NULL || fileUnits == NULL) return -1;
+
+   /* number of units sampled of each file, at least MIN_UNITS when the file has as many */
+   firstUnit[0] = 0;
+   for (int f = 0; f < nFiles; f++) {
+      long n;
+
+      fileUnits[f] = (fileSizes[f] + unitSize - 1) / unitSize;
+      n = (long) ceil(fraction * fileUnits[f]);
+      if (n < MIN_UNITS) n = MIN_UNITS;
+      if (n > fileUnits[f]) n = fileUnits[f];
+      firstUnit[f + 1] = firstUnit[f] + n;
+   }
+
+   if ((units = malloc((firstUnit[nFiles] + 1) * sizeof(struct SampledUnit))) == NULL) return -1;
+
+   /* one unit of each stratum, from a generator of the file, so that the units of a file only depend on the seed */
+   for (int f = 0; f < nFiles; f++) {
+      long n = firstUnit[f + 1] - firstUnit[f];
+      uint64_t state = seed ^ ((uint64_t) (f + 1) * 0xD1B54A32D192ED03ULL);
+
+      for (long h = 0; h < n; h++) {
+         struct SampledUnit *unit = &units[firstUnit[f] + h];
+         long lo = h * fileUnits[f] / n;
+         long hi = (h + 1) * fileUnits[f] / n;
+
+         unit->fileId = f;
+         unit->weight = hi - lo;
+         unit->offset = (lo + (long) (((unsigned __int128) nextRandom(&state) * unit->weight) >> 64)) * unitSize;
+      }
+   }
+
+   return 0;
+}
+
+long samplingUnits(void){
+
+   return firstUnit[numFiles];
+}
+
+void samplingUnit(long unit, int *fileId, long *offset){
+
+   *fileId = units[unit].fileId;
+   *offset = units[unit].offset;
+}
+
+void samplingRecord(long unit, long words, const long vowels[6]){
+
+   units[unit].counters[0] = words;
+   for (int v = 0; v < 6; v++) {
+      units[unit].counters[v + 1] = vowels[v];
+   }
+}
+
+/**
+ *  \brief Estimate the total of each counter of a file, and the variance of the estimates.
+ *
+ *  \param fileId file identifier
+ *  \param total estimated total of each counter
+ *  \param variance estimated variance of each total
+ *  \param observed sum of each counter over the units sampled
+ */
+static void estimateFile(int fileId, double total[7], double variance[7], long observed[7]){
+
+   long n = firstUnit[fileId + 1] - firstUnit[fileId];
+   struct SampledUnit *sample = &units[firstUnit[fileId]];
+
+   for (int c = 0; c < 7; c++) {
+      double sum = 0, squares = 0;
+
+      observed[c] = 0;
+      for (long h = 0; h < n; h++) {
+         double t = (double) sample[h].weight * sample[h].counters[c];
+
+         sum += t;
+         observed[c] += sample[h].counters[c];
+         if (h > 0) {
+            double d = t - (double) sample[h - 1].weight * sample[h - 1].counters[c];
+            squares += d * d;
+         }
+      }
+      total[c] = sum;
+      variance[c] = (n > 1) ? (1.0 - (double) n / fileUnits[fileId]) * n / (2.0 * (n - 1)) * squares : 0;
+   }
+}
+
+/**
+ *  \brief Print the estimated counters, with the half width of their 95% confidence intervals.
+ *
+ *  The lower end of an interval is never below the count observed in the units sampled, which the text holds for
+ *  sure, so the half width printed is the larger of both sides.
+ */
+static void printEstimate(const double total[7], const double variance[7], const long observed[7]){
+
+   long value[7], margin[7];
+
+   for (int c = 0; c < 7; c++) {
+      value[c] = lround(total[c]);
+      margin[c] = lround(ceil(Z_95 * sqrt(variance[c])));
+      if (value[c] - margin[c] < observed[c]) margin[c] = (value[c] > observed[c]) ? value[c] - observed[c] : 0;
+   }
+
+   printf("Total number of words = %ld +- %ld\n", value[0], margin[0]);
+   printf("A: %ld +- %ld   E: %ld +- %ld   I: %ld +- %ld   O: %ld +- %ld   U: %ld +- %ld   Y: %ld +- %ld\n",
+          value[1], margin[1], value[2], margin[2], value[3], margin[3], value[4], margin[4], value[5], margin[5],
+          value[6], margin[6]);
+}
+
+void samplingPrint(char **fileNames){
+
+   double allTotal[7] = {0}, allVariance[7] = {0};
+   long allObserved[7] = {0};
+   long allUnits = 0;
+
+   printf("\nApproximate counts from %g%% of the units of %ld bytes of each file (seed %lu), with 95%% confidence intervals\n",
+          100.0 * sampleFraction, unitBytes, sampleSeed);
+
+   for (int f = 0; f < numFiles; f++) {
+      double total[7], variance[7];
+      long observed[7];
+      long n = firstUnit[f + 1] - firstUnit[f];
+
+      estimateFile(f, total, variance, observed);
+      for (int c = 0; c < 7; c++) {
+         allTotal[c] += total[c];
+         allVariance[c] += variance[c];
+         allObserved[c] += observed[c];
+      }
+      allUnits += fileUnits[f];
+
+      printf("\nFile name: %s\n", fileNames[f]);
+      printf("Units sampled: %ld of %ld%s\n", n, fileUnits[f], (n == fileUnits[f]) ? " (exact)" : "");
+      printEstimate(total, variance, observed);
+   }
+
+   printf("\nAll files\n");
+   printf("Units sampled: %ld of %ld%s\n", firstUnit[numFiles], allUnits, (firstUnit[numFiles] == allUnits) ? " (exact)" : "");
+   printEstimate(allTotal, allVariance, allObserved);
+}
+
+void samplingDestroy(void){
+
+   free(units);
+   free(firstUnit);
+   free(fileUnits);
+}
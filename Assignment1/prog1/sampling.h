@@ -0,0 +1,45 @@
+/**
+ *  \file sampling.h (interface file)
+ *
+ *  \brief Problem name: Count Words.
+ *
+ *  Approximate counters of each file, estimated from a stratified random sample of its text.
+ *
+ *  Each file is divided in units of a fixed number of bytes, and its units in as many strata of consecutive units as
+ *  units to be sampled. One unit of each stratum is picked at random, with a generator seeded with the seed and the
+ *  file identifier, so a seed always samples the same units, whatever the number of workers. Before being processed,
+ *  both ends of a unit are moved forward to the byte after the next separator, so the units of a file add up to its
+ *  counters. The totals are estimated from the units sampled, and their variance from the differences between the
+ *  units of successive strata.
+ *
+ *  Definition of the operations:
+ *     \li samplingInit
+ *     \li samplingUnits
+ *     \li samplingUnit
+ *     \li samplingRecord
+ *     \li samplingPrint
+ *     \li samplingDestroy
+ */
+
+#ifndef SAMPLING_H
+#define SAMPLING_H
+
+/** \brief pick the units of nFiles files of the given sizes to be sampled, returns 0 on success */
+extern int samplingInit(int nFiles, const long *fileSizes, long unitSize, double fraction, unsigned long seed);
+
+/** \brief number of units sampled over all files */
+extern long samplingUnits(void);
+
+/** \brief file and offset of a unit sampled, the units of each file come in order */
+extern void samplingUnit(long unit, int *fileId, long *offset);
+
+/** \brief record the counters of a unit sampled, called once per unit by any thread */
+extern void samplingRecord(long unit, long words, const long vowels[6]);
+
+/** \brief print the estimated counters of each file and of all files, with their 95% confidence intervals */
+extern void samplingPrint(char **fileNames);
+
+/** \brief release the units sampled */
+extern void samplingDestroy(void);
+
+#endif /* SAMPLING_H */
@@ -5,20 +5,13 @@
 #include <pthread.h>
 #include <errno.h>
 #include <string.h>
+#include <time.h>
 
-/** \brief struct to store the information of one chunk*/
-struct Chunk {
-  int fileId;        /* file identifier */  
-  int size;    /* Number of bytes of the chunk */
-  unsigned char * chunk_pointer;  /* Pointer to the start of the chunk */
-};
-
-/** \brief struct to store the counters of a file */
-struct FileCounters {
-   char* file_name;                                   /* file name */  
-   int total_num_of_words;                            /* Number of total words */
-   int count_total_vowels[6];                         /* Number of words containing each vowel (a,e,i,o,u,y) */
-};
+#include "sharedRegion.h"
+#include "chunkRing.h"
+#include "chunkDeque.h"
+#include "chunkPool.h"
+#include "stageStats.h"
 
 /** \brief return status on monitor initialization */
 extern int statusInitMon;
@@ -35,8 +28,38 @@ static int numberOfFiles;
 /** \brief storage region for counters */
 static struct FileCounters * mem_counters;
 
+/** \brief progress of a file, to tell when its counters are complete */
+struct FileProgress {
+  long chunksDone;           /* number of chunks of the file whose results were saved */
+  long chunksExpected;       /* number of chunks the file was split in (-1: still being split) */
+};
+
+/** \brief progress of each file (only kept when the results are emitted as the files complete) */
+static struct FileProgress * mem_progress;
+
+/** \brief stream where the counters of each file are printed as soon as they are complete (NULL: printed at the end) */
+static FILE * resultStream = NULL;
+
+/** \brief function called, instead of printing, when the counters of a file are complete (NULL: none) */
+static void (*fileDone)(int fileID) = NULL;
+
+/** \brief implementation of the fifo */
+static enum FifoType fifoType = FIFO_MONITOR;
+
+/** \brief data transfer region nominal capacity (in number of values that can be stored) in the FIFO */
+static unsigned int fifoCapacity = 10;
+
+/** \brief number of workers retrieving chunks */
+static unsigned int fifoWorkers = 1;
+
 /** \brief storage region for chunks */
-static struct Chunk * mem_chunks;    // 10 -> data transfer region nominal capacity (in number of values that can be stored) in the FIFO
+static struct Chunk * mem_chunks;
+
+/** \brief lock-free ring used instead of the monitor when fifoType is FIFO_RING */
+static struct ChunkRing ring;
+
+/** \brief work-stealing deques used instead of the monitor when fifoType is FIFO_STEAL */
+static struct StealScheduler steal;
 
 /** \brief insertion pointer */
 static unsigned int ii;
@@ -53,6 +76,22 @@ static pthread_mutex_t accessCR = PTHREAD_MUTEX_INITIALIZER;
 /** \brief locking flag which warrants mutual exclusion inside the monitor */
 static pthread_mutex_t accessCR_SR = PTHREAD_MUTEX_INITIALIZER;
 
+/** \brief locking flag which warrants mutual exclusion on the chunk memory accounting */
+static pthread_mutex_t accessMem = PTHREAD_MUTEX_INITIALIZER;
+
+/** \brief main synchronization point when the chunk memory budget is exhausted */
+static pthread_cond_t memoryFreed = PTHREAD_COND_INITIALIZER;
+
+/** \brief maximum number of bytes held by the chunks in the fifo or being processed, and by main to read and split the
+           text (0: no limit) */
+static long memoryBudget = 64 * 1024 * 1024;
+
+/** \brief number of bytes held by the chunks in the fifo or being processed, and by main */
+static long memoryInUse = 0;
+
+/** \brief number of bytes held by main to read and split the text (its buffers and carries) */
+static long mainMemory = 0;
+
 /** \brief flag which warrants that the data transfer region is initialized exactly once */
 static pthread_once_t init = PTHREAD_ONCE_INIT;;
 
@@ -62,6 +101,78 @@ static pthread_cond_t fifoFull;
 /** \brief consumers synchronization point when the data transfer region is empty */
 static pthread_cond_t fifoEmpty;
 
+/** \brief time blocked on one end of the fifo, the waits still in progress included */
+struct WaitPressure {
+  long total;                /* time of the waits that ended, in nanoseconds */
+  int waiters;               /* number of threads waiting */
+  long starts;               /* sum of the instants the waits in progress started, in nanoseconds */
+};
+
+/** \brief flag signaling the time blocked on fifoFull and fifoEmpty is measured, whatever the statistics */
+static bool trackPressure = false;
+
+/** \brief time main was blocked on fifoFull */
+static struct WaitPressure fullPressure;
+
+/** \brief time the workers were blocked on fifoEmpty */
+static struct WaitPressure emptyPressure;
+
+/**
+ *  \brief Mark the start of a wait on fifoFull or fifoEmpty.
+ *
+ *  Internal monitor operation.
+ *
+ *  \param start instant the wait started
+ *  \param pressure time blocked on the end of the fifo waited on
+ */
+static inline void waitBegin (struct timespec *start, struct WaitPressure *pressure)
+{
+  if (trackPressure)
+   { clock_gettime (CLOCK_MONOTONIC, start);
+     pressure->waiters++;
+     pressure->starts += start->tv_sec * 1000000000L + start->tv_nsec;
+   }
+  else stageBegin (start);
+}
+
+/**
+ *  \brief Mark the end of a wait on fifoFull or fifoEmpty, adding its duration to the statistics and to the pressure.
+ *
+ *  Internal monitor operation.
+ *
+ *  \param slot slot of the thread in the statistics
+ *  \param stage stage of the wait
+ *  \param start instant stored by waitBegin
+ *  \param pressure time blocked on the end of the fifo waited on
+ */
+static inline void waitEnd (int slot, enum Stage stage, const struct timespec *start, struct WaitPressure *pressure)
+{
+  if (trackPressure)
+   { struct timespec end;
+
+     clock_gettime (CLOCK_MONOTONIC, &end);
+     pressure->total += (end.tv_sec - start->tv_sec) * 1000000000L + (end.tv_nsec - start->tv_nsec);
+     pressure->waiters--;
+     pressure->starts -= start->tv_sec * 1000000000L + start->tv_nsec;
+   }
+  stageEnd (slot, stage, start);
+}
+
+/**
+ *  \brief Time blocked on one end of the fifo up to now.
+ *
+ *  Internal monitor operation.
+ *
+ *  \param pressure time blocked on the end of the fifo
+ *  \param now current instant, in nanoseconds
+ *
+ *  \return number of nanoseconds
+ */
+static long waitedUntil (const struct WaitPressure *pressure, long now)
+{
+  return pressure->total + pressure->waiters * now - pressure->starts;
+}
+
 /**
  *  \brief Initialization of the data transfer region.
  *
@@ -69,7 +180,24 @@ static pthread_cond_t fifoEmpty;
  */
 static void initialization (void)
 {
-  if (((mem_chunks = malloc (10 * sizeof (struct Chunk))) == NULL))
+  if (fifoType == FIFO_RING) {
+    if (ringInit (&ring, fifoCapacity) != 0)
+     { fprintf (stderr, "error on allocating space to the data transfer region\n");
+       statusInitMon = EXIT_FAILURE;
+       pthread_exit (&statusInitMon);
+     }
+    return;
+  }
+  if (fifoType == FIFO_STEAL) {
+    if (stealInit (&steal, fifoWorkers, fifoCapacity) != 0)
+     { fprintf (stderr, "error on allocating space to the data transfer region\n");
+       statusInitMon = EXIT_FAILURE;
+       pthread_exit (&statusInitMon);
+     }
+    return;
+  }
+
+  if (((mem_chunks = malloc (fifoCapacity * sizeof (struct Chunk))) == NULL))
 	 { fprintf (stderr, "error on allocating space to the data transfer region\n");
 	   statusInitMon = EXIT_FAILURE;
 	   pthread_exit (&statusInitMon);
@@ -83,15 +211,253 @@ static void initialization (void)
 }
 
 /**
- *  \brief Store a chunk in the data transfer region.
+ *  \brief Select the implementation and the capacity of the fifo.
  *
- *  Operation carried out by main.
+ *  Operation carried out by main, before any chunk is stored or retrieved.
+ *
+ *  \param type implementation of the fifo
+ *  \param capacity number of chunks that can be stored in the fifo (in each deque, with FIFO_STEAL)
+ *  \param nWorkers number of workers retrieving chunks
+ */
+void configureFifo(enum FifoType type, unsigned int capacity, unsigned int nWorkers){
+    fifoType = type;
+    fifoCapacity = capacity;
+    fifoWorkers = nWorkers;
+}
+
+/**
+ *  \brief Emit the counters of each file as soon as they are complete.
+ *
+ *  Operation carried out by main, before the file names are stored. The results of each chunk are then saved
+ *  straight to the counters of its file, with saveChunkResults, instead of being accumulated by the workers.
+ *
+ *  \param stream stream where the counters are printed (NULL: they are only printed at the end, by printResults)
+ */
+void configureResultStream(FILE *stream){
+    resultStream = stream;
+}
+
+/**
+ *  \brief Call a function, instead of printing, when the counters of a file are complete.
+ *
+ *  Operation carried out by main, before the file names are stored. The function is called inside the monitor, by
+ *  the thread that completes the file, so it must not take long nor enter the monitor.
+ *
+ *  \param handler function called with the identification of the file complete
+ */
+void configureFileDone(void (*handler)(int fileID)){
+    fileDone = handler;
+}
+
+/**
+ *  \brief Measure the time blocked on fifoFull and fifoEmpty, even when the statistics are disabled.
+ *
+ *  Operation carried out by main, before any chunk is stored. Only the monitor fifo (FIFO_MONITOR) is measured.
+ *
+ *  \param track true to measure the time blocked
+ */
+void configureFifoPressure(bool track){
+    trackPressure = track;
+}
+
+/**
+ *  \brief Get the time blocked on fifoFull and fifoEmpty so far and the number of chunks in the fifo.
+ *
+ *  Operation carried out by the controller of the elastic pool, while main and the workers use the fifo.
+ *
+ *  \param pressure where the pressure is stored
+ */
+void getFifoPressure(struct FifoPressure *pressure){
+    int status;
+    struct timespec now;
+
+    if ((status = pthread_mutex_lock (&accessCR)) != 0){                                       /* enter monitor */
+        errno = status;                                                                /* save error in errno */
+        perror ("error on entering monitor(CF)");
+        exit (EXIT_FAILURE);
+    }
+
+    pressure->occupancy = full ? fifoCapacity : (ii + fifoCapacity - ri) % fifoCapacity;
+    pressure->capacity = fifoCapacity;
+    clock_gettime (CLOCK_MONOTONIC, &now);
+    pressure->fullNs = waitedUntil (&fullPressure, now.tv_sec * 1000000000L + now.tv_nsec);
+    pressure->emptyNs = waitedUntil (&emptyPressure, now.tv_sec * 1000000000L + now.tv_nsec);
+
+    if ((status = pthread_mutex_unlock (&accessCR)) != 0){                                     /* exit monitor */
+        errno = status;                                                                /* save error in errno */
+        perror ("error on exiting monitor(CF)");
+        exit (EXIT_FAILURE);
+    }
+}
+
+/**
+ *  \brief Get the number of chunks a worker took from the deque of another worker.
+ *
+ *  \return number of stolen chunks (0 unless the fifo is FIFO_STEAL)
+ */
+unsigned long stolenChunks(void){
+    return (fifoType == FIFO_STEAL) ? atomic_load (&steal.stolen) : 0;
+}
+
+/**
+ *  \brief Set the maximum number of bytes held by the chunks in the fifo or being processed.
+ *
+ *  Operation carried out by main, before any chunk is stored.
+ *
+ *  \param budget number of bytes (0: no limit)
+ */
+void configureMemoryBudget(long budget){
+    memoryBudget = budget;
+}
+
+/**
+ *  \brief Reserve memory in the budget, waiting while it is exhausted if asked to.
+ *
+ *  Internal operation, carried out by main. The memory is always given when no chunk is in the fifo or being
+ *  processed, since only the workers free it, so a budget smaller than a chunk and the memory of main only serializes
+ *  the chunks.
+ *
+ *  \param size number of bytes (negative: released, without waiting)
+ *  \param wait flag telling if main waits for the memory, otherwise it is not reserved when the budget is exhausted
+ *  \param byMain flag telling if the memory is held by main, to read and split the text, rather than by a chunk
+ *
+ *  \return true if the memory was reserved
+ */
+static bool reserveMemory(long size, bool wait, bool byMain){
+    if (memoryBudget == 0) return true;
+
+    if ((statusMain = pthread_mutex_lock (&accessMem)) != 0){                                  /* enter monitor */
+        errno = statusMain;                                                            /* save error in errno */
+        perror ("error on entering monitor(MEM)");
+        statusMain = EXIT_FAILURE;
+        pthread_exit (&statusMain);
+    }
+
+    bool exhausted = (size > 0) && (memoryInUse > mainMemory) && (memoryInUse + size > memoryBudget);
+    struct timespec waitStart;
+
+    if (exhausted && wait) {
+      stageBegin (&waitStart);
+      while ((memoryInUse > mainMemory) && (memoryInUse + size > memoryBudget))     /* wait for the workers to free chunks */
+      { if ((statusMain = pthread_cond_wait (&memoryFreed, &accessMem)) != 0)
+          { errno = statusMain;                                                        /* save error in errno */
+            perror ("error on waiting in memoryFreed");
+            statusMain = EXIT_FAILURE;
+            pthread_exit (&statusMain);
+          }
+      }
+      stageEnd (statsMainSlot, STAGE_BUDGET, &waitStart);
+    }
+    bool reserved = !exhausted || wait;
+    if (reserved) {
+      memoryInUse += size;
+      if (byMain) mainMemory += size;
+    }
+
+    if ((statusMain = pthread_mutex_unlock (&accessMem)) != 0){                                /* exit monitor */
+        errno = statusMain;                                                            /* save error in errno */
+        perror ("error on exiting monitor(MEM)");
+        statusMain = EXIT_FAILURE;
+        pthread_exit (&statusMain);
+    }
+
+    return reserved;
+}
+
+/**
+ *  \brief Reserve memory for a chunk, waiting while the budget is exhausted.
+ *
+ *  Internal operation, carried out by main.
  *
- *  \param buffer pointer to the start of the chunk
  *  \param size number of bytes of the chunk
- *  \param fileId file identifier
  */
-void saveChunk(unsigned char * buffer, unsigned int size, unsigned int fileId){
+static void acquireChunkMemory(long size){
+    reserveMemory(size, true, false);
+}
+
+/**
+ *  \brief Count the memory main holds to read and split the text (its buffers and carries) in the budget.
+ *
+ *  Operation carried out by main. A buffer that becomes a chunk is released first, and counted again as a chunk.
+ *
+ *  \param size number of bytes held from now on, in addition to the ones held already (negative: released)
+ *  \param wait flag telling if main waits while the budget is exhausted
+ *
+ *  \return true if the memory is held, false if the budget is exhausted and main did not wait
+ */
+bool holdMainMemory(long size, bool wait){
+    return reserveMemory(size, wait, true);
+}
+
+/**
+ *  \brief Give the buffer of a processed chunk back and return its memory to the budget.
+ *
+ *  Operation carried out by the workers.
+ *
+ *  \param workerId worker identification
+ *  \param chunk processed chunk
+ */
+void releaseChunk(unsigned int workerId, struct Chunk *chunk){
+    long held = chunk->size;
+
+    if (poolOwns (chunk->chunk_pointer)) {                                                  /* recycle pool buffers */
+      poolGive (chunk->chunk_pointer);
+      held = poolBufferSize ();
+    }
+    else free (chunk->chunk_pointer);
+    chunk->chunk_pointer = NULL;
+    if (memoryBudget == 0) return;
+
+    if ((workersStatus[workerId] = pthread_mutex_lock (&accessMem)) != 0){                     /* enter monitor */
+        errno = workersStatus[workerId];                                               /* save error in errno */
+        perror ("error on entering monitor(MEM)");
+        workersStatus[workerId] = EXIT_FAILURE;
+        pthread_exit (&workersStatus[workerId]);
+    }
+
+    memoryInUse -= held;
+    if ((workersStatus[workerId] = pthread_cond_signal (&memoryFreed)) != 0)       /* let main know that memory was freed */
+      { errno = workersStatus[workerId];                                               /* save error in errno */
+        perror ("error on signaling in memoryFreed");
+        workersStatus[workerId] = EXIT_FAILURE;
+        pthread_exit (&workersStatus[workerId]);
+      }
+
+    if ((workersStatus[workerId] = pthread_mutex_unlock (&accessMem)) != 0){                   /* exit monitor */
+        errno = workersStatus[workerId];                                               /* save error in errno */
+        perror ("error on exiting monitor(MEM)");
+        workersStatus[workerId] = EXIT_FAILURE;
+        pthread_exit (&workersStatus[workerId]);
+    }
+}
+
+/**
+ *  \brief Insert a chunk in the FIFO.
+ *
+ *  Internal monitor operation, carried out by main.
+ *
+ *  \param chunk chunk to be stored
+ */
+static void insertChunk(struct Chunk chunk){
+    if (fifoType == FIFO_RING) {                                                      /* lock-free ring, no monitor */
+        struct timespec waitStart;
+
+        pthread_once (&init, initialization);
+        stageBegin (&waitStart);
+        ringPush (&ring, chunk);
+        stageEnd (statsMainSlot, STAGE_FIFO_FULL, &waitStart);
+        return;
+    }
+    if (fifoType == FIFO_STEAL) {                                         /* work-stealing deques, no monitor */
+        struct timespec waitStart;
+
+        pthread_once (&init, initialization);
+        stageBegin (&waitStart);
+        stealPush (&steal, chunk);
+        stageEnd (statsMainSlot, STAGE_FIFO_FULL, &waitStart);
+        return;
+    }
+
     if ((statusMain = pthread_mutex_lock (&accessCR)) != 0){                                   /* enter monitor */
         errno = statusMain;                                                            /* save error in errno */
         perror ("error on entering monitor(CF)");
@@ -100,6 +466,10 @@ void saveChunk(unsigned char * buffer, unsigned int size, unsigned int fileId){
     }
     pthread_once (&init, initialization);                                              /* internal data initialization */
 
+    bool waited = full;
+    struct timespec waitStart;
+
+    if (waited) waitBegin (&waitStart, &fullPressure);
     while (full)                                                           /* wait if the data transfer region is full */
     { if ((statusMain = pthread_cond_wait (&fifoFull, &accessCR)) != 0)
         { errno = statusMain;                                                          /* save error in errno */
@@ -109,20 +479,10 @@ void saveChunk(unsigned char * buffer, unsigned int size, unsigned int fileId){
         }
     }
 
-    if (fileId == -1) mem_chunks[ii].chunk_pointer = NULL;             /* when fileId equals to -1 it means that there is no more chunks to process */
-    else{
-      unsigned char *chunk_copy = malloc(size); 
-      if (chunk_copy == NULL) {
-        perror("Failed to allocate memory for chunk_copy");
-        return;
-      }
-      memcpy(chunk_copy, buffer, size);
-      mem_chunks[ii].chunk_pointer = chunk_copy; 
-    }
+    if (waited) waitEnd (statsMainSlot, STAGE_FIFO_FULL, &waitStart, &fullPressure);
 
-    mem_chunks[ii].fileId = fileId;
-    mem_chunks[ii].size = size;                                                                      /* store value in the FIFO */
-    ii = (ii + 1) % 10;
+    mem_chunks[ii] = chunk;                                                                      /* store value in the FIFO */
+    ii = (ii + 1) % fifoCapacity;
     full = (ii == ri);
 
     if ((statusMain = pthread_cond_signal (&fifoEmpty)) != 0)      /* let a consumer know that a value has been stored */
@@ -140,6 +500,103 @@ void saveChunk(unsigned char * buffer, unsigned int size, unsigned int fileId){
     }
 }
 
+/**
+ *  \brief Store a chunk in the data transfer region.
+ *
+ *  Operation carried out by main.
+ *
+ *  \param buffer pointer to the start of the chunk
+ *  \param size number of bytes of the chunk
+ *  \param fileId file identifier
+ */
+void saveChunk(unsigned char * buffer, long size, int fileId){
+    struct Chunk chunk;
+
+    if (fileId == -1) chunk.chunk_pointer = NULL;             /* when fileId equals to -1 it means that there is no more chunks to process */
+    else{
+      acquireChunkMemory(size);                                         /* backpressure when the memory budget is exhausted */
+      unsigned char *chunk_copy = malloc(size); 
+      if (chunk_copy == NULL) {
+        perror("Failed to allocate memory for chunk_copy");
+        return;
+      }
+      memcpy(chunk_copy, buffer, size);
+      chunk.chunk_pointer = chunk_copy; 
+    }
+
+    chunk.fileId = fileId;
+    chunk.size = size;
+    chunk.offset = 0;
+    chunk.piece = NULL;
+    insertChunk(chunk);
+}
+
+/**
+ *  \brief Store a chunk held in a buffer taken from the chunk pool in the data transfer region.
+ *
+ *  Operation carried out by main. Nothing is copied, the buffer is given back to the pool by the worker that
+ *  processes the chunk. The whole buffer is counted in the memory budget, whatever the size of the chunk.
+ *
+ *  \param buffer buffer taken from the pool
+ *  \param size number of bytes of the chunk
+ *  \param fileId file identifier
+ */
+void saveChunkBuffer(unsigned char * buffer, long size, int fileId){
+    struct Chunk chunk;
+
+    acquireChunkMemory(poolBufferSize());                               /* backpressure when the memory budget is exhausted */
+    chunk.fileId = fileId;
+    chunk.size = size;
+    chunk.offset = 0;
+    chunk.chunk_pointer = buffer;
+    chunk.piece = NULL;
+    insertChunk(chunk);
+}
+
+/**
+ *  \brief Store a piece of a token longer than a buffer, held in a buffer taken from the chunk pool, in the data
+ *  transfer region.
+ *
+ *  Operation carried out by main. Like saveChunkBuffer, but the worker keeps the state of the text of the piece, so
+ *  that the pieces of the token are merged in order.
+ *
+ *  \param buffer buffer taken from the pool
+ *  \param size number of bytes of the piece
+ *  \param fileId file identifier
+ *  \param piece piece of the token
+ */
+void saveChunkPiece(unsigned char * buffer, long size, int fileId, struct TokenPiece *piece){
+    struct Chunk chunk;
+
+    acquireChunkMemory(poolBufferSize());                               /* backpressure when the memory budget is exhausted */
+    chunk.fileId = fileId;
+    chunk.size = size;
+    chunk.offset = 0;
+    chunk.chunk_pointer = buffer;
+    chunk.piece = piece;
+    insertChunk(chunk);
+}
+
+/**
+ *  \brief Store a view into a memory-mapped file in the data transfer region.
+ *
+ *  Operation carried out by main. Nothing is copied, the chunk only records where its bytes are.
+ *
+ *  \param fileId file identifier
+ *  \param offset offset of the chunk in the mapping of the file
+ *  \param size number of bytes of the chunk
+ */
+void saveChunkView(int fileId, long offset, long size){
+    struct Chunk chunk;
+
+    chunk.fileId = fileId;
+    chunk.size = size;
+    chunk.offset = offset;
+    chunk.chunk_pointer = NULL;
+    chunk.piece = NULL;
+    insertChunk(chunk);
+}
+
 /**
  *  \brief Get a chunk from the data transfer region.
  *
@@ -153,6 +610,22 @@ void saveChunk(unsigned char * buffer, unsigned int size, unsigned int fileId){
 struct Chunk retrieveChunk (unsigned int workerId)
 {
   struct Chunk chunk;                                                                               /* retrieved value */
+  struct timespec waitStart;
+
+  if (fifoType == FIFO_RING) {                                                        /* lock-free ring, no monitor */
+    pthread_once (&init, initialization);
+    stageBegin (&waitStart);
+    chunk = ringPop (&ring);
+    stageEnd (workerId, STAGE_FIFO_EMPTY, &waitStart);
+    return chunk;
+  }
+  if (fifoType == FIFO_STEAL) {                                             /* work-stealing deques, no monitor */
+    pthread_once (&init, initialization);
+    stageBegin (&waitStart);
+    chunk = stealPop (&steal, workerId);
+    stageEnd (workerId, STAGE_FIFO_EMPTY, &waitStart);
+    return chunk;
+  }
 
   if ((workersStatus[workerId] = pthread_mutex_lock (&accessCR)) != 0)                                   /* enter monitor */
      { errno = workersStatus[workerId];                                                            /* save error in errno */
@@ -162,6 +635,9 @@ struct Chunk retrieveChunk (unsigned int workerId)
      }
   pthread_once (&init, initialization);                                              /* internal data initialization */
 
+  bool waited = (ii == ri) && !full;
+
+  if (waited) waitBegin (&waitStart, &emptyPressure);
   while ((ii == ri) && !full)                                           /* wait if the data transfer region is empty */
   { if ((workersStatus[workerId] = pthread_cond_wait (&fifoEmpty, &accessCR)) != 0)
        { errno = workersStatus[workerId];                                                          /* save error in errno */
@@ -171,8 +647,10 @@ struct Chunk retrieveChunk (unsigned int workerId)
        }
   }
 
+  if (waited) waitEnd (workerId, STAGE_FIFO_EMPTY, &waitStart, &emptyPressure);
+
   chunk = mem_chunks[ri];                                                                   /* retrieve a  value from the FIFO */
-  ri = (ri + 1) % 10;
+  ri = (ri + 1) % fifoCapacity;
   full = false;
 
   if ((workersStatus[workerId] = pthread_cond_signal (&fifoFull)) != 0)       /* let the main know that a value has been retrieved */
@@ -207,7 +685,7 @@ struct Chunk retrieveChunk (unsigned int workerId)
  *  \param ys number of words with an y
  *  \param fileID file identification
  */
-void savePartialResults(unsigned int workerId, int numWords, int as, int es, int is, int os, int us, int ys, int fileID){
+void savePartialResults(unsigned int workerId, long numWords, long as, long es, long is, long os, long us, long ys, int fileID){
   if ((workersStatus[workerId] = pthread_mutex_lock (&accessCR_SR)) != 0){                                   /* enter monitor */
     errno = workersStatus[workerId];                                                            /* save error in errno */
     perror ("error on entering monitor(CF)");
@@ -231,6 +709,196 @@ void savePartialResults(unsigned int workerId, int numWords, int as, int es, int
   }
 }
 
+/**
+ *  \brief Print the counters of a file to the result stream, or hand the file to the function set for it.
+ *
+ *  Internal monitor operation, carried out when the last chunk of the file is accounted for. The stream is flushed,
+ *  so a consumer reading it gets each file at once.
+ *
+ *  \param fileID file identification
+ */
+static void emitFile(int fileID){
+  struct FileCounters *counters = &mem_counters[fileID];
+
+  if (fileDone != NULL) {
+    fileDone(fileID);
+    return;
+  }
+
+  fprintf(resultStream, "\nFile name: %s\n", counters->file_name);
+  fprintf(resultStream, "Total number of words = %ld \n", counters->total_num_of_words);
+  fprintf(resultStream, "A: %ld   E: %ld   I: %ld   O: %ld   U: %ld   Y: %ld\n", counters->count_total_vowels[0], counters->count_total_vowels[1], counters->count_total_vowels[2], counters->count_total_vowels[3], counters->count_total_vowels[4], counters->count_total_vowels[5]);
+  fflush(resultStream);
+}
+
+/**
+ *  \brief Save the results of a chunk in the data transfer region and account for the chunk.
+ *
+ *  Operation carried out by the workers (and by main, when it processes the files by itself), when the results are
+ *  emitted as the files complete. The file is emitted when this is its last chunk and it was already fully split.
+ *
+ *  \param workerId worker identification
+ *  \param numWords number of words
+ *  \param as number of words with an a
+ *  \param es number of words with an e
+ *  \param is number of words with an i
+ *  \param os number of words with an o
+ *  \param us number of words with an u
+ *  \param ys number of words with an y
+ *  \param fileID file identification
+ */
+void saveChunkResults(unsigned int workerId, long numWords, long as, long es, long is, long os, long us, long ys, int fileID){
+  if ((workersStatus[workerId] = pthread_mutex_lock (&accessCR_SR)) != 0){                                   /* enter monitor */
+    errno = workersStatus[workerId];                                                            /* save error in errno */
+    perror ("error on entering monitor(CF)");
+    workersStatus[workerId] = EXIT_FAILURE;
+    pthread_exit (&workersStatus[workerId]);
+  }
+
+  mem_counters[fileID].total_num_of_words += numWords;
+  mem_counters[fileID].count_total_vowels[0] += as;
+  mem_counters[fileID].count_total_vowels[1] += es;
+  mem_counters[fileID].count_total_vowels[2] += is;
+  mem_counters[fileID].count_total_vowels[3] += os;
+  mem_counters[fileID].count_total_vowels[4] += us;
+  mem_counters[fileID].count_total_vowels[5] += ys;
+
+  mem_progress[fileID].chunksDone++;
+  if (mem_progress[fileID].chunksDone == mem_progress[fileID].chunksExpected) {      /* last chunk of a split file */
+    emitFile(fileID);
+  }
+
+  if ((workersStatus[workerId] = pthread_mutex_unlock (&accessCR_SR)) != 0){                            /* exit monitor */
+    errno = workersStatus[workerId];                                                             /* save error in errno */
+    perror ("error on exiting monitor(CF)");
+    workersStatus[workerId] = EXIT_FAILURE;
+    pthread_exit (&workersStatus[workerId]);
+  }
+}
+
+/**
+ *  \brief Record that a file was fully split.
+ *
+ *  Operation carried out by main, after the last chunk of the file was stored in the fifo (or when the file is not
+ *  processed). The file is emitted now if the workers already accounted for all its chunks, otherwise it is emitted
+ *  by the worker that accounts for the last one. Nothing is done when the results are only printed at the end.
+ *
+ *  \param fileID file identification
+ *  \param chunks number of chunks the file was split in
+ */
+void fileSplitDone(int fileID, long chunks){
+  if (resultStream == NULL && fileDone == NULL) return;
+
+  if ((statusMain = pthread_mutex_lock (&accessCR_SR)) != 0){                                   /* enter monitor */
+    errno = statusMain;                                                            /* save error in errno */
+    perror ("error on entering monitor(CF)");
+    statusMain = EXIT_FAILURE;
+    pthread_exit (&statusMain);
+  }
+
+  mem_progress[fileID].chunksExpected = chunks;
+  if (mem_progress[fileID].chunksDone == chunks) {
+    emitFile(fileID);
+  }
+
+  if ((statusMain = pthread_mutex_unlock (&accessCR_SR)) != 0){                                /* exit monitor */
+    errno = statusMain;                                                            /* save error in errno */
+    perror ("error on exiting monitor(CF)");
+    statusMain = EXIT_FAILURE;
+    pthread_exit (&statusMain);
+  }
+}
+
+/**
+ *  \brief Set the counters of a file that is not processed.
+ *
+ *  Operation carried out by main.
+ *
+ *  \param fileID file identification
+ *  \param counters counters of the file
+ */
+void storeFileCounters(int fileID, const struct FileCounters *counters){
+  if ((statusMain = pthread_mutex_lock (&accessCR_SR)) != 0){                                   /* enter monitor */
+    errno = statusMain;                                                            /* save error in errno */
+    perror ("error on entering monitor(CF)");
+    statusMain = EXIT_FAILURE;
+    pthread_exit (&statusMain);
+  }
+
+  mem_counters[fileID].total_num_of_words = counters->total_num_of_words;
+  for (int v = 0; v < 6; v++) {
+    mem_counters[fileID].count_total_vowels[v] = counters->count_total_vowels[v];
+  }
+
+  if ((statusMain = pthread_mutex_unlock (&accessCR_SR)) != 0){                                /* exit monitor */
+    errno = statusMain;                                                            /* save error in errno */
+    perror ("error on exiting monitor(CF)");
+    statusMain = EXIT_FAILURE;
+    pthread_exit (&statusMain);
+  }
+}
+
+/**
+ *  \brief Start a file over, in the slot of a file that is complete.
+ *
+ *  Operation carried out by main, in daemon mode, before the file is split. Its counters are set to 0 and its
+ *  chunks are not accounted for yet.
+ *
+ *  \param fileID file identification
+ *  \param fileName name of the file
+ */
+void resetFile(int fileID, char *fileName){
+  if ((statusMain = pthread_mutex_lock (&accessCR_SR)) != 0){                                   /* enter monitor */
+    errno = statusMain;                                                            /* save error in errno */
+    perror ("error on entering monitor(CF)");
+    statusMain = EXIT_FAILURE;
+    pthread_exit (&statusMain);
+  }
+
+  mem_counters[fileID].file_name = fileName;
+  mem_counters[fileID].total_num_of_words = 0;
+  for (int v = 0; v < 6; v++) {
+    mem_counters[fileID].count_total_vowels[v] = 0;
+  }
+  if (mem_progress != NULL) {
+    mem_progress[fileID].chunksDone = 0;
+    mem_progress[fileID].chunksExpected = -1;
+  }
+
+  if ((statusMain = pthread_mutex_unlock (&accessCR_SR)) != 0){                                /* exit monitor */
+    errno = statusMain;                                                            /* save error in errno */
+    perror ("error on exiting monitor(CF)");
+    statusMain = EXIT_FAILURE;
+    pthread_exit (&statusMain);
+  }
+}
+
+/**
+ *  \brief Get the counters of a file.
+ *
+ *  Operation carried out by main.
+ *
+ *  \param fileID file identification
+ *  \param counters counters of the file
+ */
+void getFileCounters(int fileID, struct FileCounters *counters){
+  if ((statusMain = pthread_mutex_lock (&accessCR_SR)) != 0){                                   /* enter monitor */
+    errno = statusMain;                                                            /* save error in errno */
+    perror ("error on entering monitor(CF)");
+    statusMain = EXIT_FAILURE;
+    pthread_exit (&statusMain);
+  }
+
+  *counters = mem_counters[fileID];
+
+  if ((statusMain = pthread_mutex_unlock (&accessCR_SR)) != 0){                                /* exit monitor */
+    errno = statusMain;                                                            /* save error in errno */
+    perror ("error on exiting monitor(CF)");
+    statusMain = EXIT_FAILURE;
+    pthread_exit (&statusMain);
+  }
+}
+
 /**
  *  \brief Print all the results for all files.
  *
@@ -246,8 +914,8 @@ void printResults(){
 
   for (int i = 0; i < numberOfFiles; i++){
     printf("\nFile name: %s\n", mem_counters[i].file_name);
-    printf("Total number of words = %d \n", mem_counters[i].total_num_of_words);
-    printf("A: %d   E: %d   I: %d   O: %d   U: %d   Y: %d\n", mem_counters[i].count_total_vowels[0], mem_counters[i].count_total_vowels[1], mem_counters[i].count_total_vowels[2], mem_counters[i].count_total_vowels[3] , mem_counters[i].count_total_vowels[4], mem_counters[i].count_total_vowels[5]);
+    printf("Total number of words = %ld \n", mem_counters[i].total_num_of_words);
+    printf("A: %ld   E: %ld   I: %ld   O: %ld   U: %ld   Y: %ld\n", mem_counters[i].count_total_vowels[0], mem_counters[i].count_total_vowels[1], mem_counters[i].count_total_vowels[2], mem_counters[i].count_total_vowels[3] , mem_counters[i].count_total_vowels[4], mem_counters[i].count_total_vowels[5]);
   }
 
   if ((statusMain= pthread_mutex_unlock (&accessCR_SR)) != 0){                                /* exit monitor */
@@ -283,6 +951,13 @@ void processFileName(int nFiles, char **files, char *fileNames[]){
   }
 
   mem_counters = malloc(numberOfFiles * sizeof(struct FileCounters));
+  if (resultStream != NULL || fileDone != NULL) {
+    mem_progress = malloc(numberOfFiles * sizeof(struct FileProgress));
+    for (int i=0; i<numberOfFiles; i++) {
+      mem_progress[i].chunksDone = 0;
+      mem_progress[i].chunksExpected = -1;
+    }
+  }
 
   for (int i=0; i<numberOfFiles; i++) {
     mem_counters[i].file_name = fileNames[i];
@@ -1,11 +1,60 @@
 #ifndef SHARED_REGION_H
 #define SHARED_REGION_H
 
-extern void saveChunk(char * buffer, unsigned int size, unsigned int fileId);
+#include <stdio.h>
+#include <stdbool.h>
+
+/** \brief piece of a token longer than a buffer (defined by the program that splits the text) */
+struct TokenPiece;
+
+/** \brief implementations of the chunk fifo */
+enum FifoType {
+   FIFO_MONITOR,      /* array protected by a monitor (mutex and condition variables) */
+   FIFO_RING,         /* lock-free bounded ring (see chunkRing.h) */
+   FIFO_STEAL         /* one work-stealing deque per worker (see chunkDeque.h) */
+};
+
+extern void configureFifo(enum FifoType type, unsigned int capacity, unsigned int nWorkers);
+
+extern unsigned long stolenChunks(void);
+
+extern void configureMemoryBudget(long budget);
+
+extern bool holdMainMemory(long size, bool wait);
+
+extern void saveChunk(unsigned char * buffer, long size, int fileId);
+
+extern void saveChunkBuffer(unsigned char * buffer, long size, int fileId);
+
+extern void saveChunkView(int fileId, long offset, long size);
+
+extern void saveChunkPiece(unsigned char * buffer, long size, int fileId, struct TokenPiece *piece);
 
 extern struct Chunk retrieveChunk (unsigned int workerId);
 
-extern void savePartialResults(unsigned int workerId, int numWords, int as, int es, int is, int os, int us, int ys, int fileID);
+extern void releaseChunk(unsigned int workerId, struct Chunk *chunk);
+
+extern void savePartialResults(unsigned int workerId, long numWords, long as, long es, long is, long os, long us, long ys, int fileID);
+
+extern void configureResultStream(FILE *stream);
+
+extern void saveChunkResults(unsigned int workerId, long numWords, long as, long es, long is, long os, long us, long ys, int fileID);
+
+extern void fileSplitDone(int fileID, long chunks);
+
+extern void configureFileDone(void (*handler)(int fileID));
+
+/** \brief struct to store the pressure on the monitor fifo, to size the elastic pool of workers */
+struct FifoPressure {
+   long fullNs;                /* time main was blocked on fifoFull since the start, waits in progress included (ns) */
+   long emptyNs;               /* time the workers were blocked on fifoEmpty since the start, added up (ns) */
+   unsigned int occupancy;     /* number of chunks in the fifo */
+   unsigned int capacity;      /* number of chunks that can be stored in the fifo */
+};
+
+extern void configureFifoPressure(bool track);
+
+extern void getFifoPressure(struct FifoPressure *pressure);
 
 extern void printResults();
 
@@ -14,15 +63,23 @@ extern void processFileName(int argc, char **files, char *fileNames[]);
 /** \brief struct to store the information of one chunk*/
 struct Chunk {
    int fileId;        /* file identifier */  
-   int size;    /* Number of bytes of the chunk */
+   long size;         /* Number of bytes of the chunk */
+   long offset;       /* Offset of the chunk in the mapped file (only used when chunk_pointer is NULL) */
    unsigned char * chunk_pointer;  /* Pointer to the start of the chunk */
-} Chunk;
+   struct TokenPiece * piece;      /* Piece of a token longer than a buffer the chunk holds (NULL: it starts and ends between words) */
+};
 
 /** \brief struct to store the counters of a file */
 struct FileCounters {
    char* file_name;                                   /* file name */  
-   int total_num_of_words;                            /* Number of total words */
-   int count_total_vowels[6];                         /* Number of words containing each vowel (a,e,i,o,u,y) */
-} FileCounters;
+   long total_num_of_words;                           /* Number of total words */
+   long count_total_vowels[6];                        /* Number of words containing each vowel (a,e,i,o,u,y) */
+};
+
+extern void storeFileCounters(int fileID, const struct FileCounters *counters);
+
+extern void resetFile(int fileID, char *fileName);
+
+extern void getFileCounters(int fileID, struct FileCounters *counters);
 
 #endif
@@ -0,0 +1,52 @@
+/**
+ *  \file spinWait.h (interface file)
+ *
+ *  \brief Problem name: Count Words.
+ *
+ *  Helpers of the lock-free fifos to spin for a while and then sleep on a futex word.
+ */
+
+#ifndef SPIN_WAIT_H
+#define SPIN_WAIT_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+
+/** \brief number of failed attempts before a thread goes to sleep on the futex (on multiprocessors) */
+#define SPIN_LIMIT 256
+
+/**
+ *  \brief Get the number of failed attempts before sleeping: 0 on a single processor, where nobody can make progress
+ *  while we spin.
+ */
+static inline int spinLimit(void){
+   return (sysconf(_SC_NPROCESSORS_ONLN) > 1) ? SPIN_LIMIT : 0;
+}
+
+/**
+ *  \brief Hint the processor that the thread is spinning.
+ */
+static inline void cpuRelax(void){
+#if defined(__x86_64__) || defined(__i386__)
+   __builtin_ia32_pause();
+#endif
+}
+
+/**
+ *  \brief Sleep while the futex word still holds the given value.
+ */
+static inline void futexWait(atomic_uint *word, unsigned int value){
+   syscall(SYS_futex, (uint32_t *) word, FUTEX_WAIT_PRIVATE, value, NULL, NULL, 0);
+}
+
+/**
+ *  \brief Wake up to n threads sleeping on the futex word.
+ */
+static inline void futexWake(atomic_uint *word, int n){
+   syscall(SYS_futex, (uint32_t *) word, FUTEX_WAKE_PRIVATE, n, NULL, NULL, 0);
+}
+
+#endif /* SPIN_WAIT_H */
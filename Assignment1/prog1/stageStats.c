@@ -0,0 +1,92 @@
+/**
+ *  \file stageStats.c (implementation file)
+ *
+ *  \brief Problem name: Count Words.
+ *
+ *  Per-thread time spent in each stage of the text pipeline (see stageStats.h).
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "stageStats.h"
+
+/** \brief flag telling if the statistics are recorded */
+bool statsEnabled = false;
+
+/** \brief slot of main */
+int statsMainSlot = 0;
+
+/** \brief slots of all threads */
+struct StageCounters *stageCounters = NULL;
+
+/** \brief column titles of the stages */
+static const char *stageNames[NUM_STAGES] = {"read", "split", "budget", "fifoFull", "fifoEmpty", "process", "save"};
+
+/**
+ *  \brief Allocate the slots and enable the statistics.
+ *
+ *  \param nWorkers number of workers
+ *
+ *  \return 0 on success, -1 if the memory could not be allocated
+ */
+int statsInit(unsigned int nWorkers){
+   size_t size = (nWorkers + 1) * sizeof(struct StageCounters);
+
+   if ((stageCounters = aligned_alloc(64, size)) == NULL) return -1;
+   memset(stageCounters, 0, size);
+   statsMainSlot = nWorkers;
+   statsEnabled = true;
+   return 0;
+}
+
+/**
+ *  \brief Print a line of the breakdown table.
+ */
+static void printLine(FILE *out, const char *name, const struct StageCounters *counters){
+   fprintf(out, "%-10s", name);
+   for (int s = 0; s < NUM_STAGES; s++) {
+      fprintf(out, " %10.6f", counters->ns[s] * 1e-9);
+   }
+   fprintf(out, " %8ld %12ld\n", counters->chunks, counters->bytes);
+}
+
+/**
+ *  \brief Print the time spent by each thread in each stage, in seconds, followed by the totals of the workers.
+ *
+ *  Must only be called after the workers terminate.
+ *
+ *  \param out stream where the table is printed
+ */
+void statsPrint(FILE *out){
+   struct StageCounters total;
+   char name[24];
+
+   memset(&total, 0, sizeof(total));
+   fprintf(out, "%-10s", "thread");
+   for (int s = 0; s < NUM_STAGES; s++) {
+      fprintf(out, " %10s", stageNames[s]);
+   }
+   fprintf(out, " %8s %12s\n", "chunks", "bytes");
+
+   printLine(out, "main", &stageCounters[statsMainSlot]);
+   for (int i = 0; i < statsMainSlot; i++) {
+      snprintf(name, sizeof(name), "worker %d", i);
+      printLine(out, name, &stageCounters[i]);
+      for (int s = 0; s < NUM_STAGES; s++) {
+         total.ns[s] += stageCounters[i].ns[s];
+      }
+      total.chunks += stageCounters[i].chunks;
+      total.bytes += stageCounters[i].bytes;
+   }
+   printLine(out, "workers", &total);
+}
+
+/**
+ *  \brief Release the slots and disable the statistics.
+ */
+void statsDestroy(void){
+   statsEnabled = false;
+   free(stageCounters);
+   stageCounters = NULL;
+}
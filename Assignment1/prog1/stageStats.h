@@ -0,0 +1,102 @@
+/**
+ *  \file stageStats.h (interface file)
+ *
+ *  \brief Problem name: Count Words.
+ *
+ *  Per-thread time spent in each stage of the text pipeline.
+ *
+ *  Each thread owns a slot (the workers their id, main the slot after the last worker), so recording takes no lock.
+ *  When the statistics are disabled, stageBegin and stageEnd do nothing.
+ *
+ *  Definition of the operations:
+ *     \li statsInit
+ *     \li stageBegin
+ *     \li stageEnd
+ *     \li statsCountChunk
+ *     \li statsPrint
+ *     \li statsDestroy
+ */
+
+#ifndef STAGE_STATS_H
+#define STAGE_STATS_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <time.h>
+
+/** \brief stages of the text pipeline */
+enum Stage {
+   STAGE_READ,          /* reading the files */
+   STAGE_SPLIT,         /* looking for the separators where the chunks end */
+   STAGE_BUDGET,        /* blocked on the chunk memory budget */
+   STAGE_FIFO_FULL,     /* blocked on fifoFull */
+   STAGE_FIFO_EMPTY,    /* blocked on fifoEmpty */
+   STAGE_PROCESS,       /* counting the words of the chunks */
+   STAGE_SAVE,          /* saving the partial results */
+   NUM_STAGES
+};
+
+/** \brief statistics of one thread, padded to a cache line so that no two threads share one */
+struct StageCounters {
+   _Alignas(64) long ns[NUM_STAGES];   /* nanoseconds spent in each stage */
+   long chunks;                        /* number of chunks processed */
+   long bytes;                         /* number of bytes processed */
+};
+
+/** \brief flag telling if the statistics are recorded */
+extern bool statsEnabled;
+
+/** \brief slot of main */
+extern int statsMainSlot;
+
+/** \brief slots of all threads */
+extern struct StageCounters *stageCounters;
+
+/** \brief allocate the slots of nWorkers workers and main and enable the statistics, returns 0 on success */
+extern int statsInit(unsigned int nWorkers);
+
+/** \brief print the breakdown table */
+extern void statsPrint(FILE *out);
+
+/** \brief release the slots */
+extern void statsDestroy(void);
+
+/**
+ *  \brief Mark the beginning of a stage.
+ *
+ *  \param start where to store the instant
+ */
+static inline void stageBegin(struct timespec *start){
+   if (statsEnabled) clock_gettime(CLOCK_MONOTONIC, start);
+}
+
+/**
+ *  \brief Mark the end of a stage, adding its duration to the slot of the thread.
+ *
+ *  \param slot slot of the thread
+ *  \param stage stage that ended
+ *  \param start instant stored by stageBegin
+ */
+static inline void stageEnd(int slot, enum Stage stage, const struct timespec *start){
+   if (statsEnabled) {
+      struct timespec end;
+
+      clock_gettime(CLOCK_MONOTONIC, &end);
+      stageCounters[slot].ns[stage] += (end.tv_sec - start->tv_sec) * 1000000000L + (end.tv_nsec - start->tv_nsec);
+   }
+}
+
+/**
+ *  \brief Count a processed chunk in the slot of the thread.
+ *
+ *  \param slot slot of the thread
+ *  \param bytes number of bytes of the chunk
+ */
+static inline void statsCountChunk(int slot, long bytes){
+   if (statsEnabled) {
+      stageCounters[slot].chunks++;
+      stageCounters[slot].bytes += bytes;
+   }
+}
+
+#endif /* STAGE_STATS_H */
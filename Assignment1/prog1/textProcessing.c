@@ -2,20 +2,59 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include <unistd.h>
+#include <getopt.h>
 #include <pthread.h>
 #include <errno.h>
 #include <string.h>
 #include <ctype.h>
 #include <time.h>
+#include <stdatomic.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "sharedRegion.h"
+#include "chunkPool.h"
+#include "stageStats.h"
+#include "asyncReader.h"
+#include "resultCache.h"
+#include "wordFreq.h"
+#include "sampling.h"
+#include "requestServer.h"
+#include "elasticPool.h"
+#include "cleText.h"
 #include "textProcessingFunctions.h"
 
 /** \brief struct to manage the variables of a chunk*/
 struct ParRes{
-   int numberOfWords;  /* Total number of words*/
-   int vowelWords[6];  /* Number of words containing each vowel (a,e,i,o,u,y) */
-   int fileID;         /* File id of the chunk */
+   long numberOfWords;  /* Total number of words*/
+   long vowelWords[6];  /* Number of words containing each vowel (a,e,i,o,u,y) */
+   int fileID;          /* File id of the chunk */
+};
+
+/** \brief counters of one file accumulated by a worker, padded to a cache line so that no two workers share one */
+struct LocalCounters {
+   _Alignas(64) long numberOfWords;  /* Total number of words */
+   long vowelWords[6];              /* Number of words containing each vowel (a,e,i,o,u,y) */
+};
+
+/** \brief piece of a token longer than a buffer: each piece is processed into a state of its own, and the states of
+           all pieces of the token are merged in order, so a word divided between two pieces is counted once */
+struct TokenPiece {
+   struct cle_text text;      /* state of the text of the piece, once processed */
+   struct TokenPiece *next;   /* next piece of the token (not set for the last one) */
+   struct TokenRun *run;      /* token of the piece */
+   bool last;                 /* flag telling if it is the last piece of the token */
+   bool inWord;               /* flag telling if the piece starts in a word, cut from the previous piece */
+};
+
+/** \brief token longer than a buffer, handed to the workers in pieces */
+struct TokenRun {
+   struct TokenPiece *first;  /* first piece */
+   long count;                /* number of pieces split so far (only used by main) */
+   atomic_long done;          /* number of pieces processed */
+   atomic_long pieces;        /* number of pieces, set with the last one (0: still being split) */
 };
 
 /* Id of the file from where the chunk is */
@@ -24,41 +63,348 @@ int fileID;
 /* Variable crated for the purpose of knowing if the file was opened*/
 bool openFile;
 
+/** \brief chunk size set with -c (0: picked from the size of each file and adjusted at runtime) */
+static long chunkSize = 0;
+
+/** \brief number of worker threads */
+static int nWorkers;
+
+/** \brief nanoseconds spent by the workers processing chunks (only measured when the chunk size is adaptive) */
+static atomic_long processingTime;
+
+/** \brief nanoseconds spent by the workers waiting for chunks (only measured when the chunk size is adaptive) */
+static atomic_long waitingTime;
+
+/** \brief chunk size used by the producer for the file being split */
+struct ChunkSizer {
+   long size;                 /* current chunk size */
+   long initialSize;          /* chunk size picked for the file */
+   long chunks;               /* number of chunks generated */
+   long lastProcessing;       /* value of processingTime at the last adjustment */
+   long lastWaiting;          /* value of waitingTime at the last adjustment */
+};
+
+/** \brief chunk sizes used for each file, reported with -v */
+static struct ChunkSizer *chunkSizers;
+
+/** \brief number of reads in flight with the asynchronous reader (0: the files are read one after the other) */
+static int readDepth = 0;
+
+/** \brief engine of the asynchronous reader */
+static enum ReaderEngine readEngine = READER_AUTO;
+
+/** \brief maximum number of reads in flight of one file with the asynchronous reader */
+#define READS_PER_FILE 4
+
+/** \brief total size of the input up to which main processes the files by itself, unless it is set with -T (starting
+           the workers and going through the fifo costs about 1 ms, what a single thread needs for 100 to 600 KiB of
+           text, depending on how much of it is ascii) */
+#define DIRECT_THRESHOLD (256 * 1024)
+
+/** \brief read of a block of a file by the asynchronous reader */
+struct BlockRead {
+   struct ReadRequest request;    /* must come first, the reader gives the request back on completion */
+   unsigned char *buffer;         /* pool buffer, the block is read into its second half */
+   long size;                     /* number of bytes of the block */
+   long filled;                   /* number of bytes read so far */
+   int slot;                      /* slot of the file in the open files */
+   long sequence;                 /* number of the block in its file */
+   struct BlockRead *next;        /* link of the free blocks */
+};
+
+/** \brief file being read by the asynchronous reader */
+struct OpenFile {
+   int fileId;                                /* file identifier (-1: slot free) */
+   int fd;                                    /* file descriptor */
+   long size;                                 /* number of bytes of the file */
+   long nextOffset;                           /* offset of the next block to be read */
+   long nextSequence;                         /* number of the next block to be read */
+   long expected;                             /* number of the next block to be split */
+   int inFlight;                              /* blocks read and not yet split */
+   struct BlockRead *ready[READS_PER_FILE];   /* completed blocks waiting for the previous ones to be split */
+   unsigned char *carry;                      /* bytes after the last boundary of the blocks split so far (half a buffer) */
+   long carrySize;                            /* number of bytes of carry */
+   struct TokenPiece *piece;                  /* last piece stored of a token longer than the carry (NULL: none) */
+   bool inWord;                               /* flag telling if the last piece was cut in a word */
+};
+
+/** \brief text file being split into chunks by main, read from start to end */
+struct TextSplit {
+   FILE *file;                                /* file being split */
+   int fileId;                                /* file identifier */
+   off_t fileSize;                            /* number of bytes to be split (LONG_MAX: unknown, as for pipes) */
+   off_t left;                                /* bytes still to be read */
+   off_t consumed;                            /* bytes of the file stored in the fifo */
+   unsigned char *buffer;                     /* pool buffer the next chunk is read into, after the bytes carried */
+   long carrySize;                            /* bytes at the start of the buffer carried from the last read */
+   struct TokenPiece *piece;                  /* last piece stored of a token longer than a buffer (NULL: none) */
+   bool inWord;                               /* flag telling if the last piece was cut in a word */
+   long chunks;                               /* number of chunks generated */
+};
+
+/** \brief print statistics of the run to stderr */
+static bool verbose = false;
+
+/** \brief file of the result cache (NULL: every file is processed) */
+static char *cacheFile = NULL;
+
+/** \brief flag telling if the result cache also checks a hash of the content of the files */
+static bool hashFiles = false;
+
+/** \brief flag telling if the files that grew since they were stored in the result cache are resumed from there */
+static bool incremental = false;
+
+/** \brief number of bytes read at a time by main around the ends of the part of a file processed incrementally */
+#define TAIL_BLOCK 4096
+
+/** \brief number of most frequent words printed for each file and for all files (0: no word frequencies) */
+static int topWords = 0;
+
+/** \brief total size of the input up to which main processes the files by itself (0: never) */
+static long directThreshold = DIRECT_THRESHOLD;
+
+/** \brief flag signaling that the input is small enough to be processed by main alone, with no worker threads */
+static bool directInput = false;
+
+/** \brief stream where the counters of each file are printed as soon as it is complete, set with -e (NULL: at the end) */
+static FILE *resultStream = NULL;
+
+/** \brief Unix domain socket where the daemon takes requests, set with -d (NULL: the files of -f are processed once) */
+static char *socketPath = NULL;
+
+/** \brief number of files the daemon processes at the same time, over all requests (the slots of the shared region) */
+#define DAEMON_SLOTS 1024
+
+/** \brief number of files the daemon splits at the same time, each holding a chunk buffer between its turns */
+#define DAEMON_SPLITS 16
+
+/** \brief number of chunks the daemon splits of a file in each turn, before polling the requests again */
+#define DAEMON_TURN 4
+
+/** \brief smallest number of workers taking chunks, set with -E */
+static int elasticMin = 0;
+
+/** \brief largest number of workers taking chunks, set with -E, the number of workers created (0: the pool is fixed) */
+static int elasticMax = 0;
+
+/** \brief fraction of each file sampled to estimate its counters, set with --approx (0: exact counters) */
+static double approxFraction = 0;
+
+/** \brief seed of the units sampled, set with --seed */
+static unsigned long approxSeed = 1;
+
+/** \brief values of the options that only have a long name */
+enum LongOption {
+   OPTION_APPROX = 256,       /* --approx fraction */
+   OPTION_SEED                /* --seed number */
+};
+
 /** \brief worker threads return status array */
 int *workersStatus;
 
 /** \brief main thread return status */
 int statusMain;
 
+/** \brief return status on monitor initialization */
+int statusInitMon;
+
+/** \brief flag signaling that the input files are memory-mapped instead of copied into chunks */
+static bool mapFiles = false;
+
+/** \brief base address of the mapping of each input file (only used when mapFiles is set) */
+static unsigned char **mappedFiles;
+
+/** \brief size in bytes of the mapping of each input file */
+static long *mappedSizes;
+
+/** \brief per worker counters, worker w keeps the counters of file f in workerCounters[w * numFiles + f] */
+static struct LocalCounters *workerCounters;
+
+/** \brief number of files being processed */
+static int numFiles;
+
+/** \brief flag signaling that the workers split the files themselves, claiming byte ranges of RANGE_SIZE bytes */
+static bool parallelSplit = false;
+
+/** \brief file descriptor of each input file (only used when parallelSplit is set or the files are sampled) */
+static int *fileDescriptors;
+
+/** \brief size in bytes of each input file (only used when parallelSplit is set or the files are sampled) */
+static long *fileSizes;
+
+/** \brief index of the first range of each file, firstRange[numFiles] is the total number of ranges */
+static long *firstRange;
+
+/** \brief statistics of each range, merged in order by main once all ranges are processed */
+static struct cle_text *rangeTexts;
+
+/** \brief next range to be claimed by a worker */
+static atomic_long rangeCursor;
+
+/** \brief number of chunks after which a worker flushes its counters to the shared region (0: only at the end) */
+static int flushPeriod = 0;
+
+/** \brief flag signaling that the files are scheduled by size, the largest first and the small ones as a single chunk */
+static bool sizeAware = false;
+
+/** \brief largest file handed to the workers as a single chunk (only used when sizeAware is set) */
+static long smallFileSize;
+
+/** \brief order in which the files are split, fileOrder[k] is the identifier of the k-th file */
+static int *fileOrder;
+
+/** \brief size in bytes of each input file, used to sort them (LONG_MAX: unknown, as for pipes) */
+static long *scheduleSizes;
+
 /** \brief worker life cycle routine */
 static void *worker(void *par);
 
 /** \brief function to process each chunk */
-static void processTextChunk(unsigned char * chunk_pointer, int size, struct ParRes * partialResults);
+static void processTextChunk(unsigned char * chunk_pointer, long size, struct ParRes * partialResults);
+
+/** \brief function to process each chunk, also counting its words in the word frequencies when they are on */
+static void processWordsChunk(unsigned int workerId, unsigned char * chunk_pointer, long size, int fileId, struct ParRes * partialResults);
+
+/** \brief function to store the counters of a text in a partial results struct */
+static void storeCounts(const struct cle_text_counts *counts, struct ParRes * partialResults);
+
+/** \brief function to process a piece of a token longer than a buffer, returns true once the whole token is counted */
+static bool processPiece(unsigned char * chunk_pointer, long size, struct TokenPiece *piece, struct ParRes * partialResults);
+
+/** \brief function to start the next piece of a token longer than a buffer */
+static struct TokenPiece *nextPiece(struct TokenPiece *previous, bool last, bool inWord);
+
+/** \brief function to take a pool buffer for main, counted in the memory budget */
+static unsigned char *takeBuffer(void);
+
+/** \brief function to give a buffer of main back to the pool */
+static void giveBuffer(unsigned char *buffer);
+
+/** \brief function to hand a buffer of main to the workers, as a chunk or as a piece of a token */
+static void handOver(unsigned char *chunk, long size, int fileId, struct TokenPiece *piece);
+
+/** \brief function to open the files and compute their ranges, when the workers split the files themselves */
+static void prepareFileRanges(int nFiles, char **files);
+
+/** \brief function where a worker claims and processes byte ranges of the files */
+static void processFileRanges(unsigned int workerId);
+
+/** \brief function to read a range of a file */
+static void readRange(int fd, unsigned char *buffer, long size, long offset);
+
+/** \brief function to merge the statistics of the ranges of each file */
+static void mergeFileRanges(void);
+
+/** \brief function to open the files and pick the units sampled of each one, with --approx */
+static void prepareSamples(int nFiles, char **files);
+
+/** \brief function where a worker claims and processes the units sampled */
+static void processSamples(unsigned int workerId);
+
+/** \brief function where main serves the requests of the daemon mode */
+static void serveRequests(void);
+
+/** \brief function to find the offset right after the first separator at or after an offset of a file */
+static long unitBoundary(int fd, long offset, long fileSize);
 
 /** \brief function created to check the next chunk of text, and returns true if it was successful */
 static bool readTextChunk(struct Chunk * chunk, struct ParRes * parRes, int workerID);
 
+/** \brief function to pick the chunk size of a file */
+static void initChunkSizer(struct ChunkSizer *sizer, long fileSize);
+
+/** \brief function to adjust the chunk size from the time the workers spend processing and waiting */
+static void adjustChunkSize(struct ChunkSizer *sizer, long remaining);
+
+/** \brief function to report a file from the result cache, returns true if it does not need to be processed */
+static bool reportFromCache(int fileId);
+
+/** \brief function to generate the chunks of all files */
+static void produceChunks(int nFiles, char **files);
+
+/** \brief function to get the total size of the input, up to a limit */
+static long inputSize(int nFiles, char **files, long limit);
+
+/** \brief function where main processes a small input by itself */
+static void processDirectly(int nFiles, char **files);
+
+/** \brief function to pick the order in which the files are split */
+static void scheduleFiles(int nFiles, char **files);
+
+/** \brief function to compare two files by size, for qsort */
+static int compareFileSizes(const void *a, const void *b);
+
+/** \brief function to check if a file name stands for the standard input */
+static bool isStandardInput(const char *name);
+
+/** \brief function to check if a file can only be read once */
+static bool isStream(const char *name);
+
 /** \brief function to split the text file into chunks */
-int splitTextIntoChunks(FILE * file, char **chunks);
+long splitTextIntoChunks(FILE * file, int fileId, off_t length);
+
+/** \brief function to start splitting a text file into chunks */
+static void splitStart(struct TextSplit *split, FILE *file, int fileId, off_t length);
+
+/** \brief function to split a text file into chunks, up to a number of chunks, returns true once the whole file is split */
+static bool splitChunks(struct TextSplit *split, long maxChunks);
+
+/** \brief function to resume a file from the state stored in the result cache */
+static off_t resumeFile(int fileId, int fd, off_t limit, struct TailState *start);
 
-/** \brief function that returns the Unicode code points for the characters in the chunk */
-int f_getc(unsigned char **chunk_pointer, struct State *state);
+/** \brief function to record the state at the end of a file in the result cache */
+static void recordFileEnd(int fileId, int fd, const struct TailState *start, off_t limit);
 
-/** \brief function that check what vowel a byte is */
-char is_vowel(int c);
+/** \brief function to set up the statistics of a text from a state stored in the result cache */
+static void restoreTailState(struct cle_text *text, const struct TailState *state);
 
-/** \brief function to check if a byte is a alpha numeric one*/
-int is_alpha_numeric(int c, bool inWord);
+/** \brief function to read the files with the asynchronous reader and generate their chunks */
+static void produceChunksAsync(int nFiles, char **files);
+
+/** \brief function to split a block read by the asynchronous reader into a chunk */
+static void splitBlock(struct OpenFile *file, struct BlockRead *block);
+
+/** \brief function to add partial results to the counters of a worker */
+static void addWorkerCounters(unsigned int workerId, struct ParRes *parRes);
+
+/** \brief function to add the counters of a worker to the shared region */
+static void flushWorkerCounters(unsigned int workerId);
+
+/** \brief function to split a memory-mapped file into chunk views */
+static long splitMappedFile(unsigned char *map, long file_size, int fileId);
 
 /** \brief execution time measurement */
 static double get_delta_time(void);
 
+/** \brief nanoseconds between two instants */
+static long elapsedNs(const struct timespec *from, const struct timespec *to);
+
+/** \brief parse a number of bytes with an optional k/M/G suffix */
+static long parseSize(const char *text);
+
 /** \brief print command usage */
 static void printUsage (char *cmdName);
 
-/** \brief number of worker threads */
-#define CHUNK_SIZE 4096
+/** \brief number of worker threads when it is not set with -t */
+#define DEFAULT_THREADS 4
+
+/** \brief smallest chunk size picked by the adaptive chunk sizing */
+#define MIN_CHUNK_SIZE 4096
+
+/** \brief largest chunk size picked by the adaptive chunk sizing */
+#define MAX_CHUNK_SIZE (1024 * 1024)
+
+/** \brief number of chunks of each file per worker aimed at by the adaptive chunk sizing */
+#define CHUNKS_PER_WORKER 8
+
+/** \brief number of chunks between two adjustments of the chunk size */
+#define ADJUST_PERIOD 16
+
+/** \brief number of bytes of the ranges claimed by the workers when they split the files themselves */
+#define RANGE_SIZE (64 * 1024)
+
+/** \brief largest file handed to the workers as a single chunk when the files are scheduled by size */
+#define SMALL_FILE_SIZE (64 * 1024)
 
 /*  */
 int main(int argc, char *argv[]){
@@ -67,8 +413,17 @@ int main(int argc, char *argv[]){
    int nThreads = 0;
    char **files = NULL;
    int nFiles = 0;
+   enum FifoType fifoType = FIFO_MONITOR;
+   int fifoCapacity = 10;
+   long memoryBudget = 64 * 1024 * 1024;
+   char *end, extra;
+   static const struct option longOptions[] = {
+      {"approx", required_argument, NULL, OPTION_APPROX},
+      {"seed", required_argument, NULL, OPTION_SEED},
+      {NULL, 0, NULL, 0}
+   };
 
-   while ((c = getopt(argc, argv, "t:f:h")) != -1) {
+   while ((c = getopt_long(argc, argv, "t:f:MPSs:q:F:m:c:R:C:Hiw:T:e:d:E:vh", longOptions, NULL)) != -1) {
       switch (c) {
          case 't':
             nThreads = atoi(optarg);
@@ -89,12 +444,146 @@ int main(int argc, char *argv[]){
                files[i] = argv[optind + i - 1];
             }
             break;
+         case 'M':
+            mapFiles = true;
+            break;
+         case 'P':
+            parallelSplit = true;
+            break;
+         case 'S':
+            sizeAware = true;
+            break;
+         case 's':
+            if (strcmp(optarg, "monitor") == 0) {
+               fifoType = FIFO_MONITOR;
+            } else if (strcmp(optarg, "ring") == 0) {
+               fifoType = FIFO_RING;
+            } else if (strcmp(optarg, "steal") == 0) {
+               fifoType = FIFO_STEAL;
+            } else {
+               fprintf(stderr, "%s: unknown fifo `%s'\n", argv[0], optarg);
+               printUsage(argv[0]);
+               return EXIT_FAILURE;
+            }
+            break;
+         case 'q':
+            fifoCapacity = atoi(optarg);
+            if (fifoCapacity <= 0) {
+               fprintf(stderr, "%s: non positive fifo capacity\n", argv[0]);
+               printUsage(argv[0]);
+               return EXIT_FAILURE;
+            }
+            break;
+         case 'F':
+            flushPeriod = atoi(optarg);
+            if (flushPeriod < 0) {
+               fprintf(stderr, "%s: negative flush period\n", argv[0]);
+               printUsage(argv[0]);
+               return EXIT_FAILURE;
+            }
+            break;
+         case 'm':
+            memoryBudget = parseSize(optarg);
+            if (memoryBudget < 0) {
+               fprintf(stderr, "%s: negative memory budget\n", argv[0]);
+               printUsage(argv[0]);
+               return EXIT_FAILURE;
+            }
+            break;
+         case 'T':
+            directThreshold = parseSize(optarg);
+            if (directThreshold < 0) {
+               fprintf(stderr, "%s: invalid input size threshold\n", argv[0]);
+               printUsage(argv[0]);
+               return EXIT_FAILURE;
+            }
+            break;
+         case 'c':
+            if (parseSize(optarg) <= 0 || parseSize(optarg) > INT_MAX) {
+               fprintf(stderr, "%s: invalid chunk size\n", argv[0]);
+               printUsage(argv[0]);
+               return EXIT_FAILURE;
+            }
+            chunkSize = parseSize(optarg);
+            break;
+         case 'R':
+            if (strncmp(optarg, "uring:", 6) == 0) {
+               readEngine = READER_URING;
+               optarg += 6;
+            } else if (strncmp(optarg, "pread:", 6) == 0) {
+               readEngine = READER_PREAD;
+               optarg += 6;
+            }
+            readDepth = atoi(optarg);
+            if (readDepth <= 0) {
+               fprintf(stderr, "%s: non positive number of reads in flight\n", argv[0]);
+               printUsage(argv[0]);
+               return EXIT_FAILURE;
+            }
+            break;
+         case 'C':
+            cacheFile = optarg;
+            break;
+         case 'H':
+            hashFiles = true;
+            break;
+         case 'i':
+            incremental = true;
+            break;
+         case 'w':
+            topWords = atoi(optarg);
+            if (topWords <= 0) {
+               fprintf(stderr, "%s: non positive number of words\n", argv[0]);
+               printUsage(argv[0]);
+               return EXIT_FAILURE;
+            }
+            break;
+         case 'e':
+            resultStream = (strcmp(optarg, "-") == 0) ? stdout : fopen(optarg, "w");
+            if (resultStream == NULL) {
+               fprintf(stderr, "%s: could not open the result stream %s: %s\n", argv[0], optarg, strerror(errno));
+               return EXIT_FAILURE;
+            }
+            break;
+         case 'd':
+            socketPath = optarg;
+            break;
+         case 'E':
+            if (sscanf(optarg, "%d:%d%c", &elasticMin, &elasticMax, &extra) != 2 || elasticMin <= 0 || elasticMax < elasticMin) {
+               fprintf(stderr, "%s: the elastic pool must be min:max, with 0 < min <= max\n", argv[0]);
+               printUsage(argv[0]);
+               return EXIT_FAILURE;
+            }
+            break;
+         case OPTION_APPROX:
+            approxFraction = strtod(optarg, &end);
+            if (end == optarg || *end != '\0' || !(approxFraction > 0 && approxFraction <= 1)) {
+               fprintf(stderr, "%s: the sampled fraction must be in ]0, 1]\n", argv[0]);
+               printUsage(argv[0]);
+               return EXIT_FAILURE;
+            }
+            break;
+         case OPTION_SEED:
+            approxSeed = strtoul(optarg, &end, 0);
+            if (end == optarg || *end != '\0') {
+               fprintf(stderr, "%s: invalid seed\n", argv[0]);
+               printUsage(argv[0]);
+               return EXIT_FAILURE;
+            }
+            break;
+         case 'v':
+            verbose = true;
+            break;
          case 'h':
             printUsage(argv[0]);
             return EXIT_SUCCESS;
          case '?':
-            if (optopt == 't' || optopt == 'f') {
+            if (optopt == 't' || optopt == 'f' || optopt == 's' || optopt == 'q' || optopt == 'F' || optopt == 'm' || optopt == 'c' || optopt == 'R' || optopt == 'C' || optopt == 'w' || optopt == 'T' || optopt == 'e' || optopt == 'd' || optopt == 'E') {
                fprintf(stderr, "%s: option -%c requires an argument\n", argv[0], optopt);
+            } else if (optopt == OPTION_APPROX || optopt == OPTION_SEED) {
+               fprintf(stderr, "%s: option %s requires an argument\n", argv[0], argv[optind - 1]);
+            } else if (optopt == 0) {
+               fprintf(stderr, "%s: unknown option `%s'\n", argv[0], argv[optind - 1]);
             } else if (isprint(optopt)) {
                fprintf(stderr, "%s: unknown option `-%c'\n", argv[0], optopt);
             } else {
@@ -108,33 +597,221 @@ int main(int argc, char *argv[]){
       }
     }
 
-    if (nThreads == 0 || nFiles == 0) {
+    /* the elastic pool starts with the workers of -t, or its minimum, and creates its maximum */
+    if (nThreads == 0) nThreads = (elasticMax > 0) ? elasticMin : DEFAULT_THREADS;
+
+    if (nFiles == 0 && socketPath == NULL) {
         fprintf(stderr, "%s: missing required argument(s)\n", argv[0]);
         printUsage(argv[0]);
         return EXIT_FAILURE;
     }
 
-    printf("Number of threads: %d\n", nThreads);
-    printf("Number of files: %d\n", nFiles);
-    printf("Files:\n");
-    for (int i = 0; i < nFiles; i++) {
-        printf("- %s\n", files[i]);
+    if (socketPath != NULL && (nFiles > 0 || mapFiles || parallelSplit || sizeAware || readDepth > 0 || cacheFile != NULL ||
+                               topWords > 0 || resultStream != NULL || approxFraction > 0)) {
+        fprintf(stderr, "%s: option -d can not be combined with -f, -M, -P, -S, -R, -C, -w, -e or --approx\n", argv[0]);
+        printUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    /* the daemon takes the files from its requests, one per slot of the shared region */
+    if (socketPath != NULL) {
+        nFiles = DAEMON_SLOTS;
+        if ((files = malloc(nFiles * sizeof(char *))) == NULL) {
+            fprintf(stderr, "%s: could not allocate memory for file names\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+        for (int i = 0; i < nFiles; i++) {
+            files[i] = "";
+        }
+    }
+
+    if (readDepth > 0 && (mapFiles || parallelSplit)) {
+        fprintf(stderr, "%s: option -R can not be combined with -M or -P\n", argv[0]);
+        printUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (topWords > 0 && (parallelSplit || cacheFile != NULL)) {
+        fprintf(stderr, "%s: option -w can not be combined with -P or -C\n", argv[0]);
+        printUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (sizeAware && parallelSplit) {
+        fprintf(stderr, "%s: option -S can not be combined with -P\n", argv[0]);
+        printUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (resultStream != NULL && (parallelSplit || approxFraction > 0)) {
+        fprintf(stderr, "%s: option -e can not be combined with -P or --approx\n", argv[0]);
+        printUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (approxFraction > 0 && (mapFiles || parallelSplit || sizeAware || readDepth > 0 || cacheFile != NULL || topWords > 0)) {
+        fprintf(stderr, "%s: option --approx can not be combined with -M, -P, -S, -R, -C or -w\n", argv[0]);
+        printUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (elasticMax > 0 && (parallelSplit || approxFraction > 0 || fifoType != FIFO_MONITOR)) {
+        fprintf(stderr, "%s: option -E can not be combined with -P, --approx or a fifo other than monitor\n", argv[0]);
+        printUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    /* the standard input and pipes can not be mapped nor read at any offset */
+    if (mapFiles || parallelSplit || readDepth > 0 || approxFraction > 0) {
+        for (int i = 0; i < nFiles; i++) {
+            if (isStream(files[i])) {
+                fprintf(stderr, "%s: %s can not be read with -M, -P, -R or --approx\n", argv[0], files[i]);
+                printUsage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        }
+    }
+
+    if (hashFiles && cacheFile == NULL) {
+        fprintf(stderr, "%s: option -H requires -C\n", argv[0]);
+        printUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (incremental && cacheFile == NULL) {
+        fprintf(stderr, "%s: option -i requires -C\n", argv[0]);
+        printUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (incremental && (mapFiles || parallelSplit || readDepth > 0 || hashFiles)) {
+        fprintf(stderr, "%s: option -i can not be combined with -M, -P, -R or -H\n", argv[0]);
+        printUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    /* a small input is processed by main alone, in one pass: no threads, no fifo and no copies */
+    if (directThreshold > 0 && approxFraction == 0 && socketPath == NULL && inputSize(nFiles, files, directThreshold) <= directThreshold) {
+        directInput = true;
+        mapFiles = parallelSplit = false;
+        readDepth = 0;
+    }
+
+    if (elasticMax > 0 && !directInput) {
+        elasticInit(elasticMin, elasticMax, nThreads);
+        nThreads = elasticMax;
+        printf("Number of threads: %d to %d (elastic)\n", elasticMin, elasticMax);
+    }
+    else {
+        printf("Number of threads: %d\n", nThreads);
+    }
+    if (socketPath != NULL) {
+        printf("Serving requests on %s\n", socketPath);
+        fflush(stdout);
+    }
+    else {
+        printf("Number of files: %d\n", nFiles);
+        printf("Files:\n");
+        for (int i = 0; i < nFiles; i++) {
+            printf("- %s\n", files[i]);
+        }
     }
 
    (void) get_delta_time ();
 
+   /* select the fifo used to hand the chunks to the workers */
+   configureFifo(fifoType, fifoCapacity, nThreads);
+   configureMemoryBudget(memoryBudget);
+
+   /* with -e each file is printed as soon as its last chunk is accounted for, the daemon answers a request once
+      all its files are */
+   configureResultStream(resultStream);
+   if (socketPath != NULL) {
+      configureFileDone(serverFileDone);
+      if (serverOpen(socketPath, nFiles) != 0) {
+         perror("Failed to listen for requests");
+         exit(EXIT_FAILURE);
+      }
+   }
+
    /* save filenames in the shared region and initialize counters to 0 */
    char *fileNames[nFiles];
    processFileName(nFiles, files, fileNames);
+   nWorkers = nThreads;
+
+   /* the files are looked up in the result cache while the ones that changed are processed */
+   if (cacheFile != NULL && (cacheOpen(cacheFile, hashFiles, incremental) != 0 || cacheStartLookups(nFiles, fileNames) != 0)) {
+      perror("Failed to open the result cache");
+      exit(EXIT_FAILURE);
+   }
+
+   /* with -v every thread records the time it spends in each stage */
+   if (verbose && statsInit(nThreads) != 0) {
+      perror("Failed to allocate memory");
+      exit(EXIT_FAILURE);
+   }
+
+   /* allocate the counters of each worker, initialized to 0 */
+   numFiles = nFiles;
+   workerCounters = aligned_alloc(64, nThreads * nFiles * sizeof(struct LocalCounters));
+   if (workerCounters == NULL) {
+      perror("Failed to allocate memory");
+      exit(EXIT_FAILURE);
+   }
+   memset(workerCounters, 0, nThreads * nFiles * sizeof(struct LocalCounters));
+
+   /* with -w every worker also counts the occurrences of each word in tables of its own */
+   if (topWords > 0 && wordsInit(directInput ? 1 : nThreads, nFiles, topWords) != 0) {
+      perror("Failed to allocate memory");
+      exit(EXIT_FAILURE);
+   }
+
+   /* the copied chunks live in recycled buffers, carved from the slab of the pool only when none is free, so the
+      memory touched follows the chunks held at the same time (none when every file is a cache hit); the slab has
+      room for a full fifo (the ring and the deques may round their capacity up to twice as many slots, and there is
+      a deque per worker), one chunk per worker and the caches of every thread, so main never waits forever; a buffer
+      holds at least MIN_CHUNK_SIZE bytes, since a word is only cut between two pieces of a token when it fills a
+      buffer, and such a word must be too long to be ranked by -w */
+   if (!mapFiles && !parallelSplit && !directInput && approxFraction == 0) {
+      int fifoSlots = 2 * fifoCapacity * ((fifoType == FIFO_STEAL) ? nThreads : 1);
+      long bufferSize = (chunkSize == 0) ? MAX_CHUNK_SIZE : (chunkSize < MIN_CHUNK_SIZE) ? MIN_CHUNK_SIZE : chunkSize;
 
-   /* create worker threads */
+      /* the asynchronous reader also holds the buffers of the reads in flight, and reads each block into the
+         second half of a buffer, leaving the first half for the end of the previous block */
+      if (readDepth > 0) {
+         fifoSlots += readDepth;
+         bufferSize *= 2;
+      }
+      /* the daemon keeps the buffer of each file it splits between its turns */
+      if (socketPath != NULL) {
+         fifoSlots += DAEMON_SPLITS;
+      }
+      if (poolInit(fifoSlots + nThreads * (POOL_CACHE + 1) + POOL_CACHE + 1, bufferSize) != 0) {
+         perror("Failed to allocate memory");
+         exit(EXIT_FAILURE);
+      }
+   }
+
+   /* when the workers split the files themselves they need the ranges before starting */
+   if (parallelSplit) {
+      prepareFileRanges(nFiles, files);
+   }
+   else if (approxFraction > 0) {
+      prepareSamples(nFiles, files);
+   }
+   else if (!directInput && socketPath == NULL) {
+      scheduleFiles(nFiles, files);
+   }
+
+   /* create worker threads, none when main processes the input by itself */
    pthread_t th[nThreads];
    unsigned int workers[nThreads];
    workersStatus = malloc(nThreads * sizeof(int));   /* allocate memory to save the status of each worker */
    int *status_p;                                           /* pointer to execution status */
    int i;
+   int nStarted = directInput ? 0 : nThreads;
       
-   for (i=0; i<nThreads; i++){
+   for (i=0; i<nStarted; i++){
       workers[i] = i;
       if(pthread_create(&th[i], NULL, worker, &workers[i]) != 0){
          perror("Failed to create thread");
@@ -142,54 +819,36 @@ int main(int argc, char *argv[]){
       }
    }
 
-   /* generate the chunks to be processed by the workers threads */
-   for(int i=0; i<nFiles; i++){
-      FILE * fp;
-
-      /* open the input file in binary mode */
-      fp = fopen(files[i], "rb");
-      if (fp == NULL) {
-         printf("It occoured an error while openning file: %s \n", argv[i]);
-         exit(EXIT_FAILURE);
-      }
-
-      fseek(fp, 0, SEEK_END);
-      long file_size = ftell(fp);
-      rewind(fp);
-      
-      char **chunks = malloc(file_size + 1); /* allocate memory for all chunks */
-      if (chunks == NULL) {
-         perror("Failed to allocate memory");
-         return 1;
-      }
-
-      int chunk_index = splitTextIntoChunks(fp, chunks);
+   /* with -E a controller resizes the pool from the pressure on the fifo */
+   if (elasticMax > 0 && !directInput && elasticStart() != 0) {
+      perror("Failed to create thread");
+      exit (EXIT_FAILURE);
+   }
 
-      /* save the chunks */
-      for (int j = 0; j < chunk_index; j++) {
-         //printf("\nchunks: %s\n", chunks[j]);
-         saveChunk(chunks[j], strlen(chunks[j]), i);
-      }
+   /* generate the chunks to be processed by the workers threads, unless they split the files themselves */
+   if (directInput) {
+      processDirectly(nFiles, files);
+   }
+   else if (!parallelSplit && approxFraction == 0) {
+      if (socketPath != NULL) serveRequests();
+      else if (readDepth > 0) produceChunksAsync(nFiles, files);
+      else produceChunks(nFiles, files);
 
-      /* free memory */
-      for (int i = 0; i < chunk_index; i++) {
-         free(chunks[i]);
+      /* save a chunk for each worker in fifo that represents the end of asking for chunks, the workers not active
+         in the elastic pool included */
+      if (elasticMax > 0) elasticStop();
+      for (int i = 0; i < nThreads; i++) {
+         saveChunk(NULL, -1, -1);
       }
-      free(chunks);
-      
-      fclose(fp);
    }
 
    /* free memory for the files */
    free(files);
-
-   /* save a chunk for each worker in fifo that represents the end of asking for chunks */
-   for (int i = 0; i < nThreads; i++) {
-      saveChunk(NULL, -1, -1);
-   }
+   free(fileOrder);
+   free(scheduleSizes);
 
    /* waiting for the termination of the intervening entities threads */
-   for (i = 0; i < nThreads; i++){ 
+   for (i = 0; i < nStarted; i++){ 
       if (pthread_join (th[i], (void *) &status_p) != 0){                               /* thread worker */
          perror ("error on waiting for worker thread");
          exit(EXIT_FAILURE);
@@ -198,199 +857,1670 @@ int main(int argc, char *argv[]){
       // printf ("its status was %d\n", *status_p);
    }
 
-   /* print results for all files */
-   printResults();
-
-   /* print the execution time */
-   printf ("\nElapsed time = %.6f s\n", get_delta_time ());
+   /* all ranges (or units sampled) were processed, close the files */
+   if (parallelSplit || approxFraction > 0) {
+      for (int i = 0; i < nFiles; i++) {
+         if (fileDescriptors[i] != -1) close(fileDescriptors[i]);
+      }
+      free(fileDescriptors);
+      free(fileSizes);
+   }
+
+   /* reduce the counters of all workers into the shared region */
+   struct timespec saveStart;
+   stageBegin(&saveStart);
+   if (parallelSplit) {
+      mergeFileRanges();
+      free(firstRange);
+      free(rangeTexts);
+   }
+   for (i = 0; i < nThreads; i++) {
+      flushWorkerCounters(i);
+   }
+   stageEnd(statsMainSlot, STAGE_SAVE, &saveStart);
+   free(workerCounters);
+
+   /* the workers are done with the chunk views, release the mappings */
+   if (mapFiles) {
+      for (int i = 0; i < nFiles; i++) {
+         if (mappedSizes[i] > 0) munmap(mappedFiles[i], mappedSizes[i]);
+      }
+      free(mappedFiles);
+      free(mappedSizes);
+   }
+
+   /* print results for all files, estimated from the units sampled with --approx */
+   if (approxFraction > 0) {
+      samplingPrint(fileNames);
+      samplingDestroy();
+   }
+   else if (resultStream != stdout && socketPath == NULL) {
+      printResults();
+   }
+   if (resultStream != NULL && resultStream != stdout && fclose(resultStream) != 0) {
+      perror("Failed to write the result stream");
+   }
+
+   /* merge the word tables of the workers and print the most frequent words */
+   if (topWords > 0) {
+      if (wordsMerge() != 0) {
+         perror("Failed to allocate memory");
+         exit(EXIT_FAILURE);
+      }
+      wordsPrint(fileNames);
+      wordsDestroy();
+   }
+
+   /* store the counters of the files processed in the result cache */
+   if (cacheFile != NULL) {
+      for (int i = 0; i < nFiles; i++) {
+         struct FileCounters counters;
+
+         getFileCounters(i, &counters);
+         cacheStore(i, &counters);
+      }
+      if (verbose) {
+         fprintf(stderr, "result cache: %d of %d files reported from the cache, %d resumed where they ended\n",
+                 cacheHits(), nFiles, cacheResumes());
+      }
+      if (cacheClose() != 0) {
+         perror("Failed to write the result cache");
+      }
+   }
+
+   if (verbose && socketPath != NULL) {
+      fprintf(stderr, "daemon: %ld requests answered\n", serverRequests());
+   }
+   if (socketPath != NULL) serverClose();
+   if (verbose && !parallelSplit && approxFraction == 0 && socketPath == NULL) {
+      for (int i = 0; i < nFiles; i++) {
+         if (chunkSizers[i].initialSize == 0 && chunkSizers[i].chunks == 0) {   /* reported from the result cache */
+            fprintf(stderr, "%s: reported from the result cache\n", fileNames[i]);
+            continue;
+         }
+         fprintf(stderr, "%s: %ld chunks, chunk size %ld bytes at the start, %ld bytes at the end\n", fileNames[i],
+                 chunkSizers[i].chunks, chunkSizers[i].initialSize, chunkSizers[i].size);
+      }
+   }
+   if (verbose && directInput) {
+      fprintf(stderr, "small input: processed by main, without worker threads\n");
+   }
+   else if (verbose && elasticMax > 0) {
+      elasticPrint();
+   }
+   if (!parallelSplit && approxFraction == 0) free(chunkSizers);
+
+   if (!mapFiles && !parallelSplit && !directInput && approxFraction == 0) {
+      if (verbose) {
+         struct PoolStats stats;
+
+         poolGetStats(&stats);
+         fprintf(stderr, "chunk pool: %u buffers of %u bytes carved (of %u), high-water mark %u, %lu takes, %lu refills, "
+                 "%lu waits\n", stats.carved, stats.bufferSize, stats.buffers, stats.highWater, stats.takes, stats.refills,
+                 stats.waits);
+      }
+      poolDestroy();
+   }
+   if (verbose && readDepth > 0) {
+      fprintf(stderr, "asynchronous reader: %s, %d reads in flight\n", readerEngine(), readDepth);
+   }
+   if (verbose && fifoType == FIFO_STEAL) {
+      fprintf(stderr, "work stealing: %lu chunks taken from the deque of another worker\n", stolenChunks());
+   }
+
+   if (verbose) {
+      statsPrint(stderr);
+      statsDestroy();
+   }
+
+   /* print the execution time */
+   printf ("\nElapsed time = %.6f s\n", get_delta_time ());
 
    exit(EXIT_SUCCESS);
 }
 
 /**
- *  \brief Function worker.
+ *  \brief Function created to report a file from the result cache.
+ *
+ *  Operation carried out by main, in the order of the files. It waits for the lookup of the file, and if the file
+ *  did not change since it was stored, its counters are set from the cache.
+ *
+ *  \param fileId file identifier
+ *
+ *  \return true if the file does not need to be processed
+ */
+static bool reportFromCache(int fileId){
+
+   struct FileCounters counters;
+
+   if (cacheFile == NULL || !cacheLookup(fileId, &counters)) return false;
+   storeFileCounters(fileId, &counters);
+   fileSplitDone(fileId, 0);
+   return true;
+}
+
+/**
+ *  \brief Function created to set up the statistics of a text from the state at some offset of a file.
+ *
+ *  \param text statistics to be set up
+ *  \param state state of the text
+ */
+static void restoreTailState(struct cle_text *text, const struct TailState *state){
+
+   cle_text_init(text);
+   text->decoder = state->decoder;
+   text->inWord = state->inWord;
+   text->seen = state->seen;
+   text->headDone = text->leadDone = true;          /* the text on the left is already known, nothing to merge */
+}
+
+/**
+ *  \brief Function created to resume a file, in incremental mode, from where it ended in the result cache.
+ *
+ *  Operation carried out by main, before the file is split. When the file only grew since it was stored, its
+ *  counters are set from the cache, and main completes the word that was open at its old end, from the state stored
+ *  with it, up to the first separator that follows. The rest starts after a separator, so the workers process it as
+ *  any other chunk. Otherwise the whole file is processed.
+ *
+ *  \param fileId file identifier
+ *  \param fd file descriptor of the file
+ *  \param limit number of bytes of the file to be processed
+ *  \param start state of the text at the offset returned
+ *
+ *  \return offset from where the file must be split
+ */
+static off_t resumeFile(int fileId, int fd, off_t limit, struct TailState *start){
+
+   struct FileCounters counters;
+   struct TailState tail;
+
+   memset(start, 0, sizeof(struct TailState));
+   start->decoder.state = UTF8_ACCEPT;
+   if (!cacheResume(fileId, &counters, &tail)) return 0;
+
+   off_t offset = tail.offset;
+   if (tail.inWord || tail.decoder.state != UTF8_ACCEPT) {
+      unsigned char block[TAIL_BLOCK];
+      struct cle_text text;
+      bool separator = false;
+
+      restoreTailState(&text, &tail);
+      while (!separator && offset < limit) {
+         int n = (limit - offset < TAIL_BLOCK) ? (int) (limit - offset) : TAIL_BLOCK;
+         int end = 0;
+
+         readRange(fd, block, n, offset);
+         while (end < n && !is_separator(block[end])) {
+            end++;
+         }
+         if (end < n) {
+            separator = true;
+            end++;
+         }
+         cle_text_feed(&text, block, end);
+         offset += end;
+      }
+
+      /* the words and vowels completed are added to the counters of the cache */
+      counters.total_num_of_words += text.counts.words;
+      for (int v = 0; v < 6; v++) {
+         counters.count_total_vowels[v] += text.counts.vowels[v];
+      }
+      if (!separator) {
+         start->decoder = text.decoder;
+         start->inWord = text.inWord;
+         start->seen = text.seen;
+      }
+   }
+   start->offset = offset;
+   storeFileCounters(fileId, &counters);
+   return offset;
+}
+
+/**
+ *  \brief Function created to record, in incremental mode, the state of the text at the end of a file.
+ *
+ *  Operation carried out by main, after the file was split. The state after a separator is the state at the start
+ *  of a text, so only the bytes after the last separator of the file are read again, from its end backwards.
+ *
+ *  \param fileId file identifier
+ *  \param fd file descriptor of the file
+ *  \param start state of the text at the offset from where the file was split
+ *  \param limit number of bytes of the file that were processed
+ */
+static void recordFileEnd(int fileId, int fd, const struct TailState *start, off_t limit){
+
+   unsigned char block[TAIL_BLOCK];
+   struct cle_text text;
+   struct TailState end;
+   off_t from = limit;
+
+   /* find the last separator after the start */
+   while (from > start->offset) {
+      int n = (from - start->offset < TAIL_BLOCK) ? (int) (from - start->offset) : TAIL_BLOCK;
+      int i = n - 1;
+
+      readRange(fd, block, n, from - n);
+      while (i >= 0 && !is_separator(block[i])) {
+         i--;
+      }
+      if (i >= 0) {
+         from = from - n + i + 1;
+         break;
+      }
+      from -= n;
+   }
+
+   /* the last word of the file, after that separator or continuing from the start */
+   if (from == start->offset) restoreTailState(&text, start);
+   else cle_text_init(&text);
+   while (from < limit) {
+      int n = (limit - from < TAIL_BLOCK) ? (int) (limit - from) : TAIL_BLOCK;
+
+      readRange(fd, block, n, from);
+      cle_text_feed(&text, block, n);
+      from += n;
+   }
+
+   end.offset = limit;
+   end.decoder = text.decoder;
+   end.inWord = text.inWord;
+   end.seen = text.seen;
+   cacheStoreTail(fileId, &end);
+}
+
+/**
+ *  \brief Function created to generate the chunks of all files and store them in the fifo.
+ *
+ *  Operation carried out by main.
+ *
+ *  \param nFiles number of files
+ *  \param files names of the files
+ */
+static void produceChunks(int nFiles, char **files){
+
+   if ((chunkSizers = calloc(nFiles, sizeof(struct ChunkSizer))) == NULL) {
+      perror("Failed to allocate memory");
+      exit(EXIT_FAILURE);
+   }
+   if (mapFiles) {
+      mappedFiles = calloc(nFiles, sizeof(unsigned char *));
+      mappedSizes = calloc(nFiles, sizeof(long));
+      if (mappedFiles == NULL || mappedSizes == NULL) {
+         perror("Failed to allocate memory");
+         exit(EXIT_FAILURE);
+      }
+   }
+   for(int k=0; k<nFiles; k++){
+      int i = fileOrder[k];
+
+      if (reportFromCache(i)) continue;
+
+      if (mapFiles) {
+         int fd;
+         struct stat st;
+
+         /* map the whole file once, the workers read straight from the mapping */
+         if ((fd = open(files[i], O_RDONLY)) == -1 || fstat(fd, &st) == -1) {
+            printf("It occoured an error while openning file: %s \n", files[i]);
+            exit(EXIT_FAILURE);
+         }
+         if (st.st_size > 0) {
+            mappedFiles[i] = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mappedFiles[i] == MAP_FAILED) {
+               perror("Failed to map file");
+               exit(EXIT_FAILURE);
+            }
+            madvise(mappedFiles[i], st.st_size, MADV_SEQUENTIAL);
+            mappedSizes[i] = st.st_size;
+         }
+         close(fd);
+
+         splitMappedFile(mappedFiles[i], mappedSizes[i], i);
+         fileSplitDone(i, chunkSizers[i].chunks);
+         continue;
+      }
+
+      FILE * fp;
+
+      /* open the input file in binary mode, - is the standard input */
+      fp = isStandardInput(files[i]) ? stdin : fopen(files[i], "rb");
+      if (fp == NULL) {
+         printf("It occoured an error while openning file: %s \n", files[i]);
+         exit(EXIT_FAILURE);
+      }
+
+      /* in incremental mode the file is processed up to its length when it was looked up, from where it ended in
+         the result cache if it only grew since */
+      struct TailState state;
+      off_t start = 0, limit = (incremental && fp != stdin) ? cacheLength(i) : -1;
+      if (limit >= 0) {
+         start = resumeFile(i, fileno(fp), limit, &state);
+         fseeko(fp, start, SEEK_SET);
+      }
+
+      /* the chunks are handed to the workers as soon as they are cut */
+      splitTextIntoChunks(fp, i, (limit >= 0) ? limit - start : -1);
+
+      fileSplitDone(i, chunkSizers[i].chunks);
+
+      if (limit >= 0) recordFileEnd(i, fileno(fp), &state, limit);
+      if (fp != stdin) fclose(fp);
+   }
+}
+
+/**
+ *  \brief Function created to get the total size of the input, up to a limit.
+ *
+ *  The files are looked up until their sizes add up to more than the limit, so a big input costs few lookups.
+ *
+ *  \param nFiles number of files
+ *  \param files names of the files
+ *  \param limit size above which the lookup stops
+ *
+ *  \return total size of the files, LONG_MAX when it is above the limit or not known (pipes, missing files)
+ */
+static long inputSize(int nFiles, char **files, long limit){
+
+   long total = 0;
+
+   for (int i = 0; i < nFiles; i++) {
+      struct stat st;
+
+      if (isStream(files[i]) || stat(files[i], &st) == -1) return LONG_MAX;
+      total += st.st_size;
+      if (total > limit) return LONG_MAX;
+   }
+   return total;
+}
+
+/**
+ *  \brief Function created to process a small input in main, one file after the other.
+ *
+ *  Each file is read whole into a single buffer and processed in one pass, as a single chunk of worker 0, so its
+ *  counters are saved like those of the workers. No thread is created and nothing goes through the fifo.
+ *
+ *  \param nFiles number of files
+ *  \param files names of the files
+ */
+static void processDirectly(int nFiles, char **files){
+
+   unsigned char *buffer = NULL;
+   long capacity = 0;
+
+   if ((chunkSizers = calloc(nFiles, sizeof(struct ChunkSizer))) == NULL) {
+      perror("Failed to allocate memory");
+      exit(EXIT_FAILURE);
+   }
+   for (int i = 0; i < nFiles; i++) {
+      struct ParRes parRes;
+      struct stat st;
+      struct timespec start;
+      int fd;
+
+      if (reportFromCache(i)) continue;
+
+      stageBegin(&start);
+      if ((fd = open(files[i], O_RDONLY)) == -1 || fstat(fd, &st) == -1) {
+         printf("It occoured an error while openning file: %s \n", files[i]);
+         exit(EXIT_FAILURE);
+      }
+
+      /* in incremental mode only what was appended since the file was stored in the result cache may be read */
+      struct TailState state;
+      off_t offset = 0, limit = incremental ? cacheLength(i) : -1;
+      if (limit >= 0) offset = resumeFile(i, fd, limit, &state);
+      long size = ((limit >= 0) ? limit : st.st_size) - offset;
+
+      if (size > capacity) {
+         capacity = size;
+         free(buffer);
+         if ((buffer = malloc(capacity)) == NULL) {
+            perror("Failed to allocate memory");
+            exit(EXIT_FAILURE);
+         }
+      }
+      readRange(fd, buffer, size, offset);
+      stageEnd(statsMainSlot, STAGE_READ, &start);
+
+      stageBegin(&start);
+      parRes.fileID = i;
+      processWordsChunk(0, buffer, size, i, &parRes);
+      addWorkerCounters(0, &parRes);
+      stageEnd(statsMainSlot, STAGE_PROCESS, &start);
+      statsCountChunk(statsMainSlot, size);
+
+      if (limit >= 0) recordFileEnd(i, fd, &state, limit);
+      close(fd);
+
+      chunkSizers[i].size = chunkSizers[i].initialSize = size;
+      chunkSizers[i].chunks = 1;
+      fileSplitDone(i, 1);
+   }
+   free(buffer);
+}
+
+/**
+ *  \brief Function created to pick the order in which the files are split.
+ *
+ *  Operation carried out by main, before the chunks are generated. The files are split in the order they were given,
+ *  unless they are scheduled by size: then all files are looked up first and split from the largest to the smallest
+ *  (longest processing time first), so a big file does not start when the other workers are already idle. The files
+ *  whose size is not known, like pipes, go first. The chunks keep the identifier of their file, so the results are
+ *  still printed in the order of the files.
+ *
+ *  \param nFiles number of files
+ *  \param files names of the files
+ */
+static void scheduleFiles(int nFiles, char **files){
+
+   if ((fileOrder = malloc(nFiles * sizeof(int))) == NULL) {
+      perror("Failed to allocate memory");
+      exit(EXIT_FAILURE);
+   }
+   for (int i = 0; i < nFiles; i++) {
+      fileOrder[i] = i;
+   }
+   if (!sizeAware) return;
+
+   /* a small file must fit in a pool buffer, with one byte to spare to reach its end in a single read */
+   smallFileSize = ((chunkSize > 0) ? chunkSize : MAX_CHUNK_SIZE) - 1;
+   if (smallFileSize > SMALL_FILE_SIZE) smallFileSize = SMALL_FILE_SIZE;
+
+   if ((scheduleSizes = malloc(nFiles * sizeof(long))) == NULL) {
+      perror("Failed to allocate memory");
+      exit(EXIT_FAILURE);
+   }
+   for (int i = 0; i < nFiles; i++) {
+      struct stat st;
+
+      if (isStream(files[i])) scheduleSizes[i] = LONG_MAX;
+      else scheduleSizes[i] = (stat(files[i], &st) == 0) ? st.st_size : 0;
+   }
+   qsort(fileOrder, nFiles, sizeof(int), compareFileSizes);
+}
+
+/**
+ *  \brief Function created to compare two files by size, the largest first and, when equal, in the given order.
+ *
+ *  \param a pointer to the identifier of a file
+ *  \param b pointer to the identifier of another file
+ *
+ *  \return negative if file a goes first, positive otherwise
+ */
+static int compareFileSizes(const void *a, const void *b){
+   int fa = *(const int *) a, fb = *(const int *) b;
+
+   if (scheduleSizes[fa] != scheduleSizes[fb]) return (scheduleSizes[fa] > scheduleSizes[fb]) ? -1 : 1;
+   return fa - fb;
+}
+
+/**
+ *  \brief Function created to check if a file name stands for the standard input.
+ *
+ *  \param name file name
+ *
+ *  \return true if the name is -
+ */
+static bool isStandardInput(const char *name){
+   return strcmp(name, "-") == 0;
+}
+
+/**
+ *  \brief Function created to check if a file can only be read once, from start to end.
+ *
+ *  \param name file name
+ *
+ *  \return true for the standard input, pipes and other files that are not regular files
+ */
+static bool isStream(const char *name){
+   struct stat st;
+
+   return isStandardInput(name) || (stat(name, &st) == 0 && !S_ISREG(st.st_mode));
+}
+
+/**
+ *  \brief Function worker.
+ *
+ *  Its role is to simulate the life cycle of a worker.
+ *
+ *  \param par pointer to application defined worker identification
+ */
+static void *worker(void *par) {
+    
+   unsigned int id = *((unsigned int *) par);      // worker id
+   struct Chunk chunk;
+   struct ParRes parRes;
+   int chunksSinceFlush = 0;
+   struct timespec waitStart, processStart, processEnd, saveStart;
+
+   /* without a producer, the worker claims byte ranges of the files, or the units sampled, by itself */
+   if (parallelSplit || approxFraction > 0) {
+      if (parallelSplit) processFileRanges(id);
+      else processSamples(id);
+      workersStatus[id] = EXIT_SUCCESS;
+      pthread_exit (&workersStatus[id]);
+   }
+    
+   if (chunkSize == 0) clock_gettime(CLOCK_MONOTONIC, &waitStart);
+   for (;;) {
+      /* a worker that is not active in the elastic pool waits, which is not waiting for chunks */
+      if (elasticMax > 0 && elasticPark(id) && chunkSize == 0) clock_gettime(CLOCK_MONOTONIC, &waitStart);
+      if (!readTextChunk(&chunk, &parRes, id)) break;
+
+      if (chunkSize == 0 || statsEnabled) clock_gettime(CLOCK_MONOTONIC, &processStart);
+
+      /* a chunk without its own buffer is a view into the mapping of its file */
+      unsigned char *text = (chunk.chunk_pointer == NULL) ? mappedFiles[chunk.fileId] + chunk.offset : chunk.chunk_pointer;
+
+      /* perform text processing on the chunk, a piece of a long token only counts once all its pieces were processed;
+         the word frequencies leave the token out, and only take the text after it in its last piece */
+      bool counted = true;
+      if (chunk.piece == NULL) {
+         processWordsChunk(id, text, chunk.size, chunk.fileId, &parRes);
+      }
+      else {
+         if (topWords > 0) {
+            long skip = chunk.piece->inWord ? first_word_end(text, chunk.size) : 0;
+            wordsAddText(id, text + skip, chunk.size - skip, chunk.fileId, NULL);
+         }
+         counted = processPiece(text, chunk.size, chunk.piece, &parRes);
+      }
+
+      /* free the memory of the buffer, returning it to the memory budget */
+      if (chunk.chunk_pointer != NULL) releaseChunk(id, &chunk);
+      stageEnd(id, STAGE_PROCESS, &processStart);
+      statsCountChunk(id, chunk.size);
+
+      /* let the producer know how the time of the workers is spent, to adjust the chunk size */
+      if (chunkSize == 0) {
+         clock_gettime(CLOCK_MONOTONIC, &processEnd);
+         atomic_fetch_add_explicit(&waitingTime, elapsedNs(&waitStart, &processStart), memory_order_relaxed);
+         atomic_fetch_add_explicit(&processingTime, elapsedNs(&processStart, &processEnd), memory_order_relaxed);
+         waitStart = processEnd;
+      }
+
+      /* accumulate the partial results in the counters of this worker, no lock needed */
+      stageBegin(&saveStart);
+      if (counted) addWorkerCounters(id, &parRes);
+
+      /* make the progress visible in the shared region from time to time */
+      if (flushPeriod > 0 && ++chunksSinceFlush == flushPeriod) {
+         flushWorkerCounters(id);
+         chunksSinceFlush = 0;
+      }
+      stageEnd(id, STAGE_SAVE, &saveStart);
+   }
+
+   workersStatus[id] = EXIT_SUCCESS;
+   pthread_exit (&workersStatus[id]);
+    
+}
+
+/**
+ *  \brief Function created to add partial results to the counters of a worker.
+ *
+ *  When the files are emitted as they complete (-e), the results go straight to the shared region instead, which
+ *  accounts for the chunk.
+ *
+ *  \param workerId worker identification
+ *  \param parRes pointer to a partial results struct
+ */
+static void addWorkerCounters(unsigned int workerId, struct ParRes *parRes){
+
+   if (resultStream != NULL || socketPath != NULL) {
+      saveChunkResults(workerId, parRes->numberOfWords, parRes->vowelWords[0], parRes->vowelWords[1], parRes->vowelWords[2], parRes->vowelWords[3], parRes->vowelWords[4], parRes->vowelWords[5], parRes->fileID);
+      return;
+   }
+
+   struct LocalCounters *counters = &workerCounters[workerId * numFiles + parRes->fileID];
+
+   counters->numberOfWords += parRes->numberOfWords;
+   for (int v = 0; v < 6; v++) {
+      counters->vowelWords[v] += parRes->vowelWords[v];
+   }
+}
+
+/**
+ *  \brief Function created to add the counters of a worker to the shared region and reset them.
+ *
+ *  Called by the worker itself when flushing periodically, and by main after the worker has terminated.
+ *
+ *  \param workerId worker identification
+ */
+static void flushWorkerCounters(unsigned int workerId){
+
+   for (int f = 0; f < numFiles; f++) {
+      struct LocalCounters *counters = &workerCounters[workerId * numFiles + f];
+      if (counters->numberOfWords == 0) continue;      /* every chunk with a vowel word also has a word */
+
+      savePartialResults(workerId, counters->numberOfWords, counters->vowelWords[0], counters->vowelWords[1], counters->vowelWords[2], counters->vowelWords[3], counters->vowelWords[4], counters->vowelWords[5], f);
+      memset(counters, 0, sizeof(struct LocalCounters));
+   }
+}
+
+/**
+ *  \brief Function created to check the next chunk of text, and returns true if it was successful.
+ * 
+ *  \param chunk pointer to a chunk struct
+ *  \param parRes pointer to a partial results struct
+ *  \param workerID worker identification
+ */
+static bool readTextChunk(struct Chunk* chunk, struct ParRes* parRes, int workerID){
+
+   /* get chunk from fifo */
+   (*chunk) = retrieveChunk(workerID);
+
+   /* checks if it is the chunk that tells that there are no more chunks to process */
+   if ((chunk->chunk_pointer == NULL) && (chunk->fileId == -1)) return false;
+
+   /* initialize the vars in parRes*/
+   parRes->fileID = chunk->fileId;
+   parRes->numberOfWords = 0;
+   for (int i = 0; i < 6; i++) {
+      parRes->vowelWords[i] = 0;
+   }
+
+   return true;
+}
+
+/**
+ *  \brief Function created to process one text chunk.
+ * 
+ *  \param chunk_pointer pointer to a chunk of text
+ *  \param size size of the chunk
+ *  \param parRes pointer to a partial results struct
+ */
+static void processTextChunk(unsigned char * chunk_pointer, long size, struct ParRes * partialResults){
+
+   struct cle_text text;
+   struct cle_text_counts counts;
+
+   cle_text_init(&text);
+   cle_text_feed(&text, chunk_pointer, size);
+   cle_text_finish(&text, &counts);
+   storeCounts(&counts, partialResults);
+
+}
+
+/**
+ *  \brief Function created to process one text chunk, also counting its words in the word frequencies when they are on.
+ *
+ *  The word frequencies take the counters of the chunk in the same pass, so the chunk is only read again when one of
+ *  its words is too long for them.
+ *
+ *  \param workerId worker identification
+ *  \param chunk_pointer pointer to a chunk of text
+ *  \param size size of the chunk
+ *  \param fileId file identifier of the chunk
+ *  \param partialResults pointer to a partial results struct
+ */
+static void processWordsChunk(unsigned int workerId, unsigned char * chunk_pointer, long size, int fileId, struct ParRes * partialResults){
+
+   struct cle_text_counts counts;
+
+   if (topWords > 0 && wordsAddText(workerId, chunk_pointer, size, fileId, &counts)) storeCounts(&counts, partialResults);
+   else processTextChunk(chunk_pointer, size, partialResults);
+
+}
+
+/**
+ *  \brief Function created to store the counters of a text in a partial results struct.
+ *
+ *  \param counts counters of the text
+ *  \param partialResults pointer to a partial results struct
+ */
+static void storeCounts(const struct cle_text_counts *counts, struct ParRes * partialResults){
+
+   partialResults->numberOfWords = counts->words;
+   for (int v = 0; v < 6; v++) {
+      partialResults->vowelWords[v] = counts->vowels[v];
+   }
+
+}
+
+/**
+ *  \brief Function created to process a piece of a token longer than a buffer.
+ *
+ *  The state of the text of the piece is kept in the piece. The worker that processes the last piece left of the
+ *  token, whichever it is, merges the states of all its pieces, in order, and releases them.
+ *
+ *  \param chunk_pointer pointer to the piece
+ *  \param size size of the piece
+ *  \param piece piece of the token
+ *  \param partialResults pointer to a partial results struct, set to the counters of the whole token
+ *
+ *  \return true if the counters of the token are complete
+ */
+static bool processPiece(unsigned char * chunk_pointer, long size, struct TokenPiece *piece, struct ParRes * partialResults){
+
+   struct TokenRun *run = piece->run;
+   struct cle_text text;
+   struct cle_text_counts counts;
+
+   cle_text_init(&piece->text);
+   cle_text_feed(&piece->text, chunk_pointer, size);
+   if (atomic_fetch_add(&run->done, 1) + 1 != atomic_load(&run->pieces)) return false;
+
+   /* every piece was processed, and main set the number of pieces before storing the last one */
+   text = run->first->text;
+   for (struct TokenPiece *p = run->first, *next; p != NULL; p = next) {
+      next = p->last ? NULL : p->next;
+      if (p != run->first) cle_text_merge(&text, &p->text);
+      free(p);
+   }
+   free(run);
+   cle_text_finish(&text, &counts);
+   storeCounts(&counts, partialResults);
+
+   return true;
+}
+
+/**
+ *  \brief Function created to start the next piece of a token longer than a buffer.
+ *
+ *  Operation carried out by main, before the piece is stored in the fifo. The number of pieces of the token is set
+ *  with its last piece, so the worker that processes the last piece left can tell it is the last one.
+ *
+ *  \param previous previous piece of the token (NULL: the token starts with this piece)
+ *  \param last flag telling if it is the last piece of the token
+ *  \param inWord flag telling if the piece starts in a word
+ *
+ *  \return the piece
+ */
+static struct TokenPiece *nextPiece(struct TokenPiece *previous, bool last, bool inWord){
+
+   struct TokenPiece *piece = calloc(1, sizeof(struct TokenPiece));
+   struct TokenRun *run = (previous != NULL) ? previous->run : calloc(1, sizeof(struct TokenRun));
+
+   if (piece == NULL || run == NULL) {
+      perror("Failed to allocate memory");
+      exit(EXIT_FAILURE);
+   }
+   piece->run = run;
+   piece->last = last;
+   piece->inWord = inWord;
+   if (previous != NULL) previous->next = piece;
+   else run->first = piece;
+   run->count++;
+   if (last) atomic_store(&run->pieces, run->count);
+
+   return piece;
+}
+
+/**
+ *  \brief Function created to take a pool buffer for main, counted in the memory budget.
+ *
+ *  Operation carried out by main, waiting while the budget is exhausted.
+ *
+ *  \return the buffer
+ */
+static unsigned char *takeBuffer(void){
+
+   holdMainMemory(poolBufferSize(), true);
+
+   return poolTake();
+}
+
+/**
+ *  \brief Function created to give a buffer of main back to the pool, and its memory to the budget.
+ *
+ *  \param buffer buffer taken with takeBuffer
+ */
+static void giveBuffer(unsigned char *buffer){
+
+   poolGive(buffer);
+   holdMainMemory(-(long) poolBufferSize(), false);
+}
+
+/**
+ *  \brief Function created to hand a buffer of main to the workers, as a chunk or as a piece of a token.
+ *
+ *  The memory of the buffer stops being counted as held by main and is counted as held by the chunk.
+ *
+ *  \param chunk start of the chunk, in a buffer taken with takeBuffer
+ *  \param size number of bytes of the chunk
+ *  \param fileId file identifier
+ *  \param piece piece of a token the chunk holds (NULL: none)
+ */
+static void handOver(unsigned char *chunk, long size, int fileId, struct TokenPiece *piece){
+
+   holdMainMemory(-(long) poolBufferSize(), false);
+   if (piece != NULL) saveChunkPiece(chunk, size, fileId, piece);
+   else saveChunkBuffer(chunk, size, fileId);
+}
+
+/**
+ *  \brief Function created to open the files and compute their ranges, when the workers split the files themselves.
+ *
+ *  Operation carried out by main, before the workers are created.
+ *
+ *  \param nFiles number of files
+ *  \param files names of the files
+ */
+static void prepareFileRanges(int nFiles, char **files){
+
+   fileDescriptors = malloc(nFiles * sizeof(int));
+   fileSizes = malloc(nFiles * sizeof(long));
+   firstRange = malloc((nFiles + 1) * sizeof(long));
+   if (fileDescriptors == NULL || fileSizes == NULL || firstRange == NULL) {
+      perror("Failed to allocate memory");
+      exit(EXIT_FAILURE);
+   }
+
+   firstRange[0] = 0;
+   for (int i = 0; i < nFiles; i++) {
+      struct stat st;
+
+      if (reportFromCache(i)) {                                      /* no ranges */
+         fileDescriptors[i] = -1;
+         fileSizes[i] = 0;
+         firstRange[i + 1] = firstRange[i];
+         continue;
+      }
+      if ((fileDescriptors[i] = open(files[i], O_RDONLY)) == -1 || fstat(fileDescriptors[i], &st) == -1) {
+         printf("It occoured an error while openning file: %s \n", files[i]);
+         exit(EXIT_FAILURE);
+      }
+      fileSizes[i] = st.st_size;
+      firstRange[i + 1] = firstRange[i] + (st.st_size + RANGE_SIZE - 1) / RANGE_SIZE;
+   }
+
+   if ((rangeTexts = malloc((firstRange[nFiles] + 1) * sizeof(struct cle_text))) == NULL) {
+      perror("Failed to allocate memory");
+      exit(EXIT_FAILURE);
+   }
+   atomic_init(&rangeCursor, 0);
+}
+
+/**
+ *  \brief Function created to find the file a range belongs to.
+ *
+ *  \param range range index
+ *
+ *  \return file identifier
+ */
+static int fileOfRange(long range){
+
+   int lo = 0, hi = numFiles - 1;
+
+   /* last file whose first range is not after the range (empty files have no ranges and are skipped) */
+   while (lo < hi) {
+      int mid = (lo + hi + 1) / 2;
+      if (firstRange[mid] <= range) lo = mid;
+      else hi = mid - 1;
+   }
+   return lo;
+}
+
+/**
+ *  \brief Function created to read a range of a file.
+ */
+static void readRange(int fd, unsigned char *buffer, long size, long offset){
+
+   long done = 0;
+
+   while (done < size) {
+      ssize_t n = pread(fd, buffer + done, size - done, offset + done);
+      if (n <= 0) {
+         perror("Failed to read file");
+         exit(EXIT_FAILURE);
+      }
+      done += n;
+   }
+}
+
+/**
+ *  \brief Function where a worker claims and processes byte ranges of the files.
  *
- *  Its role is to simulate the life cycle of a worker.
+ *  Ranges are claimed from an atomic cursor. Each range is processed from the start of its own statistics, with no
+ *  search for a separator, and its state is left for main, which merges the ranges of each file in order.
  *
- *  \param par pointer to application defined worker identification
+ *  \param workerId worker identification
  */
-static void *worker(void *par) {
-    
-   unsigned int id = *((unsigned int *) par);      // worker id
-   struct Chunk chunk;
-   struct ParRes parRes;
-    
-   while (readTextChunk(&chunk, &parRes, id)){
+static void processFileRanges(unsigned int workerId){
 
-      /* perform text processing on the chunk */
-      processTextChunk(chunk.chunk_pointer, chunk.size, &parRes);
-   
-      /* free the memory of the buffer if it was allocated */
-      free(chunk.chunk_pointer);
+   unsigned char *buffer = malloc(RANGE_SIZE);
+   long totalRanges = firstRange[numFiles];
+   long range;
 
-      /* save partial results */
-      savePartialResults(id, parRes.numberOfWords, parRes.vowelWords[0], parRes.vowelWords[1], parRes.vowelWords[2], parRes.vowelWords[3], parRes.vowelWords[4], parRes.vowelWords[5], parRes.fileID);
-      
+   if (buffer == NULL) {
+      perror("Failed to allocate memory");
+      exit(EXIT_FAILURE);
    }
 
-   workersStatus[id] = EXIT_SUCCESS;
-   pthread_exit (&workersStatus[id]);
-    
+   while ((range = atomic_fetch_add(&rangeCursor, 1)) < totalRanges) {
+      int fileId = fileOfRange(range);
+      long offset = (range - firstRange[fileId]) * RANGE_SIZE;
+      long size = (fileSizes[fileId] - offset < RANGE_SIZE) ? fileSizes[fileId] - offset : RANGE_SIZE;
+      struct timespec start;
+
+      stageBegin(&start);
+      readRange(fileDescriptors[fileId], buffer, size, offset);
+      stageEnd(workerId, STAGE_READ, &start);
+
+      stageBegin(&start);
+      cle_text_init(&rangeTexts[range]);
+      cle_text_feed(&rangeTexts[range], buffer, size);
+      stageEnd(workerId, STAGE_PROCESS, &start);
+      statsCountChunk(workerId, size);
+   }
+
+   free(buffer);
 }
 
 /**
- *  \brief Function created to check the next chunk of text, and returns true if it was successful.
- * 
- *  \param chunk pointer to a chunk struct
- *  \param parRes pointer to a partial results struct
- *  \param workerID worker identification
+ *  \brief Function created to merge the statistics of the ranges of each file.
+ *
+ *  Operation carried out by main, after the workers are done. A word divided between two ranges is counted once.
  */
-static bool readTextChunk(struct Chunk* chunk, struct ParRes* parRes, int workerID){
+static void mergeFileRanges(void){
 
-   /* get chunk from fifo */
-   (*chunk) = retrieveChunk(workerID);
+   for (int f = 0; f < numFiles; f++) {
+      struct ParRes parRes = {0, {0,0,0,0,0,0}, f};
+      struct cle_text text;
+      struct cle_text_counts counts;
 
-   /* checks if it is the chunk that tells that there are no more chunks to process */
-   if ((chunk->chunk_pointer == NULL) && (chunk->fileId == -1)) return false;
+      cle_text_init(&text);
+      for (long range = firstRange[f]; range < firstRange[f + 1]; range++) {
+         cle_text_merge(&text, &rangeTexts[range]);
+      }
+      cle_text_finish(&text, &counts);
 
-   /* initialize the vars in parRes*/
-   parRes->fileID = chunk->fileId;
-   parRes->numberOfWords = 0;
-   for (int i = 0; i < 6; i++) {
-      parRes->vowelWords[i] = 0;
+      parRes.numberOfWords = counts.words;
+      for (int v = 0; v < 6; v++) {
+         parRes.vowelWords[v] = counts.vowels[v];
+      }
+      addWorkerCounters(0, &parRes);
    }
-
-   return true;
 }
 
 /**
- *  \brief Function created to process one text chunk.
- * 
- *  \param chunk_pointer pointer to a chunk of text
- *  \param size size of the chunk
- *  \param parRes pointer to a partial results struct
+ *  \brief Function where main serves the requests of the daemon mode.
+ *
+ *  The workers, the fifo and the chunk buffers stay up between requests. Main takes the files of the requests in
+ *  turn, one file of each request at a time and up to DAEMON_SPLITS files, and splits them into the fifo in their
+ *  slots of the shared region, as it does with the files of -f. The files take turns of DAEMON_TURN chunks, keeping
+ *  their read position between turns, and main polls the requests after each turn, so a small request is accepted
+ *  and answered while a large file is split. It waits for the next event when there is no file to split. A file that
+ *  is not a regular file, or can not be opened, is answered with an error.
  */
-static void processTextChunk(unsigned char * chunk_pointer, int size, struct ParRes * partialResults){
-
-   int words = 0; int as = 0; int es = 0; int is = 0; int os = 0; int us = 0; int ys = 0;
-   int previousVowelCheck[6] = {0,0,0,0,0,0};
-   bool inWord = false;
-   int byte;
-   char vowel;
-   struct State state = {0};
-   for (size_t i = 0; i < size; i++) {
-      unsigned char ch = chunk_pointer[i]; // read the byte at index i
-      byte = f_getc(ch, &state);
-      if (byte != -1 ){
-         if (is_alpha_numeric(byte, inWord)){
-            if (inWord == false){
-               inWord = true;
-               words++;
-            }
-            vowel = is_vowel(byte);
-            if (vowel == 'A' && previousVowelCheck[0] == 0){
-               as++;
-               previousVowelCheck[0] = 1;
-            }
-            else if (vowel == 'E' && previousVowelCheck[1] == 0){
-               es++;
-               previousVowelCheck[1] = 1;
-            }
-            else if (vowel == 'I' && previousVowelCheck[2] == 0){
-               is++;
-               previousVowelCheck[2] = 1;
-            }
-            else if (vowel == 'O' && previousVowelCheck[3] == 0){
-               os++;
-               previousVowelCheck[3] = 1;
-            }
-            else if (vowel == 'U' && previousVowelCheck[4] == 0){
-               us++;
-               previousVowelCheck[4] = 1;
-            }
-            else if (vowel == 'Y' && previousVowelCheck[5] == 0){
-               ys++;
-               previousVowelCheck[5] = 1;
-            }
+static void serveRequests(void){
+
+   struct TextSplit *splits;                  /* split of the file of each slot */
+   int active[DAEMON_SPLITS];                 /* slots of the files being split, in the order of their turns */
+   int nActive = 0;
+   int next = 0;                              /* file whose turn comes next */
+   int slot;
+   const char *name;
+
+   if ((chunkSizers = calloc(numFiles, sizeof(struct ChunkSizer))) == NULL ||
+       (splits = malloc(numFiles * sizeof(struct TextSplit))) == NULL) {
+      perror("Failed to allocate memory");
+      exit(EXIT_FAILURE);
+   }
+
+   while (serverPoll(nActive == 0)) {
+      struct stat st;
+      FILE *fp;
+
+      while (nActive < DAEMON_SPLITS && serverNextFile(&slot, &name)) {
+         fp = fopen(name, "rb");
+         if (fp == NULL || fstat(fileno(fp), &st) != 0 || !S_ISREG(st.st_mode)) {
+            if (fp != NULL) fclose(fp);
+            serverFileFailed(slot);
+            fileSplitDone(slot, 0);
+            serverFileSplit(slot);
+            continue;
          }
-         else{
-            previousVowelCheck[0] = 0;
-            previousVowelCheck[1] = 0;
-            previousVowelCheck[2] = 0;
-            previousVowelCheck[3] = 0;
-            previousVowelCheck[4] = 0;
-            previousVowelCheck[5] = 0;
-            inWord = false;
+         splitStart(&splits[slot], fp, slot, -1);
+         active[nActive++] = slot;
+      }
+      if (nActive == 0) continue;
+
+      if (next >= nActive) next = 0;
+      slot = active[next];
+      if (!splitChunks(&splits[slot], DAEMON_TURN)) {
+         next++;
+         continue;
+      }
+      fclose(splits[slot].file);
+      fileSplitDone(slot, chunkSizers[slot].chunks);
+      serverFileSplit(slot);
+      nActive--;
+      memmove(&active[next], &active[next + 1], (nActive - next) * sizeof(int));
+   }
+
+   /* the files still being split are left as they are, the server is stopping */
+   for (int k = 0; k < nActive; k++) {
+      fclose(splits[active[k]].file);
+      giveBuffer(splits[active[k]].buffer);
+   }
+   free(splits);
+}
+
+/**
+ *  \brief Function created to open the files and pick the units sampled of each one, with --approx.
+ *
+ *  Operation carried out by main, before the workers are created. The units are of the chunk size set with -c, or
+ *  of RANGE_SIZE bytes.
+ *
+ *  \param nFiles number of files
+ *  \param files names of the files
+ */
+static void prepareSamples(int nFiles, char **files){
+
+   fileDescriptors = malloc(nFiles * sizeof(int));
+   fileSizes = malloc(nFiles * sizeof(long));
+   if (fileDescriptors == NULL || fileSizes == NULL) {
+      perror("Failed to allocate memory");
+      exit(EXIT_FAILURE);
+   }
+
+   for (int i = 0; i < nFiles; i++) {
+      struct stat st;
+
+      if ((fileDescriptors[i] = open(files[i], O_RDONLY)) == -1 || fstat(fileDescriptors[i], &st) == -1) {
+         printf("It occoured an error while openning file: %s \n", files[i]);
+         exit(EXIT_FAILURE);
+      }
+      fileSizes[i] = st.st_size;
+   }
+
+   if (samplingInit(nFiles, fileSizes, (chunkSize > 0) ? chunkSize : RANGE_SIZE, approxFraction, approxSeed) != 0) {
+      perror("Failed to allocate memory");
+      exit(EXIT_FAILURE);
+   }
+   atomic_init(&rangeCursor, 0);
+}
+
+/**
+ *  \brief Function created to find where a unit sampled starts or ends.
+ *
+ *  The bytes of a unit up to its first separator belong to the word the unit on its left ends with, so both ends of
+ *  a unit are moved to the byte after the first separator at or after them. The units of a file then start and end
+ *  between words and add up to the whole file, as the chunks do.
+ *
+ *  \param fd file descriptor of the file
+ *  \param offset offset of the start of a unit
+ *  \param fileSize number of bytes of the file
+ *
+ *  \return offset of the first byte after a separator, not before the offset (0 or the size at the ends of the file)
+ */
+static long unitBoundary(int fd, long offset, long fileSize){
+
+   unsigned char block[TAIL_BLOCK];
+
+   if (offset == 0 || offset >= fileSize) return (offset == 0) ? 0 : fileSize;
+
+   /* the byte before the offset may already be a separator */
+   offset--;
+   while (offset < fileSize) {
+      int n = (fileSize - offset < TAIL_BLOCK) ? (int) (fileSize - offset) : TAIL_BLOCK;
+
+      readRange(fd, block, n, offset);
+      for (int i = 0; i < n; i++) {
+         if (is_separator(block[i])) return offset + i + 1;
+      }
+      offset += n;
+   }
+   return fileSize;
+}
+
+/**
+ *  \brief Function where a worker claims and processes the units sampled, with --approx.
+ *
+ *  Units are claimed from an atomic cursor, in the order of the files and of their offsets, so the reads of each
+ *  file go forward. Each unit is moved to start and end between words and counted with processTextChunk, and its
+ *  counters are recorded for the estimates.
+ *
+ *  \param workerId worker identification
+ */
+static void processSamples(unsigned int workerId){
+
+   unsigned char *buffer = NULL;
+   long capacity = 0;
+   long totalUnits = samplingUnits();
+   long unit;
+
+   while ((unit = atomic_fetch_add(&rangeCursor, 1)) < totalUnits) {
+      struct ParRes parRes = {0, {0,0,0,0,0,0}, 0};
+      struct timespec start;
+      int fileId;
+      long offset;
+
+      samplingUnit(unit, &fileId, &offset);
+      parRes.fileID = fileId;
+
+      stageBegin(&start);
+      long unitSize = (chunkSize > 0) ? chunkSize : RANGE_SIZE;
+      long from = unitBoundary(fileDescriptors[fileId], offset, fileSizes[fileId]);
+      long to = unitBoundary(fileDescriptors[fileId], offset + unitSize, fileSizes[fileId]);
+      long size = (to > from) ? to - from : 0;
+
+      /* a word longer than a unit may leave a unit empty, or stretch it past its end */
+      if (size > capacity) {
+         free(buffer);
+         capacity = size;
+         if ((buffer = malloc(capacity)) == NULL) {
+            perror("Failed to allocate memory");
+            exit(EXIT_FAILURE);
          }
       }
+      if (size > 0) readRange(fileDescriptors[fileId], buffer, size, from);
+      stageEnd(workerId, STAGE_READ, &start);
+
+      stageBegin(&start);
+      if (size > 0) processTextChunk(buffer, size, &parRes);
+      samplingRecord(unit, parRes.numberOfWords, parRes.vowelWords);
+      stageEnd(workerId, STAGE_PROCESS, &start);
+      statsCountChunk(workerId, size);
    }
-   partialResults->numberOfWords = words;
-   partialResults->vowelWords[0] = as;
-   partialResults->vowelWords[1] = es;
-   partialResults->vowelWords[2] = is;
-   partialResults->vowelWords[3] = os;
-   partialResults->vowelWords[4] = us;
-   partialResults->vowelWords[5] = ys;
 
+   free(buffer);
 }
 
 /**
- *  \brief Function created to check split the text file into several text chunks.
- * 
- *  \param file pointer to a file
- *  \param chunks pointer to a pointer to a character, which represents a dynamic array of strings
+ *  \brief Function created to pick the chunk size of a file.
+ *
+ *  Unless it was set with -c, the file is divided in about CHUNKS_PER_WORKER chunks per worker, which balances the
+ *  load on small files and amortizes the fifo operations on big ones, within MIN_CHUNK_SIZE and MAX_CHUNK_SIZE.
+ *  When the files are scheduled by size, a file of up to smallFileSize bytes is a single chunk.
+ *
+ *  \param sizer chunk sizer of the file
+ *  \param fileSize number of bytes of the file
+ */
+static void initChunkSizer(struct ChunkSizer *sizer, long fileSize) {
+   long size = chunkSize;
+
+   if (sizeAware && fileSize <= smallFileSize) {
+      size = fileSize + 1;                       /* a small file is read, and handed to the workers, as a whole */
+   }
+   else if (size == 0) {
+      long target = fileSize / ((long) nWorkers * CHUNKS_PER_WORKER);
+
+      size = MIN_CHUNK_SIZE;
+      while (size < target && size < MAX_CHUNK_SIZE) {
+         size <<= 1;
+      }
+   }
+
+   sizer->size = sizer->initialSize = size;
+   sizer->chunks = 0;
+   sizer->lastProcessing = atomic_load_explicit(&processingTime, memory_order_relaxed);
+   sizer->lastWaiting = atomic_load_explicit(&waitingTime, memory_order_relaxed);
+}
+
+/**
+ *  \brief Function created to adjust the chunk size of a file while it is being split.
+ *
+ *  Called after each chunk is stored. Every ADJUST_PERIOD chunks, the time the workers spent waiting for chunks is
+ *  compared with the time they spent processing them: when waiting dominates, the fifo operations cost too much for
+ *  the work in each chunk and the size is doubled; when the end of the file is near, the size is halved so that the
+ *  last chunks are spread over all workers.
+ *
+ *  \param sizer chunk sizer of the file
+ *  \param remaining number of bytes of the file still to be split
+ */
+static void adjustChunkSize(struct ChunkSizer *sizer, long remaining) {
+   sizer->chunks++;
+   if (chunkSize != 0 || sizer->chunks % ADJUST_PERIOD != 0) return;
+
+   long processing = atomic_load_explicit(&processingTime, memory_order_relaxed);
+   long waiting = atomic_load_explicit(&waitingTime, memory_order_relaxed);
+
+   if (remaining < (long) sizer->size * nWorkers) {
+      if (sizer->size > MIN_CHUNK_SIZE) sizer->size >>= 1;
+   }
+   else if (waiting - sizer->lastWaiting > processing - sizer->lastProcessing) {
+      if (sizer->size < MAX_CHUNK_SIZE) sizer->size <<= 1;
+   }
+   sizer->lastProcessing = processing;
+   sizer->lastWaiting = waiting;
+}
+
+/**
+ *  \brief Function created to read the files with the asynchronous reader and store their chunks in the fifo.
+ *
+ *  Operation carried out by main. Up to readDepth blocks of several files are read at the same time, at most
+ *  READS_PER_FILE of each file, into buffers of the chunk pool. The blocks of a file may complete in any order, but
+ *  they are split in order, since the end of a block is glued to the start of the next one.
+ *
+ *  \param nFiles number of files
+ *  \param files names of the files
  */
-int splitTextIntoChunks(FILE *file, char **chunks) {
-   int chunk_index = 0;
-   int start_index = 0;
-   int bytes_to_read;
+static void produceChunksAsync(int nFiles, char **files){
+   int nSlots = (readDepth + READS_PER_FILE - 1) / READS_PER_FILE + 1;
+   struct OpenFile *open_files = calloc(nSlots, sizeof(struct OpenFile));
+   struct BlockRead *blocks = calloc(readDepth, sizeof(struct BlockRead));
+   struct BlockRead *freeBlocks = NULL;
+   int nextFile = 0, nOpen = 0, inFlight = 0, turn = 0;
 
-   while (!feof(file)) {
-      /* allocate memory for each chunk separately */
-      char *buffer = malloc(CHUNK_SIZE + 1);
-      if (buffer == NULL) {
+   if (open_files == NULL || blocks == NULL || (chunkSizers = calloc(nFiles, sizeof(struct ChunkSizer))) == NULL) {
+      perror("Failed to allocate memory");
+      exit(EXIT_FAILURE);
+   }
+   if (readerInit(readEngine, readDepth) != 0) {
+      fprintf(stderr, "error on setting up the asynchronous reader\n");
+      exit(EXIT_FAILURE);
+   }
+   for (int i = 0; i < readDepth; i++) {
+      blocks[i].next = freeBlocks;
+      freeBlocks = &blocks[i];
+   }
+   for (int i = 0; i < nSlots; i++) {
+      open_files[i].fileId = -1;
+      if ((open_files[i].carry = malloc(poolBufferSize() / 2)) == NULL) {
          perror("Failed to allocate memory");
-         return -1;
+         exit(EXIT_FAILURE);
+      }
+   }
+   holdMainMemory(nSlots * (long) (poolBufferSize() / 2), true);
+
+   for (;;) {
+      /* keep the slots busy with the next files */
+      for (int i = 0; i < nSlots && nextFile < nFiles; i++) {
+         struct OpenFile *file = &open_files[i];
+         struct stat st;
+
+         if (file->fileId != -1) continue;
+         int fileId = fileOrder[nextFile++];
+         if (reportFromCache(fileId)) {                              /* nothing to read */
+            i--;
+            continue;
+         }
+         if ((file->fd = open(files[fileId], O_RDONLY)) == -1 || fstat(file->fd, &st) == -1) {
+            printf("It occoured an error while openning file: %s \n", files[fileId]);
+            exit(EXIT_FAILURE);
+         }
+         initChunkSizer(&chunkSizers[fileId], st.st_size);
+         if (st.st_size == 0) {                                      /* nothing to read */
+            fileSplitDone(fileId, 0);
+            close(file->fd);
+            i--;
+            continue;
+         }
+         file->fileId = fileId;
+         file->size = st.st_size;
+         file->nextOffset = file->nextSequence = file->expected = 0;
+         file->inFlight = 0;
+         file->carrySize = 0;
+         file->piece = NULL;
+         file->inWord = false;
+         nOpen++;
       }
-      bytes_to_read = CHUNK_SIZE - start_index;
-      int bytes_read = fread(&buffer[start_index], 1, bytes_to_read, file);
-      int num_bytes_read = start_index + bytes_read;
 
-      if (bytes_read == 0) {
-         free(buffer);
+      /* submit reads, taking the open files in turn */
+      for (int idle = 0; freeBlocks != NULL && idle < nSlots; turn = (turn + 1) % nSlots) {
+         struct OpenFile *file = &open_files[turn];
+
+         if (file->fileId == -1 || file->nextOffset == file->size || file->inFlight == READS_PER_FILE) {
+            idle++;
+            continue;
+         }
+         idle = 0;
+
+         /* a read holds a whole buffer until its block is split, so while the memory budget is exhausted no more
+            reads are submitted, unless none is in flight */
+         if (!holdMainMemory(poolBufferSize(), inFlight == 0)) break;
+
+         struct BlockRead *block = freeBlocks;
+         long left = file->size - file->nextOffset;
+         long half = poolBufferSize() / 2;
+
+         freeBlocks = block->next;
+         block->size = (left < chunkSizers[file->fileId].size) ? left : chunkSizers[file->fileId].size;
+         block->filled = 0;
+         block->slot = turn;
+         block->sequence = file->nextSequence++;
+         block->buffer = poolTake();
+         block->request.fd = file->fd;
+         block->request.offset = file->nextOffset;
+         block->request.buffer = block->buffer + half;
+         block->request.length = block->size;
+         file->nextOffset += block->size;
+         file->inFlight++;
+         inFlight++;
+         readerSubmit(&block->request);
+      }
+
+      if (inFlight == 0) break;                                   /* every file was read and split */
+
+      /* wait for a read to complete */
+      struct timespec start;
+      stageBegin(&start);
+      struct BlockRead *block = (struct BlockRead *) readerWait();
+      stageEnd(statsMainSlot, STAGE_READ, &start);
+      struct OpenFile *file = &open_files[block->slot];
+
+      if (block->request.result < 0) {
+         errno = -block->request.result;
+         perror("Failed to read file");
+         exit(EXIT_FAILURE);
+      }
+      block->filled += block->request.result;
+      if (block->request.result > 0 && block->filled < block->size) {      /* short read, read the rest */
+         block->request.offset += block->request.result;
+         block->request.buffer += block->request.result;
+         block->request.length -= block->request.result;
+         readerSubmit(&block->request);
+         continue;
+      }
+
+      /* split the blocks of the file that are complete and in order */
+      file->ready[block->sequence % READS_PER_FILE] = block;
+      while ((block = file->ready[file->expected % READS_PER_FILE]) != NULL && block->sequence == file->expected) {
+         file->ready[file->expected % READS_PER_FILE] = NULL;
+         splitBlock(file, block);
+         block->next = freeBlocks;
+         freeBlocks = block;
+         file->expected++;
+         file->inFlight--;
+         inFlight--;
+      }
+
+      /* the whole file was split, the last block took what was left in the carry */
+      if (file->nextOffset == file->size && file->expected == file->nextSequence) {
+         fileSplitDone(file->fileId, chunkSizers[file->fileId].chunks);
+         close(file->fd);
+         file->fileId = -1;
+         nOpen--;
+      }
+   }
+
+   readerDestroy();
+   for (int i = 0; i < nSlots; i++) {
+      free(open_files[i].carry);
+   }
+   holdMainMemory(-nSlots * (long) (poolBufferSize() / 2), false);
+   free(open_files);
+   free(blocks);
+}
+
+/**
+ *  \brief Function created to split a block read by the asynchronous reader and store its chunk in the fifo.
+ *
+ *  The chunk is made of the bytes carried from the previous blocks, copied in front of the block (in the first half
+ *  of its buffer), and of the block up to its last ascii byte that is neither part of a word nor an apostrophe; the
+ *  bytes after it are carried to the next block. A block without such a byte is added to the carry, as long as the
+ *  carry fits in half a buffer; beyond that the carry and the block are handed to the workers as a piece of a long
+ *  token, whose states are merged in order, and only the bytes after the last character that ends words are carried
+ *  (none if they would not fit).
+ *
+ *  \param file file of the block
+ *  \param block block, split after all the previous blocks of the file
+ */
+static void splitBlock(struct OpenFile *file, struct BlockRead *block){
+   long half = poolBufferSize() / 2;
+   unsigned char *data = block->buffer + half;
+   long size = block->filled;
+   struct timespec start;
+
+   /* find the last byte the chunk can end after, the last block of the file takes everything that is left */
+   stageBegin(&start);
+   bool lastBlock = (file->nextOffset == file->size && block->sequence == file->nextSequence - 1);
+   long last_boundary_index = size - 1;
+   while (!lastBlock && last_boundary_index >= 0 && !is_boundary(data[last_boundary_index])) {
+      last_boundary_index--;
+   }
+   stageEnd(statsMainSlot, STAGE_SPLIT, &start);
+
+   if (last_boundary_index < 0 && !lastBlock) {
+      if (file->carrySize + size <= half) {
+         /* none, the whole block continues the carried token */
+         memcpy(file->carry + file->carrySize, data, size);
+         file->carrySize += size;
+         giveBuffer(block->buffer);
+      }
+      else {
+         /* the carried token does not fit in the carry any more, the carry and the block go as a piece of it, up to
+            its last character that ends words if what follows fits in the carry */
+         unsigned char *text = data - file->carrySize;
+         long total = file->carrySize + size;
+         bool startsInWord = file->inWord;
+
+         memcpy(text, file->carry, file->carrySize);
+         long cut = token_cut(text, total, half, &file->inWord);
+         memcpy(file->carry, text + cut, total - cut);
+         file->carrySize = total - cut;
+         file->piece = nextPiece(file->piece, false, startsInWord);
+         handOver(text, cut, file->fileId, file->piece);
+      }
+      return;
+   }
+
+   /* the chunk is the carry followed by the block up to the byte found, the buffer goes to the workers; the chunk
+      that ends a long token is its last piece */
+   long tail = size - last_boundary_index - 1;                          /* bytes to be carried */
+   unsigned char *chunk = data - file->carrySize;
+   long chunkLength = file->carrySize + last_boundary_index + 1;
+   memcpy(chunk, file->carry, file->carrySize);
+   memcpy(file->carry, data + last_boundary_index + 1, tail);
+   file->carrySize = tail;
+   if (file->piece == NULL && chunkLength == 0) {
+      giveBuffer(block->buffer);                                        /* empty last block of a file that shrank */
+      return;
+   }
+   handOver(chunk, chunkLength, file->fileId, (file->piece != NULL) ? nextPiece(file->piece, true, file->inWord) : NULL);
+   file->piece = NULL;
+   file->inWord = false;
+   adjustChunkSize(&chunkSizers[file->fileId], file->size - file->nextOffset);
+}
+
+/**
+ *  \brief Function created to split the text file into several text chunks and store them in the fifo.
+ *
+ *  The whole file is split at once, see splitChunks.
+ *
+ *  \param file pointer to a file
+ *  \param fileId file identifier
+ *  \param length number of bytes to be read from the current position (-1: up to the end of the file)
+ *
+ *  \return number of chunks generated
+ */
+long splitTextIntoChunks(FILE *file, int fileId, off_t length) {
+   struct TextSplit split;
+
+   splitStart(&split, file, fileId, length);
+   splitChunks(&split, LONG_MAX);
+
+   return split.chunks;
+}
+
+/**
+ *  \brief Function created to start splitting a text file into chunks, which splitChunks goes on with.
+ *
+ *  \param split state of the split, kept until the whole file is split
+ *  \param file pointer to a file
+ *  \param fileId file identifier
+ *  \param length number of bytes to be read from the current position (-1: up to the end of the file)
+ */
+static void splitStart(struct TextSplit *split, FILE *file, int fileId, off_t length) {
+   struct stat st;
+   bool sized = (fstat(fileno(file), &st) == 0) && S_ISREG(st.st_mode);
+
+   split->file = file;
+   split->fileId = fileId;
+   split->fileSize = (length >= 0) ? length : sized ? st.st_size : LONG_MAX;     /* the size of a pipe is not known */
+   split->left = (length >= 0) ? length : LONG_MAX;
+   split->consumed = 0;
+   split->carrySize = 0;
+   split->piece = NULL;
+   split->inWord = false;
+   split->chunks = 0;
+
+   initChunkSizer(&chunkSizers[fileId], split->fileSize);
+   split->buffer = takeBuffer();      /* the chunk is read straight into a pool buffer, handed over as is */
+}
+
+/**
+ *  \brief Function created to split a text file into chunks and store them in the fifo, up to a number of chunks.
+ *
+ *  Each chunk is stored as soon as it is cut, so the workers start right away and the memory used does not depend
+ *  on the size of the file (storing waits while the chunk memory budget is exhausted).
+ *
+ *  The file is read once, from start to end, so it may also be the standard input or a pipe. A chunk ends after its
+ *  last ascii byte that is neither part of a word nor an apostrophe, where the text can be cut without changing its
+ *  counters, and the bytes after it are carried to the start of the next buffer. A token without such a byte that
+ *  fills the whole buffer is handed to the workers in pieces, whose states are merged in order; a piece ends after
+ *  the last character of the buffer that ends words, and only a word that fills the whole buffer is cut.
+ *
+ *  The split stops after maxChunks chunks (the pieces of a token count as chunks), keeping the buffer with the bytes
+ *  carried and the read position of the file in split, and goes on from there when called again.
+ *
+ *  \param split state of the split, set by splitStart
+ *  \param maxChunks number of chunks stored before returning, if the file is not split by then
+ *
+ *  \return true if the whole file was split, false if it stopped after maxChunks chunks
+ */
+static bool splitChunks(struct TextSplit *split, long maxChunks) {
+   struct ChunkSizer *sizer = &chunkSizers[split->fileId];
+   long bufferSize = poolBufferSize();
+   long stored = 0;                                         /* chunks stored by this call */
+
+   while (true) {
+      struct timespec start;
+
+      if (stored == maxChunks) return false;
+
+      long to_read = (sizer->size > split->carrySize) ? sizer->size - split->carrySize : bufferSize - split->carrySize;
+      if (to_read > split->left) to_read = split->left;
+
+      stageBegin(&start);
+      long num_bytes_read = (to_read > 0) ? fread(split->buffer + split->carrySize, 1, to_read, split->file) : 0;
+      stageEnd(statsMainSlot, STAGE_READ, &start);
+      split->left -= num_bytes_read;
+
+      if (num_bytes_read == 0) {
+         if (ferror(split->file)) {
+            perror("Failed to read file");
+            exit(EXIT_FAILURE);
+         }
          break;
       }
 
-      /* find the last separator before the end of the chunk */
-      int last_separator_index = num_bytes_read - 1;
-      while (last_separator_index >= 0 && !is_separator(buffer[last_separator_index])) {
-         last_separator_index--;
+      /* find the last byte the chunk can end after, the carried bytes have none (at the end of the file the chunk
+         takes everything that is left) */
+      stageBegin(&start);
+      unsigned char *buffer = split->buffer;
+      long total = split->carrySize + num_bytes_read;
+      long last_boundary_index = total - 1;
+      bool atEnd = feof(split->file) || split->left == 0;
+      while (!atEnd && last_boundary_index >= split->carrySize && !is_boundary(buffer[last_boundary_index])) {
+         last_boundary_index--;
       }
+      stageEnd(statsMainSlot, STAGE_SPLIT, &start);
 
-      /* if no separator was found, roll back to the previous separator and truncate the chunk */
-      if (last_separator_index < 0) {
-         fseek(file, -num_bytes_read, SEEK_CUR);
-         free(buffer);
+      /* none, keep reading after the carried bytes, and hand them over as a piece of a token when they fill the
+         buffer, cut after its last character that ends words (in a word only if it fills the whole buffer) */
+      if (last_boundary_index < split->carrySize) {
+         split->carrySize = total;
+         if (split->carrySize == bufferSize) {
+            bool startsInWord = split->inWord;
+            long cut = token_cut(buffer, bufferSize, bufferSize - 1, &split->inWord);
+            unsigned char *next = takeBuffer();
+
+            memcpy(next, buffer + cut, bufferSize - cut);
+            split->piece = nextPiece(split->piece, false, startsInWord);
+            handOver(buffer, cut, split->fileId, split->piece);
+            split->buffer = next;
+            split->consumed += cut;
+            split->carrySize = bufferSize - cut;
+            stored++;
+         }
          continue;
       }
 
-      /* add the chunk to the array */
-      char *chunk = malloc(last_separator_index + 2); // increase size by 1 for null terminator
-      if (chunk == NULL) {
-         perror("Failed to allocate memory");
-         free(buffer);
-         return 1;
+      long remaining_bytes = total - last_boundary_index - 1;
+      split->consumed += last_boundary_index + 1;
+
+      /* hand the chunk to the workers, they give the buffer back to the pool, the rest goes to a new buffer; the
+         chunk that ends a long token is its last piece */
+      unsigned char *next = takeBuffer();
+      memcpy(next, buffer + last_boundary_index + 1, remaining_bytes);
+      handOver(buffer, last_boundary_index + 1, split->fileId,
+               (split->piece != NULL) ? nextPiece(split->piece, true, split->inWord) : NULL);
+      split->piece = NULL;
+      split->inWord = false;
+      split->buffer = next;
+      split->carrySize = remaining_bytes;
+      split->chunks++;
+      stored++;
+
+      adjustChunkSize(sizer, split->fileSize - split->consumed);
+   }
+
+   /* the text may end without a separator, or inside a long token, whose last piece may then be empty */
+   if (split->piece != NULL) {
+      handOver(split->buffer, split->carrySize, split->fileId, nextPiece(split->piece, true, split->inWord));
+      split->chunks++;
+      sizer->chunks++;
+   }
+   else if (split->carrySize > 0) {
+      handOver(split->buffer, split->carrySize, split->fileId, NULL);
+      split->chunks++;
+      sizer->chunks++;
+   }
+   else {
+      giveBuffer(split->buffer);
+   }
+   split->buffer = NULL;
+
+   return true;
+}
+
+/**
+ *  \brief Function created to split a memory-mapped file into chunk views.
+ *
+ *  No bytes are copied: each chunk is stored in the fifo as an (offset, size) pair into the mapping.
+ *  A chunk ends at the last separator before the chunk size or, when there is none, at the first
+ *  separator after it, so a word is never divided between two chunks.
+ *
+ *  \param map pointer to the start of the mapping
+ *  \param file_size number of bytes of the file
+ *  \param fileId file identifier
+ *
+ *  \return number of chunks generated
+ */
+static long splitMappedFile(unsigned char *map, long file_size, int fileId) {
+   struct ChunkSizer *sizer = &chunkSizers[fileId];
+   long chunk_index = 0;
+   long start = 0;
+
+   initChunkSizer(sizer, file_size);
+
+   while (start < file_size) {
+      long end = start + sizer->size;
+      struct timespec splitStart;
+
+      stageBegin(&splitStart);
+      if (end >= file_size) {
+         end = file_size;
+      }
+      else {
+         /* find the last separator before the end of the chunk */
+         long last_separator_index = end - 1;
+         while (last_separator_index >= start && !is_separator(map[last_separator_index])) {
+            last_separator_index--;
+         }
+
+         if (last_separator_index >= start) {
+            end = last_separator_index + 1;
+         }
+         else {
+            /* no separator inside the chunk, extend it up to the next one */
+            while (end < file_size && !is_separator(map[end])) {
+               end++;
+            }
+         }
       }
-      memcpy(chunk, buffer, last_separator_index + 1);
-      chunk[last_separator_index + 1] = '\0';
-      chunks[chunk_index++] = chunk;
 
-      /* move the file cursor back by the number of remaining bytes */
-      int remaining_bytes = num_bytes_read - last_separator_index - 1;
-      fseek(file, -remaining_bytes, SEEK_CUR);
-      start_index = 0;
+      stageEnd(statsMainSlot, STAGE_SPLIT, &splitStart);
 
-      free(buffer);
+      saveChunkView(fileId, start, end - start);
+      chunk_index++;
+      start = end;
+      adjustChunkSize(sizer, file_size - start);
    }
 
    return chunk_index;
@@ -417,6 +2547,39 @@ static double get_delta_time(void)
   return (double) (t1.tv_sec - t0.tv_sec) + 1.0e-9 * (double) (t1.tv_nsec - t0.tv_nsec);
 }
 
+/**
+ *  \brief Get the number of nanoseconds between two instants.
+ *
+ *  \param from first instant
+ *  \param to second instant
+ *
+ *  \return elapsed nanoseconds
+ */
+static long elapsedNs(const struct timespec *from, const struct timespec *to)
+{
+  return (to->tv_sec - from->tv_sec) * 1000000000L + (to->tv_nsec - from->tv_nsec);
+}
+
+/**
+ *  \brief Parse a number of bytes, optionally followed by a k, M or G suffix.
+ *
+ *  \param text text to be parsed
+ *
+ *  \return number of bytes, or -1 if the text is not a number
+ */
+static long parseSize(const char *text)
+{
+  char *suffix;
+  long size = strtol (text, &suffix, 10);
+
+  if (suffix == text) return -1;
+  if (*suffix == 'k' || *suffix == 'K') size <<= 10;
+  else if (*suffix == 'm' || *suffix == 'M') size <<= 20;
+  else if (*suffix == 'g' || *suffix == 'G') size <<= 30;
+  else if (*suffix != '\0') return -1;
+  return size;
+}
+
 /**
  *  \brief Print command usage.
  *
@@ -430,6 +2593,29 @@ static void printUsage (char *cmdName)
   fprintf (stderr, "\nSynopsis: %s [OPTIONS]\n"
            "  OPTIONS:\n"
            "  -t nThreads  --- set the number of threads to be created (default: 4)\n"
-           "  -f           --- set the text files to be processed\n"
+           "  -f           --- set the text files to be processed (- is the standard input)\n"
+           "  -M           --- memory-map the text files instead of copying them into chunks\n"
+           "  -P           --- let the workers split the files themselves, without a producer\n"
+           "  -S           --- schedule the files by size: the largest first, in chunks, and the small ones as a single chunk\n"
+           "  -s fifo      --- set the chunk fifo: monitor, ring (lock-free) or steal (work-stealing deque per worker) (default: monitor)\n"
+           "  -q capacity  --- set the number of chunks the fifo (each deque, with steal) can hold (default: 10)\n"
+           "  -m bytes     --- set the memory budget of the chunks waiting or being processed, k/M/G suffixes allowed, 0 for no limit (default: 64M)\n"
+           "  -T bytes     --- process the files in main, without worker threads, when their total size is at most bytes, 0 to never do it (default: 256k)\n"
+           "  -c bytes     --- set the chunk size, k/M suffixes allowed (default: picked from the size of each file and adjusted at runtime)\n"
+           "  -R [engine:]depth --- read the files with up to depth reads in flight, engine uring or pread (default: uring when available)\n"
+           "  -C file      --- report the files that did not change (same path, size, modification time and inode) from a result cache kept in file\n"
+           "  -H           --- with -C, also compare a hash of the content of the files\n"
+           "  -i           --- with -C, resume the files that only grew since they were stored, processing only what was appended\n"
+           "  -e file      --- also print the counters of each file to file (- for stdout, instead of at the end) as soon as it is complete\n"
+           "  -d socket    --- run as a daemon: keep the workers and the buffers, and process the files of each request received on\n"
+           "                    the Unix domain socket (one path per line, ended by an empty line), until SIGINT or SIGTERM\n"
+           "  -E min:max   --- resize the pool of workers between min and max from the time main and the workers wait on the fifo,\n"
+           "                    logging each change to stderr, starting with the workers of -t (default: min) (monitor fifo only)\n"
+           "  -w nWords    --- also print the nWords most frequent words (case folded) of each file and of all files\n"
+           "  --approx fraction --- estimate the counters from a stratified random sample of fraction (in ]0, 1]) of the text of each file,\n"
+           "                    in units of the chunk size set with -c (default: 64k), with 95%% confidence intervals\n"
+           "  --seed number --- set the seed of the units sampled with --approx (default: 1)\n"
+           "  -v           --- print statistics of the run to stderr (time of each thread in each stage, chunk sizes, pool)\n"
+           "  -F nChunks   --- flush the counters of each worker to the shared region every nChunks (default: only at the end)\n"
            "  -h           --- print this help\n", cmdName);
 }
\ No newline at end of file
@@ -4,112 +4,66 @@
 #include <stdbool.h>
 #include <string.h>
 
-struct State{
-    unsigned char buffer[4];
-    int buffer_pos;
-    int bytes_remaining;
-};
+#include "cleText.h"
 
 int is_separator(char c){
    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
 }
 
-/**
- *  \brief Function to check what vowel is.
- */
-char is_vowel(int c){
-    if (c >= 0xE0)
-        c = c - 0x20;  // upper case
-    // a ou AÀÁÂÃ
-    if (c == 0x61 || c == 0x41 || (0xC0 <= c && c <= 0xC3))
-        return 'A'; 
-    
-    // e ou EÈÉÊ
-    if (c == 0x65 || c == 0x45 || (0xC8 <= c && c <= 0xCA))
-        return 'E'; 
-
-    // i ou IÌÍ
-    if (c == 0x69 || c == 0x49 || (0xCC <= c && c <= 0xCD))
-        return 'I'; 
-    
-    // o ou OÒÓÔÕ
-    if (c == 0x6F || c == 0x4F || (0xD2 <= c && c <= 0xD5))
-        return 'O'; 
-    
-    // u ou UÙÚ
-    if (c == 0x75 || c == 0x55 || (0xD9 <= c && c <= 0xDA))
-        return 'U';
-
-    // y ou Y
-    if (c == 0x79 || c == 0x59)
-        return 'Y';
-    
-    return 'n';
+int is_boundary(unsigned char c){
+   return c < 0x80 && !(charClassTable[c] & (CHAR_WORD | CHAR_APOSTROPHE));
 }
 
-/**
- *  \brief Function to check if a char is alphanumeric.
- */
-int is_alpha_numeric(int c, bool inWord){
-    if (c >= 0xE0) c -= 0x20;  // upper case
-
-    if (c == 0x1FF9 || c == 0x1FF8) c = 0x27;  // convert single quotation marks to apostrophe
-
-    if (c == 0x27 && inWord == false)   // if an apostrophe is alone then is not considered to be counted as a word
-        return false;
-
-    // a-z A-Z
-    return ((0x41 <= c && c <= 0x5A) || (0x61 <= c && c <= 0x7A)) || 
-        // apostrophe ('), cedilla (Ç), underscore (_)
-        c == 0x27 || c == 0xC7 || c == 0x5F ||
-        // ÀÁÂÃ ÈÉÊ ÌÍ
-        (0xC0 <= c && c <= 0xC3) || (0xC8 <= c && c <= 0xCA) || (0xCC <= c && c <= 0xCD) ||
-        // ÒÓÔÕ ÙÚ
-        (0xD2 <= c && c <= 0xD5) || (0xD9 <= c && c <= 0xDA) ||
-        // 1 2 3 4 5 6 7 8 9
-        (0x30 <= c && c <= 0x39);
+long token_cut(const unsigned char *text, long size, long maxRest, bool *inWord){
+   long end = size;
+   struct State state = {UTF8_ACCEPT, 0};
+
+   /* find the end of the last character that ends words, decoding each character from its first byte */
+   while (end > 0) {
+      long last = end - 1;
+      if (text[last] < 0x80) {
+         if (is_boundary(text[last])) break;
+         end--;
+         continue;
+      }
+
+      long first = last;
+      while (first > 0 && first > last - 3 && (text[first] & 0xC0) == 0x80) first--;
+      int c = -1;
+      state.state = UTF8_ACCEPT;
+      for (long i = first; i <= last; i++) c = cle_text_decode(text[i], &state);
+      if (c != -1 && !(char_class(c) & (CHAR_WORD | CHAR_APOSTROPHE))) break;
+      end = (text[first] < 0x80) ? first + 1 : first;
+   }
+   if (size - end <= maxRest) {
+      *inWord = false;
+      return end;
+   }
+
+   /* too far from the end, cut the text before the character it ends in the middle of, if any */
+   long cut = size, first = size - 1;
+   while (first > 0 && first > size - 4 && (text[first] & 0xC0) == 0x80) first--;
+   if (text[first] >= 0xC0 && size - first < ((text[first] >= 0xF0) ? 4 : (text[first] >= 0xE0) ? 3 : 2)) cut = first;
+
+   /* the cut is in a word if a word character comes after the last character that ends words */
+   bool word = *inWord && end == 0;
+   state.state = UTF8_ACCEPT;
+   for (long i = end; i < cut && !word; i++) {
+      int c = cle_text_decode(text[i], &state);
+      if (c != -1 && (char_class(c) & CHAR_WORD)) word = true;
+   }
+   *inWord = word;
+
+   return cut;
 }
 
-/**
- *  \brief This function reads a byte of data, determines whether it is a single-byte character or part of a multi-byte sequence in UTF-8 encoding.
- */
-int f_getc(unsigned char byte, struct State *state) {
-    int ch;
-
-    // If there are bytes remaining in the buffer, store the input byte and continue processing
-    if (state->bytes_remaining > 0) {
-        state->buffer[state->buffer_pos++] = byte;
-        state->bytes_remaining--;
-
-        // If we have read all bytes of the multi-byte sequence, process it
-        if (state->bytes_remaining == 0) {
-            ch = state->buffer[0] & ((1 << (7 - state->buffer_pos)) - 1);
+long first_word_end(const unsigned char *text, long size){
+   struct State state = {UTF8_ACCEPT, 0};
 
-            for (int i = 1; i < state->buffer_pos; i++) {
-                ch = (ch << 6) | (state->buffer[i] & 0x3F);
-            }
+   for (long i = 0; i < size; i++) {
+      int c = cle_text_decode(text[i], &state);
+      if (c != -1 && !(char_class(c) & (CHAR_WORD | CHAR_APOSTROPHE))) return i + 1;
+   }
 
-            // Reset the buffer state
-            state->buffer_pos = 0;
-            return ch;
-        }
-
-        return -1; // Indicate that this byte is part of a multi-byte sequence and should be ignored
-    }
-
-    // Otherwise, process the input byte
-    ch = byte;
-
-    // If the byte is a single-byte character, return it as the Unicode code point
-    if ((ch & 0x80) == 0) return ch;
-
-    // Determine the size of the utf-8 character sequence
-    for (state->bytes_remaining = 1; ch & (0x80 >> state->bytes_remaining); state->bytes_remaining++);
-
-    // Store the first byte of the multi-byte sequence and update the buffer state
-    state->buffer[0] = byte;
-    state->buffer_pos = 1;
-    state->bytes_remaining--;
-
-    return -1; // Indicate that this byte is part of a multi-byte sequence and should be ignored
-}
\ No newline at end of file
+   return size;
+}
@@ -1,16 +1,19 @@
 #ifndef TEXT_PROCESSING_FUNCTIONS_H
 #define TEXT_PROCESSING_FUNCTIONS_H
 
-extern int is_alpha_numeric(int c, bool inWord);
-
-extern char is_vowel(int c);
+#include <stdbool.h>
 
 extern int is_separator(char c);
 
-extern struct State{
-    unsigned char buffer[4];
-    int buffer_pos;
-    int bytes_remaining;
-} State;
+/** \brief tell if a text may be cut after the byte: an ascii byte that is neither part of a word nor an apostrophe */
+extern int is_boundary(unsigned char c);
+
+/** \brief where a token that fills a buffer may be cut: after its last character that ends words, if at most maxRest
+           bytes follow it, or else before the character the text ends in the middle of; inWord tells if the text
+           starts in a word and is set to tell if the cut falls in one */
+extern long token_cut(const unsigned char *text, long size, long maxRest, bool *inWord);
+
+/** \brief number of bytes up to the first character that ends words, the whole text if none */
+extern long first_word_end(const unsigned char *text, long size);
 
 #endif
\ No newline at end of file
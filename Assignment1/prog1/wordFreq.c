@@ -0,0 +1,750 @@
+/**
+ *  \file wordFreq.c (implementation file)
+ *
+ *  \brief Problem name: Count Words.
+ *
+ *  Frequency of each word, per file and over all files (see wordFreq.h).
+ *
+ *  A word is read as in the word count: letters, digits, underscores and the apostrophes inside a word (those that
+ *  end it are left out of its key, so a quoted word is counted with the others). It is case folded (ascii and Latin-1
+ *  capitals are lowered, and the typographic apostrophes become ascii ones) and encoded back in utf-8 before being
+ *  hashed. A word whose key is longer than WORD_MAX bytes is not counted: the splitters may cut a word that fills a
+ *  whole buffer between two chunks, and it would have to be kept whole meanwhile.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "charTables.h"
+#include "cleText.h"
+#include "wordFreq.h"
+
+/** \brief number of bytes of each block of the key arena of a worker */
+#define ARENA_BLOCK (1024 * 1024)
+
+/** \brief number of bytes that may be read past the end of a word (every buffer holding words has them) */
+#define KEY_SLACK 8
+
+/** \brief number of bytes of the ascii blocks whose words are found with bit masks */
+#define WORD_BLOCK 64
+
+/** \brief number of bytes of the longest key counted (a buffer of the chunk pool holds at least 4 KiB, and no character
+           takes more than 3 bytes of the text per byte of its key) */
+#define WORD_MAX 1024
+
+/** \brief vowel set that addWord gives for the words longer than WORD_MAX bytes */
+#define LONG_WORD 64
+
+/** \brief number of slots of a table when it is created (a power of two) */
+#define INITIAL_SLOTS 1024
+
+/** \brief count of a word of a file in a table */
+struct WordEntry {
+   unsigned long head;               /* first 8 bytes of key, padded with zeros */
+   const unsigned char *key;         /* case folded word (NULL: free slot) */
+   long count;                       /* number of occurrences */
+   int fileId;                       /* file identifier (-1 in the table of all files) */
+   unsigned short length;            /* number of bytes of key */
+   unsigned char vowels;             /* bit v is set if the word contains vowel v */
+};
+
+/** \brief open addressing table of words, with linear probing */
+struct WordTable {
+   struct WordEntry *slots;          /* slots of the table */
+   unsigned long mask;               /* number of slots minus one */
+   unsigned int shift;               /* 64 minus the number of bits of mask */
+   unsigned long used;               /* number of slots used */
+};
+
+/** \brief block of the key arena of a worker */
+struct ArenaBlock {
+   struct ArenaBlock *next;          /* block allocated before */
+   size_t used;                      /* number of bytes used */
+   size_t size;                      /* number of bytes of data */
+   unsigned char data[];             /* keys */
+};
+
+/** \brief tables of a worker, padded to a cache line so that no two workers share one */
+struct WordWorker {
+   _Alignas(64) struct WordTable table;     /* words of the chunks of the worker */
+   struct ArenaBlock *arena;                /* keys of the tables */
+   unsigned char *scratch;                  /* word being read, when it spans more than one block */
+   size_t scratchSize;                      /* number of bytes of scratch */
+};
+
+/** \brief word and its number of occurrences, as kept in the heaps of the most frequent words */
+struct WordCount {
+   const unsigned char *key;         /* case folded word */
+   unsigned int length;              /* number of bytes of key */
+   long count;                       /* number of occurrences */
+};
+
+/** \brief most frequent words of a shard */
+struct ShardTop {
+   struct WordCount *fileTop;        /* heap of each file, topK entries per file */
+   int *fileTopSize;                 /* number of entries of the heap of each file */
+   struct WordCount *allTop;         /* heap of all files */
+   int allTopSize;                   /* number of entries of the heap of all files */
+   int status;                       /* 0 on success, -1 if the memory could not be allocated */
+};
+
+/** \brief tables of each worker */
+static struct WordWorker *workers = NULL;
+
+/** \brief number of workers */
+static unsigned int nWordWorkers = 0;
+
+/** \brief number of shards of the words, by their hash (one merge thread per shard) */
+static unsigned int nShards = 0;
+
+/** \brief number of files */
+static int nWordFiles = 0;
+
+/** \brief number of most frequent words kept */
+static int topK = 0;
+
+/** \brief most frequent words of each shard, set by the merge */
+static struct ShardTop *shardTops = NULL;
+
+/**
+ *  \brief Read the bytes of a word from offset i on, at most 8, padding with zeros.
+ */
+static inline unsigned long keyBytes(const unsigned char *key, unsigned int i, unsigned int length){
+   unsigned long bytes;
+
+   memcpy(&bytes, key + i, 8);
+   return (length - i >= 8) ? bytes : bytes & (~0UL >> (64 - 8 * (length - i)));
+}
+
+/**
+ *  \brief Tell if two words of the same length are equal, comparing 8 bytes at a time.
+ */
+static inline bool sameKey(const unsigned char *a, const unsigned char *b, unsigned int length){
+   for (unsigned int i = 0; i < length; i += 8) {
+      if (keyBytes(a, i, length) != keyBytes(b, i, length)) return false;
+   }
+   return true;
+}
+
+/**
+ *  \brief Hash of a word: its head for the words of up to 8 bytes (no word holds a zero byte, so the head tells them
+ *  apart), mixed with the rest of the key, 8 bytes at a time, for the longer ones.
+ *
+ *  The words are placed by the high bits of a product with the hash, which depend on all its bits, so a word of up to
+ *  8 bytes is found with one multiplication.
+ *
+ *  \param head first 8 bytes of key, as read by keyBytes
+ */
+static inline unsigned long keyHash(const unsigned char *key, unsigned long head, unsigned int length){
+   unsigned long hash = head ^ length;
+
+   for (unsigned int i = 8; i < length; i += 8) {
+      hash = (hash * 0xBF58476D1CE4E5B9UL) ^ keyBytes(key, i, length);
+   }
+   return hash;
+}
+
+/**
+ *  \brief Shard of a word, taken from the high bits of a product with its hash.
+ */
+static inline unsigned int shardOf(unsigned long hash){
+   return (unsigned int) ((((hash * 0x9E3779B97F4A7C15UL) >> 32) * nShards) >> 32);
+}
+
+/**
+ *  \brief First slot of a table where a word of a file is looked for, taken from the high bits of a product with its
+ *  hash.
+ */
+static inline unsigned long slotOf(const struct WordTable *table, unsigned long hash, int fileId){
+   return ((hash + (unsigned long) (fileId + 1) * 0x9E3779B97F4A7C15UL) * 0xBF58476D1CE4E5B9UL) >> table->shift;
+}
+
+/**
+ *  \brief Create an empty table.
+ *
+ *  \return 0 on success, -1 if the memory could not be allocated
+ */
+static int tableInit(struct WordTable *table, unsigned long slots){
+   if ((table->slots = calloc(slots, sizeof(struct WordEntry))) == NULL) return -1;
+   table->mask = slots - 1;
+   table->shift = 64 - __builtin_ctzl(slots);
+   table->used = 0;
+   return 0;
+}
+
+/**
+ *  \brief Find the slot of a word of a file: the slot holding it or the free slot where it goes.
+ *
+ *  Words of up to 8 bytes are compared with the head of the entries only, the key of the others is read past the
+ *  head.
+ *
+ *  \param head first 8 bytes of key, as read by keyBytes
+ */
+static inline struct WordEntry *tableSlot(struct WordTable *table, unsigned long head, const unsigned char *key,
+                                          unsigned int length, int fileId){
+   for (unsigned long i = slotOf(table, keyHash(key, head, length), fileId); ; i = (i + 1) & table->mask) {
+      struct WordEntry *e = &table->slots[i];
+
+      if (e->key == NULL || (e->head == head && e->length == length && e->fileId == fileId
+                             && (length <= 8 || sameKey(e->key + 8, key + 8, length - 8)))) return e;
+   }
+}
+
+/**
+ *  \brief Count a new entry in a table, doubling the table when it is half full.
+ *
+ *  \return 0 on success, -1 if the memory could not be allocated
+ */
+static int tableUsed(struct WordTable *table){
+   if (++table->used * 2 <= table->mask + 1) return 0;
+
+   struct WordTable bigger;
+   if (tableInit(&bigger, 2 * (table->mask + 1)) != 0) return -1;
+   for (unsigned long i = 0; i <= table->mask; i++) {
+      struct WordEntry *e = &table->slots[i];
+
+      if (e->key != NULL) *tableSlot(&bigger, e->head, e->key, e->length, e->fileId) = *e;
+   }
+   bigger.used = table->used;
+   free(table->slots);
+   *table = bigger;
+   return 0;
+}
+
+/**
+ *  \brief Copy a word into the key arena of a worker.
+ */
+static const unsigned char *arenaCopy(struct WordWorker *worker, const unsigned char *key, unsigned int length){
+   struct ArenaBlock *block = worker->arena;
+
+   if (block == NULL || block->used + length > block->size) {
+      size_t size = (length > ARENA_BLOCK) ? length : ARENA_BLOCK;
+
+      if ((block = malloc(sizeof(struct ArenaBlock) + size + KEY_SLACK)) == NULL) {
+         perror("Failed to allocate memory");
+         exit(EXIT_FAILURE);
+      }
+      block->used = 0;
+      block->size = size;
+      block->next = worker->arena;
+      worker->arena = block;
+   }
+
+   unsigned char *copy = block->data + block->used;
+   memcpy(copy, key, length);
+   block->used += length;
+   return copy;
+}
+
+/**
+ *  \brief Set of the vowels of a case folded word (its characters are all below 0x800).
+ */
+static unsigned char keyVowels(const unsigned char *key, unsigned int length){
+   unsigned int vowels = 0;
+
+   for (unsigned int i = 0; i < length; i++) {
+      unsigned int c = key[i];
+
+      if (c >= 0x80) c = ((c & 0x1F) << 6) | (key[++i] & 0x3F);
+      int v = char_class(c) & CHAR_VOWEL;
+      if (v != 0) vowels |= 1u << (v - 1);
+   }
+   return vowels;
+}
+
+/**
+ *  \brief Count one occurrence of a word of a file in the table of a worker.
+ *
+ *  \param key case folded word, followed by KEY_SLACK readable bytes
+ *  \param head first 8 bytes of key, as read by keyBytes
+ *
+ *  \return set of the vowels of the word
+ */
+static inline unsigned int addKey(struct WordWorker *worker, const unsigned char *key, unsigned long head,
+                                  unsigned int length, int fileId){
+   struct WordEntry *e = tableSlot(&worker->table, head, key, length, fileId);
+
+   if (e->key != NULL) {
+      e->count++;
+      return e->vowels;
+   }
+   e->head = head;
+   e->key = arenaCopy(worker, key, length);
+   e->length = length;
+   e->fileId = fileId;
+   e->count = 1;
+   e->vowels = keyVowels(key, length);
+
+   unsigned int vowels = e->vowels;
+   if (tableUsed(&worker->table) != 0) {
+      perror("Failed to allocate memory");
+      exit(EXIT_FAILURE);
+   }
+   return vowels;
+}
+
+/**
+ *  \brief Count one occurrence of a word of a file, leaving the apostrophes that end it out of its key.
+ *
+ *  \return set of the vowels of the word, LONG_WORD if it is longer than WORD_MAX bytes
+ */
+static inline unsigned int addWord(struct WordWorker *worker, const unsigned char *key, unsigned int length, int fileId){
+   if (length > WORD_MAX) return LONG_WORD;
+   while (key[length - 1] == '\'') length--;
+   return addKey(worker, key, keyBytes(key, 0, length), length, fileId);
+}
+
+/**
+ *  \brief Case fold a character of a word and encode it in utf-8.
+ *
+ *  \return number of bytes written (the characters of a word are all below 0x800 once folded)
+ */
+static inline unsigned int foldCharacter(unsigned int c, unsigned char cls, unsigned char *out){
+   if (cls & CHAR_APOSTROPHE) c = '\'';
+   else if (c - 'A' < 26) c += 'a' - 'A';
+   else if (c >= 0xC0 && c <= 0xDE && c != 0xD7) c += 0x20;
+
+   if (c < 0x80) {
+      out[0] = c;
+      return 1;
+   }
+   out[0] = 0xC0 | (c >> 6);
+   out[1] = 0x80 | (c & 0x3F);
+   return 2;
+}
+
+/** \brief case folded ascii characters of a word, 0 for the characters that end words */
+static unsigned char asciiFold[128];
+
+/**
+ *  \brief Append bytes to the word being read in the scratch buffer of a worker (beyond WORD_MAX bytes only the length
+ *  of the word is kept, over WORD_MAX).
+ */
+static inline void appendKey(struct WordWorker *worker, unsigned int *length, const unsigned char *bytes, unsigned int n){
+   if (*length + n > WORD_MAX) {
+      *length = WORD_MAX + 1;
+      return;
+   }
+   if (*length + n > worker->scratchSize) {
+      size_t size = 2 * worker->scratchSize + n;
+      unsigned char *scratch = realloc(worker->scratch, size + KEY_SLACK);
+
+      if (scratch == NULL) {
+         perror("Failed to allocate memory");
+         exit(EXIT_FAILURE);
+      }
+      worker->scratch = scratch;
+      worker->scratchSize = size;
+   }
+   memcpy(worker->scratch + *length, bytes, n);
+   *length += n;
+}
+
+/**
+ *  \brief Read the first bytes of an ascii word of the text, at most 8, with the capital letters lowered.
+ *
+ *  This gives the head of the key (as keyBytes would read it from the folded word) with plain integer operations,
+ *  straight from the text, where reading it back from a block just folded would wait for its vector stores. No byte
+ *  is over 0x7F, so adding to a byte never carries into the next one.
+ */
+static inline unsigned long foldAsciiHead(const unsigned char *text, unsigned int length){
+   const unsigned long ones = 0x0101010101010101UL;
+   unsigned long bytes;
+
+   memcpy(&bytes, text, 8);
+   if (length < 8) bytes &= ~0UL >> (64 - 8 * length);
+   unsigned long upper = (bytes + ones * (0x80 - 'A')) & ~(bytes + ones * (0x80 - 'Z' - 1)) & (ones * 0x80);
+   return bytes | (upper >> 2);
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+
+/**
+ *  \brief Fold a block of WORD_BLOCK bytes if it is pure ascii, and get the masks of its word characters.
+ *
+ *  \param p start of the block
+ *  \param folded block with the capital letters lowered
+ *  \param word bit i is set if byte i is a letter, digit or underscore
+ *  \param apos bit i is set if byte i is an apostrophe
+ *
+ *  \return true if the block is pure ascii
+ */
+static inline bool foldAsciiBlock(const unsigned char *p, unsigned char *folded, unsigned long *word, unsigned long *apos){
+   const __m128i caseBit = _mm_set1_epi8(0x20);
+
+   *word = *apos = 0;
+   for (int q = 0; q < WORD_BLOCK; q += 16) {
+      __m128i b = _mm_loadu_si128((const __m128i *) (p + q));
+      if (_mm_movemask_epi8(b) != 0) return false;
+
+      __m128i lower = _mm_or_si128(b, caseBit);
+      __m128i letter = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)), _mm_cmplt_epi8(lower, _mm_set1_epi8('z' + 1)));
+      __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(b, _mm_set1_epi8('0' - 1)), _mm_cmplt_epi8(b, _mm_set1_epi8('9' + 1)));
+      __m128i under = _mm_cmpeq_epi8(b, _mm_set1_epi8('_'));
+      *word |= (unsigned long) _mm_movemask_epi8(_mm_or_si128(_mm_or_si128(letter, digit), under)) << q;
+      *apos |= (unsigned long) _mm_movemask_epi8(_mm_cmpeq_epi8(b, _mm_set1_epi8('\''))) << q;
+      _mm_storeu_si128((__m128i *) (folded + q), _mm_or_si128(b, _mm_and_si128(letter, caseBit)));
+   }
+   return true;
+}
+#else
+static inline bool foldAsciiBlock(const unsigned char *p, unsigned char *folded, unsigned long *word, unsigned long *apos){
+   return false;
+}
+#endif
+
+/**
+ *  \brief Set up the tables of the workers.
+ *
+ *  \param nWorkers number of workers (also the number of shards)
+ *  \param nFiles number of files
+ *  \param k number of most frequent words kept for each file and for all files
+ *
+ *  \return 0 on success, -1 if the memory could not be allocated
+ */
+int wordsInit(unsigned int nWorkers, int nFiles, int k){
+   nWordWorkers = nWorkers;
+   nShards = nWorkers;
+   for (unsigned int c = 0; c < 128; c++) {
+      unsigned char cls = char_class(c);
+
+      if (cls & (CHAR_WORD | CHAR_APOSTROPHE)) foldCharacter(c, cls, &asciiFold[c]);
+   }
+   nWordFiles = nFiles;
+   topK = k;
+
+   if ((workers = aligned_alloc(64, nWorkers * sizeof(struct WordWorker))) == NULL) return -1;
+   memset(workers, 0, nWorkers * sizeof(struct WordWorker));
+   for (unsigned int w = 0; w < nWorkers; w++) {
+      if (tableInit(&workers[w].table, INITIAL_SLOTS) != 0) return -1;
+      workers[w].scratchSize = 256;
+      if ((workers[w].scratch = malloc(workers[w].scratchSize + KEY_SLACK)) == NULL) return -1;
+   }
+   return 0;
+}
+
+/**
+ *  \brief Count the words of a piece of text of a file.
+ *
+ *  Operation carried out by the workers, each on its own table. The text must start and end between words, as the
+ *  chunks do. The number of words and of words containing each vowel are taken in the same pass, from the vowel set
+ *  kept with each word, so that the text does not have to be read again to count them.
+ *
+ *  \param workerId worker identification
+ *  \param text start of the text
+ *  \param size number of bytes of the text
+ *  \param fileId file identifier
+ *  \param counts set to the number of words and of vowel words of the text (may be NULL)
+ *
+ *  \return true if counts is complete, false if a word longer than WORD_MAX bytes was met (it is not in the tables,
+ *          so its vowels are unknown)
+ */
+bool wordsAddText(unsigned int workerId, const unsigned char *text, long size, int fileId, struct cle_text_counts *counts){
+   struct WordWorker *worker = &workers[workerId];
+   struct State state = {UTF8_ACCEPT, 0};
+   unsigned int length = 0;                             /* number of bytes of the word in scratch (0: none) */
+   long sets[LONG_WORD + 1] = {0};                      /* number of words of each vowel set */
+   long i = 0;
+
+   while (i < size) {
+      unsigned char folded[WORD_BLOCK + KEY_SLACK];
+      unsigned long word, apos;
+
+      /* pure ascii blocks are folded at once, and their words are found in bit masks (the head of a word is read from
+         the text, so KEY_SLACK bytes of text must follow the block) */
+      if (state.state == UTF8_ACCEPT && i + WORD_BLOCK + KEY_SLACK <= size && foldAsciiBlock(text + i, folded, &word, &apos)) {
+         unsigned long in = (length > 0) ? 1 : 0;
+         unsigned long seeds = ((word << 1) | in) & apos;
+         unsigned long inside = word | (((seeds + apos) ^ apos) & apos);
+
+         /* first and last byte of each run of characters of a word, a run that reaches the end of the block goes on
+            in the next one */
+         unsigned long starts = inside & ~((inside << 1) | in);
+         unsigned long ends = inside & ~(inside >> 1) & ~(1UL << (WORD_BLOCK - 1));
+
+         if (length > 0 && (!(inside & 1) || ends != 0)) {           /* the word in scratch ends here */
+            if (inside & 1) {
+               appendKey(worker, &length, folded, __builtin_ctzl(ends) + 1);
+               ends &= ends - 1;
+            }
+            sets[addWord(worker, worker->scratch, length, fileId)]++;
+            length = 0;
+         }
+         while (ends != 0) {
+            unsigned int start = __builtin_ctzl(starts), end = __builtin_ctzl(ends) + 1;
+
+            while ((apos >> (end - 1)) & 1) end--;
+            sets[addKey(worker, folded + start, foldAsciiHead(text + i + start, end - start), end - start, fileId)]++;
+            starts &= starts - 1;
+            ends &= ends - 1;
+         }
+         if (inside >> (WORD_BLOCK - 1)) {                              /* the word goes on in the next block */
+            unsigned int start = (starts != 0) ? __builtin_ctzl(starts) : 0;
+            appendKey(worker, &length, folded + start, WORD_BLOCK - start);
+         }
+         i += WORD_BLOCK;
+         continue;
+      }
+
+      /* otherwise the bytes are decoded one at a time, up to the next block */
+      for (long blockEnd = (i + 16 < size) ? i + 16 : size; i < blockEnd; i++) {
+         unsigned char bytes[2];
+         unsigned int n = 0, c = text[i];
+
+         if (c < 0x80 && state.state == UTF8_ACCEPT) {
+            bytes[0] = asciiFold[c];
+            if (bytes[0] != 0 && (bytes[0] != '\'' || length > 0)) n = 1;
+         }
+         else {
+            int decoded = cle_text_decode(text[i], &state);
+            if (decoded == -1) continue;
+
+            unsigned char cls = char_class(decoded);
+            if ((cls & CHAR_WORD) || ((cls & CHAR_APOSTROPHE) && length > 0)) n = foldCharacter(decoded, cls, bytes);
+         }
+
+         if (n > 0) appendKey(worker, &length, bytes, n);
+         else if (length > 0) {                                        /* a character that ends words */
+            sets[addWord(worker, worker->scratch, length, fileId)]++;
+            length = 0;
+         }
+      }
+   }
+   if (length > 0) sets[addWord(worker, worker->scratch, length, fileId)]++;
+
+   if (counts != NULL) {
+      memset(counts, 0, sizeof(struct cle_text_counts));
+      for (unsigned int set = 0; set < LONG_WORD; set++) {
+         counts->words += sets[set];
+         for (int v = 0; v < 6; v++) {
+            if (set & (1u << v)) counts->vowels[v] += sets[set];
+         }
+      }
+   }
+   return sets[LONG_WORD] == 0;
+}
+
+/**
+ *  \brief Tell if a word comes before another one in the ranking: more occurrences, then alphabetical order.
+ */
+static inline int better(const struct WordCount *a, const struct WordCount *b){
+   if (a->count != b->count) return a->count > b->count;
+
+   unsigned int n = (a->length < b->length) ? a->length : b->length;
+   int order = memcmp(a->key, b->key, n);
+   return (order != 0) ? order < 0 : a->length < b->length;
+}
+
+/**
+ *  \brief Offer a word to a heap of the topK most frequent words, whose root is the last one of the ranking.
+ */
+static void heapPush(struct WordCount *heap, int *size, struct WordCount item){
+   int i;
+
+   if (*size < topK) {
+      for (i = (*size)++; i > 0 && better(&heap[(i - 1) / 2], &item); i = (i - 1) / 2) {
+         heap[i] = heap[(i - 1) / 2];
+      }
+      heap[i] = item;
+      return;
+   }
+   if (!better(&item, &heap[0])) return;
+
+   for (i = 0; 2 * i + 1 < *size; ) {
+      int child = 2 * i + 1;
+
+      if (child + 1 < *size && better(&heap[child], &heap[child + 1])) child++;
+      if (!better(&item, &heap[child])) break;
+      heap[i] = heap[child];
+      i = child;
+   }
+   heap[i] = item;
+}
+
+/**
+ *  \brief Merge thread: merges one shard of the tables of all workers and keeps its most frequent words.
+ *
+ *  \param par pointer to the shard index
+ */
+static void *mergeShard(void *par){
+   unsigned int s = *((unsigned int *) par);
+   struct ShardTop *top = &shardTops[s];
+   struct WordTable merged, all;
+
+   top->status = -1;
+   if ((top->fileTop = malloc((size_t) nWordFiles * topK * sizeof(struct WordCount))) == NULL
+       || (top->fileTopSize = calloc(nWordFiles, sizeof(int))) == NULL
+       || (top->allTop = malloc(topK * sizeof(struct WordCount))) == NULL) return NULL;
+   if (tableInit(&merged, INITIAL_SLOTS) != 0) return NULL;
+   if (tableInit(&all, INITIAL_SLOTS) != 0) {
+      free(merged.slots);
+      return NULL;
+   }
+
+   /* counts of each word of each file; the keys stay in the arenas of the workers */
+   for (unsigned int w = 0; w < nWordWorkers; w++) {
+      struct WordTable *table = &workers[w].table;
+
+      for (unsigned long i = 0; i <= table->mask; i++) {
+         struct WordEntry *src = &table->slots[i];
+         if (src->key == NULL || shardOf(keyHash(src->key, src->head, src->length)) != s) continue;
+
+         struct WordEntry *e = tableSlot(&merged, src->head, src->key, src->length, src->fileId);
+         if (e->key != NULL) e->count += src->count;
+         else {
+            *e = *src;
+            if (tableUsed(&merged) != 0) goto fail;
+         }
+      }
+   }
+
+   /* most frequent words of each file, and counts of each word over all files */
+   for (unsigned long i = 0; i <= merged.mask; i++) {
+      struct WordEntry *src = &merged.slots[i];
+      if (src->key == NULL) continue;
+
+      struct WordCount item = {src->key, src->length, src->count};
+      heapPush(&top->fileTop[(size_t) src->fileId * topK], &top->fileTopSize[src->fileId], item);
+
+      struct WordEntry *e = tableSlot(&all, src->head, src->key, src->length, -1);
+      if (e->key != NULL) e->count += src->count;
+      else {
+         *e = *src;
+         e->fileId = -1;
+         if (tableUsed(&all) != 0) goto fail;
+      }
+   }
+
+   top->allTopSize = 0;
+   for (unsigned long i = 0; i <= all.mask; i++) {
+      struct WordEntry *src = &all.slots[i];
+
+      if (src->key != NULL) heapPush(top->allTop, &top->allTopSize, (struct WordCount) {src->key, src->length, src->count});
+   }
+   top->status = 0;
+
+fail:
+   free(merged.slots);
+   free(all.slots);
+   return NULL;
+}
+
+/**
+ *  \brief Merge the tables of all workers, one thread per shard.
+ *
+ *  Operation carried out by main, after the workers terminated.
+ *
+ *  \return 0 on success, -1 on error
+ */
+int wordsMerge(void){
+   pthread_t th[nShards];
+   unsigned int shard[nShards];
+   int status = 0;
+
+   if ((shardTops = calloc(nShards, sizeof(struct ShardTop))) == NULL) return -1;
+   for (unsigned int s = 0; s < nShards; s++) {
+      shard[s] = s;
+      if (pthread_create(&th[s], NULL, mergeShard, &shard[s]) != 0) {
+         perror("Failed to create thread");
+         exit(EXIT_FAILURE);
+      }
+   }
+   for (unsigned int s = 0; s < nShards; s++) {
+      if (pthread_join(th[s], NULL) != 0) {
+         perror("error on waiting for merge thread");
+         exit(EXIT_FAILURE);
+      }
+      if (shardTops[s].status != 0) status = -1;
+   }
+   return status;
+}
+
+/**
+ *  \brief Order of the ranking, for qsort.
+ */
+static int compareCounts(const void *a, const void *b){
+   if (better(a, b)) return -1;
+   return better(b, a) ? 1 : 0;
+}
+
+/**
+ *  \brief Print a ranking from the heaps of all shards.
+ *
+ *  \param name name of the file (NULL for all files)
+ *  \param heaps heap of each shard
+ *  \param sizes number of entries of the heap of each shard
+ */
+static void printRanking(const char *name, struct WordCount **heaps, const int *sizes){
+   struct WordCount *candidates = malloc((size_t) nShards * topK * sizeof(struct WordCount));
+   int n = 0;
+
+   if (candidates == NULL) {
+      perror("Failed to allocate memory");
+      exit(EXIT_FAILURE);
+   }
+   for (unsigned int s = 0; s < nShards; s++) {
+      memcpy(&candidates[n], heaps[s], sizes[s] * sizeof(struct WordCount));
+      n += sizes[s];
+   }
+   qsort(candidates, n, sizeof(struct WordCount), compareCounts);
+
+   if (name != NULL) printf("\nMost frequent words of file %s:\n", name);
+   else printf("\nMost frequent words of all files:\n");
+   for (int i = 0; i < n && i < topK; i++) {
+      printf("%.*s: %ld\n", (int) candidates[i].length, (const char *) candidates[i].key, candidates[i].count);
+   }
+   free(candidates);
+}
+
+/**
+ *  \brief Print the most frequent words of each file and of all files.
+ *
+ *  Operation carried out by main, after wordsMerge. The words of a shard are not in any other shard, so the most
+ *  frequent words are among those kept by the shards.
+ *
+ *  \param fileNames names of the files
+ */
+void wordsPrint(char **fileNames){
+   struct WordCount *heaps[nShards];
+   int sizes[nShards];
+
+   for (int f = 0; f < nWordFiles; f++) {
+      for (unsigned int s = 0; s < nShards; s++) {
+         heaps[s] = &shardTops[s].fileTop[(size_t) f * topK];
+         sizes[s] = shardTops[s].fileTopSize[f];
+      }
+      printRanking(fileNames[f], heaps, sizes);
+   }
+   for (unsigned int s = 0; s < nShards; s++) {
+      heaps[s] = shardTops[s].allTop;
+      sizes[s] = shardTops[s].allTopSize;
+   }
+   printRanking(NULL, heaps, sizes);
+}
+
+/**
+ *  \brief Release the tables.
+ */
+void wordsDestroy(void){
+   for (unsigned int w = 0; w < nWordWorkers && workers != NULL; w++) {
+      free(workers[w].table.slots);
+      free(workers[w].scratch);
+      while (workers[w].arena != NULL) {
+         struct ArenaBlock *block = workers[w].arena;
+
+         workers[w].arena = block->next;
+         free(block);
+      }
+   }
+   for (unsigned int s = 0; s < nShards && shardTops != NULL; s++) {
+      free(shardTops[s].fileTop);
+      free(shardTops[s].fileTopSize);
+      free(shardTops[s].allTop);
+   }
+   free(shardTops);
+   free(workers);
+}
@@ -0,0 +1,46 @@
+/**
+ *  \file wordFreq.h (interface file)
+ *
+ *  \brief Problem name: Count Words.
+ *
+ *  Frequency of each word, per file and over all files.
+ *
+ *  Each worker hashes the words of its chunks, case folded, into a table of its own, so no lock is taken while the
+ *  text is processed, and the keys are copied into an arena that belongs to the worker. The number of words and of
+ *  words containing each vowel are taken in the same pass, from the vowels kept with each word. Once the workers are
+ *  done, the words are divided in shards by their hash: one thread per shard merges the words of that shard from the
+ *  tables of all workers and keeps the most frequent ones with a heap, and the heaps of the shards are combined at
+ *  the end.
+ *
+ *  Definition of the operations:
+ *     \li wordsInit
+ *     \li wordsAddText
+ *     \li wordsMerge
+ *     \li wordsPrint
+ *     \li wordsDestroy
+ */
+
+#ifndef WORD_FREQ_H
+#define WORD_FREQ_H
+
+#include <stdbool.h>
+
+#include "cleText.h"
+
+/** \brief set up the tables of nWorkers workers for nFiles files, keeping the topK most frequent words, returns 0 on success */
+extern int wordsInit(unsigned int nWorkers, int nFiles, int topK);
+
+/** \brief count the words of a piece of text of a file, which starts and ends between words, and get its counters;
+           returns false if the counters are incomplete (a word was too long to be kept) */
+extern bool wordsAddText(unsigned int workerId, const unsigned char *text, long size, int fileId, struct cle_text_counts *counts);
+
+/** \brief merge the tables of all workers, one thread per shard, returns 0 on success */
+extern int wordsMerge(void);
+
+/** \brief print the most frequent words of each file and of all files */
+extern void wordsPrint(char **fileNames);
+
+/** \brief release the tables */
+extern void wordsDestroy(void);
+
+#endif /* WORD_FREQ_H */
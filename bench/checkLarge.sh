@@ -0,0 +1,75 @@
+#!/bin/bash
+#
+# Check of the word counters on a corpus larger than 4 GiB.
+#
+# Generates a corpus with a hole of zero bytes in the middle (a sparse file, it takes only the disk space of its text)
+# and the same corpus without the hole, runs the pthread counter (Assignment1/prog1) on the large corpus in every read
+# mode, and the MPI counter (Assignment 2/prog1), and compares their counters with those of the small one. The sizes
+# and offsets past 4 GiB go through every path that reads the files, and a mode that keeps them in an int, or
+# materializes the file, fails or runs out of memory.
+#
+# Environment:
+#    SIZE        bytes of text of the corpora, k/M/G suffixes allowed (default: 8M)
+#    HOLE        bytes of the hole, k/M/G suffixes allowed (default: 5G)
+#    SHAPE       corpus shape (default: ascii)
+#    THREADS     number of threads of the pthread counter (default: 4)
+#    RANKS       number of worker ranks of the MPI counter, "" to skip it (default: 2)
+#    SEED        seed of the corpora (default: 1)
+#    CORPUS_DIR  where the corpora are kept (default: ./corpus)
+#    MPIEXEC     mpi launcher (default: "mpiexec --oversubscribe")
+
+set -e
+
+here=$(cd "$(dirname "$0")" && pwd)
+root=$(dirname "$here")
+prog1="$root/Assignment1/prog1/prog1"
+mpiprog="$root/Assignment 2/prog1/textProcessing"
+
+SIZE=${SIZE-8M}
+HOLE=${HOLE-5G}
+SHAPE=${SHAPE-ascii}
+THREADS=${THREADS-4}
+RANKS=${RANKS-2}
+SEED=${SEED-1}
+CORPUS_DIR=${CORPUS_DIR-"$here/corpus"}
+MPIEXEC=${MPIEXEC-"mpiexec --oversubscribe"}
+
+mkdir -p "$CORPUS_DIR"
+
+# counters printed by a run, without the file names, the settings and the time
+counters() {
+   "$@" 2>/dev/null | sed -n '/^Total number of words/p; /^A:/p'
+}
+
+make -s -C "$here" genCorpus
+make -s -C "$root/Assignment1/prog1" prog1 >/dev/null
+if [ -n "$RANKS" ]; then make -s -C "$root/Assignment 2/prog1" >/dev/null; fi
+
+small="$CORPUS_DIR/$SHAPE-$SIZE-$SEED.txt"
+large="$CORPUS_DIR/$SHAPE-$SIZE-$SEED-hole$HOLE.txt"
+[ -f "$small" ] || "$here/genCorpus" -s "$SIZE" -k "$SHAPE" -S "$SEED" -o "$small"
+[ -f "$large" ] || "$here/genCorpus" -s "$SIZE" -k "$SHAPE" -S "$SEED" -H "$HOLE" -o "$large"
+
+expected=$(counters "$prog1" -t "$THREADS" -f "$small")
+if [ -z "$expected" ]; then echo "run failed: $prog1 -f $small" >&2; exit 1; fi
+
+failed=0
+modes=("" "-M" "-P" "-S" "-R uring:8" "-R pread:8" "-c 4k" "-m 1M" "-s steal" "stdin")
+if [ -n "$RANKS" ]; then modes+=("mpi"); fi
+for mode in "${modes[@]}"; do
+   if [ "$mode" == "stdin" ]; then
+      got=$(counters "$prog1" -t "$THREADS" -f - < "$large")
+   elif [ "$mode" == "mpi" ]; then
+      got=$(counters $MPIEXEC -n $((RANKS + 1)) "$mpiprog" -f "$large")
+   else
+      got=$(counters "$prog1" -t "$THREADS" $mode -f "$large")
+   fi
+   if [ "$got" == "$expected" ]; then
+      echo "ok   ${mode:-default}"
+   else
+      echo "FAIL ${mode:-default}"
+      diff <(echo "$expected") <(echo "$got") || true
+      failed=1
+   fi
+done
+exit $failed
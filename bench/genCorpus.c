@@ -0,0 +1,326 @@
+/**
+ *  \file genCorpus.c
+ *
+ *  \brief Problem name: Count Words.
+ *
+ *  Generator of reproducible synthetic text corpora for the throughput benchmarks.
+ *
+ *  The same shape, size and seed always produce the same bytes. The text is written as it is generated, so corpora
+ *  larger than the memory can be produced. Every corpus but noend ends with a newline.
+ *
+ *  With -H, a hole of zero bytes is left in the middle of the text, between two words: it is skipped with fseeko, so
+ *  the file is sparse and a corpus larger than 4 GiB takes only the disk space of its text. The zero bytes separate
+ *  words, so the counters are those of the same corpus without the hole.
+ *
+ *  Shapes:
+ *     \li ascii      --- english-like words of plain ascii letters, digits and punctuation
+ *     \li portuguese --- portuguese words, most of them with accented letters and cedillas encoded in utf-8
+ *     \li longwords  --- words of 100 to 1500 letters
+ *     \li sparse     --- words glued by punctuation, with a whitespace only every few hundred bytes
+ *     \li longtoken  --- english-like words, with a token of 64 KiB to 4 MiB letters every few MiB, longer than the
+ *                        buffers and chunks of the counters
+ *     \li noend      --- english-like words, ending in the middle of a word, without a trailing separator
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <ctype.h>
+#include <sys/types.h>
+
+/** \brief english-like words */
+static const char *asciiWords[] = {
+   "the", "of", "and", "to", "in", "is", "you", "that", "it", "he", "was", "for", "on", "are", "as", "with",
+   "his", "they", "I", "at", "be", "this", "have", "from", "or", "one", "had", "by", "word", "but", "not",
+   "what", "all", "were", "we", "when", "your", "can", "said", "there", "use", "an", "each", "which", "she",
+   "do", "how", "their", "if", "will", "up", "other", "about", "out", "many", "then", "them", "these", "so",
+   "some", "her", "would", "make", "like", "him", "into", "time", "has", "look", "two", "more", "write", "go",
+   "see", "number", "no", "way", "could", "people", "my", "than", "first", "water", "been", "call", "who",
+   "oil", "its", "now", "find", "long", "down", "day", "did", "get", "come", "made", "may", "part", "2024",
+   "don't", "it's", "x86_64", "rhythm", "syzygy", "queue"
+};
+
+/** \brief portuguese words, utf-8 encoded */
+static const char *portugueseWords[] = {
+   "não", "coração", "ação", "você", "é", "português", "informação", "também", "já", "até", "está", "então",
+   "água", "mãe", "pão", "irmã", "órgão", "ônibus", "três", "país", "saúde", "conclusão", "função", "razão",
+   "lição", "canção", "além", "através", "próximo", "último", "música", "prática", "público", "técnico",
+   "câmara", "você's", "d’água", "caça", "açúcar", "criança", "esperança", "força", "cabeça", "começo",
+   "à", "às", "ó", "há", "só", "após", "porém", "ninguém", "alguém", "parabéns", "difícil", "fácil",
+   "de", "que", "o", "a", "do", "da", "em", "um", "para", "com", "uma", "os", "no", "se", "na", "por",
+   "mais", "as", "dos", "como", "mas", "foi", "ao", "ele", "das", "tem", "seu", "sua", "ou", "ser",
+   "quando", "muito", "nos", "eu", "isso", "ela", "entre", "depois", "sem", "mesmo", "aos", "ter", "seus"
+};
+
+/** \brief punctuation that is neither a word character nor a separator */
+static const char punctuation[] = ".,;:!?-()\"";
+
+/** \brief state of the pseudo random generator */
+static uint64_t rngState;
+
+/**
+ *  \brief Get the next pseudo random number (xorshift64*).
+ */
+static uint64_t nextRandom(void) {
+   rngState ^= rngState >> 12;
+   rngState ^= rngState << 25;
+   rngState ^= rngState >> 27;
+   return rngState * 2685821657736338717ULL;
+}
+
+/**
+ *  \brief Get a pseudo random number in [0, n).
+ */
+static unsigned int randomBelow(unsigned int n) {
+   return (unsigned int) ((nextRandom() >> 32) % n);
+}
+
+/**
+ *  \brief Append a word list entry followed by whitespace or punctuation.
+ */
+static size_t wordFromList(char *out, const char **words, unsigned int nWords) {
+   size_t n = strlen(strcpy(out, words[randomBelow(nWords)]));
+   unsigned int r = randomBelow(100);
+
+   if (r < 6) out[n++] = punctuation[randomBelow(sizeof(punctuation) - 1)];
+   out[n++] = (r < 3) ? '\n' : (r < 4) ? '\t' : ' ';
+   return n;
+}
+
+/**
+ *  \brief Append a long word followed by a space.
+ */
+static size_t longWord(char *out) {
+   static const char letters[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_";
+   unsigned int length = 100 + randomBelow(1401);
+   size_t n = 0;
+
+   for (unsigned int i = 0; i < length; i++) {
+      out[n++] = letters[randomBelow(sizeof(letters) - 1)];
+   }
+   out[n++] = (randomBelow(10) == 0) ? '\n' : ' ';
+   return n;
+}
+
+/**
+ *  \brief Append english-like words, or the next piece of a token longer than a piece.
+ *
+ *  A long token is written in pieces of up to 4000 letters, the one that ends it is followed by a newline.
+ */
+static size_t longTokenPiece(char *out) {
+   static unsigned long tokenLeft = 0;
+   size_t n = 0;
+
+   if (tokenLeft == 0) {
+      if (randomBelow(800000) != 0) {
+         return wordFromList(out, asciiWords, sizeof(asciiWords) / sizeof(asciiWords[0]));
+      }
+      tokenLeft = (64UL << 10) + randomBelow((4U << 20) - (64U << 10) + 1);
+   }
+   while (n < 4000 && tokenLeft > 0) {
+      out[n++] = 'a' + randomBelow(26);
+      tokenLeft--;
+   }
+   if (tokenLeft == 0) out[n++] = '\n';
+   return n;
+}
+
+/**
+ *  \brief Append a run of short words glued by punctuation, followed by one whitespace.
+ */
+static size_t sparseRun(char *out) {
+   unsigned int length = 200 + randomBelow(1801);
+   size_t n = 0;
+
+   while (n < length) {
+      const char *word = asciiWords[randomBelow(sizeof(asciiWords) / sizeof(asciiWords[0]))];
+      size_t wordLength = strlen(word);
+
+      memcpy(out + n, word, wordLength);
+      n += wordLength;
+      out[n++] = punctuation[randomBelow(sizeof(punctuation) - 1)];
+   }
+   out[n++] = '\n';
+   return n;
+}
+
+/**
+ *  \brief Parse a number of bytes, optionally followed by a k, M or G suffix.
+ */
+static long long parseSize(const char *text) {
+   char *suffix;
+   long long size = strtoll(text, &suffix, 10);
+
+   if (suffix == text) return -1;
+   if (*suffix == 'k' || *suffix == 'K') size <<= 10;
+   else if (*suffix == 'm' || *suffix == 'M') size <<= 20;
+   else if (*suffix == 'g' || *suffix == 'G') size <<= 30;
+   else if (*suffix != '\0') return -1;
+   return size;
+}
+
+/**
+ *  \brief Print command usage.
+ */
+static void printUsage(char *cmdName) {
+   fprintf(stderr, "\nSynopsis: %s [OPTIONS]\n"
+           "  OPTIONS:\n"
+           "  -s bytes  --- size of the corpus, k/M/G suffixes allowed (default: 1M)\n"
+           "  -k shape  --- ascii, portuguese, longwords, sparse, longtoken or noend (default: ascii)\n"
+           "  -S seed   --- seed of the pseudo random generator (default: 1)\n"
+           "  -o file   --- output file (default: stdout)\n"
+           "  -H bytes  --- leave a hole of zero bytes in the middle of the text, k/M/G suffixes allowed, needs -o (default: 0)\n"
+           "  -h        --- print this help\n", cmdName);
+}
+
+int main(int argc, char *argv[]) {
+   long long size = 1 << 20;
+   const char *shape = "ascii";
+   unsigned long long seed = 1;
+   FILE *out = stdout;
+   long long hole = 0;
+   int c;
+
+   while ((c = getopt(argc, argv, "s:k:S:o:H:h")) != -1) {
+      switch (c) {
+         case 's':
+            if ((size = parseSize(optarg)) <= 0) {
+               fprintf(stderr, "%s: invalid size\n", argv[0]);
+               printUsage(argv[0]);
+               return EXIT_FAILURE;
+            }
+            break;
+         case 'k':
+            shape = optarg;
+            break;
+         case 'S':
+            seed = strtoull(optarg, NULL, 10);
+            break;
+         case 'o':
+            if ((out = fopen(optarg, "wb")) == NULL) {
+               perror(optarg);
+               return EXIT_FAILURE;
+            }
+            break;
+         case 'H':
+            if ((hole = parseSize(optarg)) < 0) {
+               fprintf(stderr, "%s: invalid hole size\n", argv[0]);
+               printUsage(argv[0]);
+               return EXIT_FAILURE;
+            }
+            break;
+         case 'h':
+            printUsage(argv[0]);
+            return EXIT_SUCCESS;
+         case '?':
+            if (optopt == 's' || optopt == 'k' || optopt == 'S' || optopt == 'o' || optopt == 'H') {
+               fprintf(stderr, "%s: option -%c requires an argument\n", argv[0], optopt);
+            } else if (isprint(optopt)) {
+               fprintf(stderr, "%s: unknown option `-%c'\n", argv[0], optopt);
+            } else {
+               fprintf(stderr, "%s: unknown option character `\\x%x'\n", argv[0], optopt);
+            }
+            printUsage(argv[0]);
+            return EXIT_FAILURE;
+         default:
+            printUsage(argv[0]);
+            return EXIT_FAILURE;
+      }
+   }
+
+   enum { ASCII, PORTUGUESE, LONGWORDS, SPARSE, LONGTOKEN, NOEND } kind;
+   if (strcmp(shape, "ascii") == 0) kind = ASCII;
+   else if (strcmp(shape, "portuguese") == 0) kind = PORTUGUESE;
+   else if (strcmp(shape, "longwords") == 0) kind = LONGWORDS;
+   else if (strcmp(shape, "sparse") == 0) kind = SPARSE;
+   else if (strcmp(shape, "longtoken") == 0) kind = LONGTOKEN;
+   else if (strcmp(shape, "noend") == 0) kind = NOEND;
+   else {
+      fprintf(stderr, "%s: unknown shape `%s'\n", argv[0], shape);
+      printUsage(argv[0]);
+      return EXIT_FAILURE;
+   }
+   if (hole > 0 && out == stdout) {
+      fprintf(stderr, "%s: -H needs an output file\n", argv[0]);
+      printUsage(argv[0]);
+      return EXIT_FAILURE;
+   }
+
+   rngState = seed * 0x9E3779B97F4A7C15ULL + 1;         /* never 0 */
+
+   /* fill a buffer with whole pieces and flush it, a piece never exceeds 4 KiB */
+   static char buffer[1 << 20];
+   size_t used = 0;
+   long long written = 0;
+
+   while (written < size) {
+      if (used > sizeof(buffer) - 4096) {
+         fwrite(buffer, 1, used, out);
+         written += used;
+         used = 0;
+         continue;
+      }
+      switch (kind) {
+         case ASCII:
+         case NOEND:
+            used += wordFromList(buffer + used, asciiWords, sizeof(asciiWords) / sizeof(asciiWords[0]));
+            break;
+         case PORTUGUESE:
+            used += wordFromList(buffer + used, portugueseWords, sizeof(portugueseWords) / sizeof(portugueseWords[0]));
+            break;
+         case LONGWORDS:
+            used += longWord(buffer + used);
+            break;
+         case SPARSE:
+            used += sparseRun(buffer + used);
+            break;
+         case LONGTOKEN:
+            used += longTokenPiece(buffer + used);
+            break;
+      }
+      if (hole > 0 && written + (long long) used >= size / 2 && written + (long long) used < size) {
+         /* the pieces end with a whitespace, so the hole starts between two words */
+         fwrite(buffer, 1, used, out);
+         written += used;
+         used = 0;
+         if (fseeko(out, (off_t) hole, SEEK_CUR) != 0) {
+            perror("fseeko");
+            return EXIT_FAILURE;
+         }
+         hole = 0;
+         continue;
+      }
+      if (written + (long long) used >= size) {
+         used = size - written;
+         if (kind == NOEND) {
+            /* cut at the requested size, in the middle of a word */
+            if (!isalpha((unsigned char) buffer[used - 1])) buffer[used - 1] = 'z';
+         } else {
+            /* cut at the requested size, but finish the last piece so that the corpus ends with a newline */
+            while (used > 0 && buffer[used - 1] != ' ' && buffer[used - 1] != '\n' && buffer[used - 1] != '\t') used--;
+            if (used == 0) used = 1;
+            buffer[used - 1] = '\n';
+         }
+         fwrite(buffer, 1, used, out);
+         written += used;
+         used = 0;
+         break;
+      }
+   }
+   if (used > 0) fwrite(buffer, 1, used, out);
+   if (hole > 0) {
+      /* a corpus of a single piece: the hole is left at its end, followed by the newline that ends every corpus */
+      if (fseeko(out, (off_t) hole - 1, SEEK_CUR) != 0 || fputc('\n', out) == EOF) {
+         perror("fseeko");
+         return EXIT_FAILURE;
+      }
+   }
+
+   if (fclose(out) != 0) {
+      perror("fclose");
+      return EXIT_FAILURE;
+   }
+   return EXIT_SUCCESS;
+}
@@ -0,0 +1,128 @@
+#!/bin/bash
+#
+# Throughput benchmark of the word counters.
+#
+# Generates the corpora (once, they are kept in CORPUS_DIR), runs the pthread counter (Assignment1/prog1) for every
+# number of threads and the MPI counter (Assignment 2/prog1) for every number of worker ranks, and prints one csv
+# line per run with the throughput and the speedup over the smallest number of workers of the same program.
+#
+# The counters of every run, and of one run of the pthread counter in each of CHECK_MODES, are compared with those of
+# the first run on the same corpus. A difference is reported on stderr, and the script fails once the sweep is done.
+#
+# Environment:
+#    SIZES       corpus sizes, k/M/G suffixes allowed (default: "1M 16M 256M", add 10G for the large runs)
+#    SHAPES      corpus shapes (default: "ascii portuguese longwords sparse longtoken noend")
+#    THREADS     numbers of threads of the pthread counter (default: "1 2 4 8")
+#    RANKS       numbers of worker ranks of the MPI counter, "" to skip it (default: "1 2 4")
+#    REPEAT      runs of each configuration, the fastest is kept (default: 3)
+#    SEED        seed of the corpora (default: 1)
+#    CORPUS_DIR  where the corpora are kept (default: ./corpus)
+#    PROG1_ARGS  extra options of the pthread counter (e.g. "-M" or "-s ring")
+#    CHECK_MODES options of the pthread counter checked on each corpus, separated by commas, stdin to read the corpus
+#                from the standard input, "" to skip them (default: "-M,-P,-S,-R 8,-c 4k,stdin")
+#    MPIEXEC     mpi launcher (default: "mpiexec --oversubscribe")
+
+set -e
+
+here=$(cd "$(dirname "$0")" && pwd)
+root=$(dirname "$here")
+prog1="$root/Assignment1/prog1/prog1"
+mpiprog="$root/Assignment 2/prog1/textProcessing"
+
+SIZES=${SIZES-"1M 16M 256M"}
+SHAPES=${SHAPES-"ascii portuguese longwords sparse longtoken noend"}
+THREADS=${THREADS-"1 2 4 8"}
+RANKS=${RANKS-"1 2 4"}
+REPEAT=${REPEAT-3}
+SEED=${SEED-1}
+CORPUS_DIR=${CORPUS_DIR-"$here/corpus"}
+CHECK_MODES=${CHECK_MODES-"-M,-P,-S,-R 8,-c 4k,stdin"}
+MPIEXEC=${MPIEXEC-"mpiexec --oversubscribe"}
+
+mkdir -p "$CORPUS_DIR"
+
+# counters printed by a run, without the file names, the settings and the time
+counters() {
+   sed -n '/^Total number of words/p; /^A:/p'
+}
+
+# compare the counters of a run with those of the first run on the same corpus (kept in expected)
+check_counters() {
+   local got=$1; shift
+   if [ -z "$got" ]; then
+      echo "run failed: $*" >&2
+      mismatches=$((mismatches + 1))
+   elif [ -z "$expected" ]; then
+      expected=$got
+   elif [ "$got" != "$expected" ]; then
+      echo "counters differ: $*" >&2
+      diff <(echo "$expected") <(echo "$got") >&2 || true
+      mismatches=$((mismatches + 1))
+   fi
+}
+
+# best elapsed time of REPEAT runs of a command (in best), checking the counters of each run
+best_time() {
+   best=""
+   for ((r = 0; r < REPEAT; r++)); do
+      local out t
+      out=$("$@" 2>/dev/null) || true
+      t=$(echo "$out" | sed -n 's/^Elapsed time = \([0-9.]*\) s$/\1/p')
+      if [ -z "$t" ]; then echo "run failed: $*" >&2; exit 1; fi
+      check_counters "$(echo "$out" | counters)" "$@"
+      if [ -z "$best" ] || awk "BEGIN { exit !($t < $best) }"; then best=$t; fi
+   done
+}
+
+# check the counters of the pthread counter in each of CHECK_MODES on a file, with the largest number of threads
+check_modes() {
+   local file=$1 n=${THREADS##* } mode modes
+   IFS=',' read -ra modes <<< "$CHECK_MODES"
+   for mode in "${modes[@]}"; do
+      if [ "$mode" == "stdin" ]; then
+         check_counters "$("$prog1" -t "$n" -f - < "$file" 2>/dev/null | counters)" "$prog1" -t "$n" -f - "< $file"
+      else
+         check_counters "$("$prog1" -t "$n" $mode -f "$file" 2>/dev/null | counters)" "$prog1" -t "$n" $mode -f "$file"
+      fi
+   done
+}
+
+# csv lines of a sweep: program shape bytes file workers...
+sweep() {
+   local program=$1 shape=$2 bytes=$3 file=$4; shift 4
+   local base=""
+   for n in "$@"; do
+      local t
+      if [ "$program" == "pthread" ]; then
+         best_time "$prog1" -t "$n" $PROG1_ARGS -f "$file"
+      else
+         best_time $MPIEXEC -n $((n + 1)) "$mpiprog" -f "$file"
+      fi
+      t=$best
+      if [ -z "$base" ]; then base=$t; fi
+      awk -v p="$program" -v k="$shape" -v b="$bytes" -v n="$n" -v t="$t" -v t0="$base" \
+          'BEGIN { printf "%s,%s,%d,%d,%.6f,%.1f,%.2f\n", p, k, b, n, t, b / t / 1e6, t0 / t }'
+   done
+}
+
+make -s -C "$here" genCorpus
+make -s -C "$root/Assignment1/prog1" prog1 >/dev/null
+if [ -n "$RANKS" ]; then make -s -C "$root/Assignment 2/prog1" >/dev/null; fi
+
+mismatches=0
+echo "program,shape,bytes,workers,seconds,mb_per_s,speedup"
+for size in $SIZES; do
+   for shape in $SHAPES; do
+      file="$CORPUS_DIR/$shape-$size-$SEED.txt"
+      [ -f "$file" ] || "$here/genCorpus" -s "$size" -k "$shape" -S "$SEED" -o "$file"
+      bytes=$(stat -c %s "$file")
+      expected=""
+      sweep pthread "$shape" "$bytes" "$file" $THREADS
+      if [ -n "$RANKS" ]; then sweep mpi "$shape" "$bytes" "$file" $RANKS; fi
+      check_modes "$file"
+   done
+done
+if [ "$mismatches" -gt 0 ]; then
+   echo "$mismatches runs gave different counters" >&2
+   exit 1
+fi
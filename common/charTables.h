@@ -0,0 +1,70 @@
+/**
+ *  \file charTables.h (interface file)
+ *
+ *  \brief Problem name: Count Words.
+ *
+ *  Lookup tables shared by the text processing programs.
+ *
+ *  The tables are generated at build time by genCharTables (see makefile) into charTables.c:
+ *     \li utf8ByteClass and utf8Transition drive a DFA that decodes utf-8 one byte at a time
+ *     \li charClassTable tells, with a single load, if a code point is a word character, an apostrophe and which
+ *         vowel it is
+ */
+
+#ifndef CHAR_TABLES_H
+#define CHAR_TABLES_H
+
+/** \brief decoder state when a complete code point was decoded (or none was started) */
+#define UTF8_ACCEPT 0
+
+/** \brief decoder state after an invalid byte sequence */
+#define UTF8_REJECT 12
+
+/** \brief bits of a character class holding the vowel id (1..6 for a,e,i,o,u,y, 0 if it is not a vowel) */
+#define CHAR_VOWEL 0x07
+
+/** \brief character class bit of the letters, digits and underscore */
+#define CHAR_WORD 0x08
+
+/** \brief character class bit of the apostrophes (they only belong to a word that is already open) */
+#define CHAR_APOSTROPHE 0x10
+
+/** \brief class of each byte, used to index the transition table */
+extern const unsigned char utf8ByteClass[256];
+
+/** \brief next decoder state, indexed by the current state plus the class of the byte */
+extern const unsigned char utf8Transition[108];
+
+/** \brief class of each code point below 256 */
+extern const unsigned char charClassTable[256];
+
+/**
+ *  \brief Feed one byte to the utf-8 decoder.
+ *
+ *  \param state decoder state, UTF8_ACCEPT at the start of the text
+ *  \param codepoint code point being decoded
+ *  \param byte next byte of the text
+ *
+ *  \return the new decoder state
+ */
+static inline unsigned int utf8_decode(unsigned int *state, unsigned int *codepoint, unsigned char byte){
+    unsigned int type = utf8ByteClass[byte];
+
+    *codepoint = (*state != UTF8_ACCEPT) ? (byte & 0x3Fu) | (*codepoint << 6) : (0xFFu >> type) & byte;
+    *state = utf8Transition[*state + type];
+    return *state;
+}
+
+/**
+ *  \brief Get the class of a code point.
+ *
+ *  Left and right single quotation marks are the only characters above 255 that are not separators.
+ *
+ *  \param c code point
+ */
+static inline unsigned char char_class(unsigned int c){
+    if (c < 256) return charClassTable[c];
+    return (c == 0x2018 || c == 0x2019) ? CHAR_APOSTROPHE : 0;
+}
+
+#endif /* CHAR_TABLES_H */
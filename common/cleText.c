@@ -0,0 +1,240 @@
+/**
+ *  \file cleText.c (implementation file)
+ *
+ *  \brief Problem name: Count Words.
+ *
+ *  Streaming text statistics shared by the text processing programs.
+ *
+ *  Pure ascii blocks are counted by a vectorized kernel (AVX2 when the processor supports it, SSE2 otherwise), the
+ *  other bytes go through the table driven utf-8 decoder one at a time.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "charTables.h"
+#include "cleText.h"
+
+/**
+ *  \brief Count one decoded character.
+ *
+ *  Until the first character that ends words, the word characters and vowels met are also recorded as the lead of
+ *  the text, which cle_text_merge needs to join it to the word the text on its left ends with.
+ */
+static inline void countCharacter(struct cle_text *text, unsigned int c) {
+    unsigned char cls = char_class(c);
+
+    if ((cls & CHAR_WORD) || ((cls & CHAR_APOSTROPHE) && text->inWord)) {
+        if (!text->inWord) {
+            text->inWord = true;
+            text->counts.words++;
+        }
+        int v = cls & CHAR_VOWEL;
+        if (v != 0 && !(text->seen & (1u << (v - 1)))) {
+            text->counts.vowels[v - 1]++;
+            text->seen |= 1u << (v - 1);
+        }
+        if (!text->leadDone && (cls & CHAR_WORD)) {
+            text->leadWord = true;
+            if (v != 0) text->leadSeen |= 1u << (v - 1);
+        }
+    }
+    else {
+        text->seen = 0;
+        text->inWord = false;
+        if (!(cls & CHAR_APOSTROPHE)) text->leadDone = true;
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+
+/** \brief vowels looked for by the ascii kernel, in the order of the counters */
+static const char asciiVowels[6] = {'a', 'e', 'i', 'o', 'u', 'y'};
+
+/**
+ *  \brief Count the words and vowel words of one pure ascii block from its classification masks.
+ *
+ *  Bit i of each mask refers to byte i of the block. An apostrophe only belongs to a word when it follows a word
+ *  character, which is resolved with a carry propagation over the runs of apostrophes. The first occurrence of each
+ *  vowel inside a word is found in the same way, so no branch depends on the text.
+ *
+ *  \param word mask of the letters, digits and underscores
+ *  \param apos mask of the apostrophes
+ *  \param vowel masks of each vowel (a,e,i,o,u,y)
+ *  \param width number of bytes of the block (16 or 32)
+ *  \param text state of the text (updated for the end of the block)
+ */
+static inline void countAsciiBlock(uint32_t word, uint32_t apos, const uint32_t vowel[6], int width, struct cle_text *text){
+    uint32_t in = text->inWord ? 1 : 0;
+    uint32_t top = width - 1;
+
+    /* apostrophes reached by a carry started right after a word character stay inside the word */
+    uint32_t seeds = ((word << 1) | in) & apos;
+    uint32_t inside = word | (((seeds + apos) ^ apos) & apos);
+
+    /* a word starts where a character inside a word is not preceded by another one */
+    text->counts.words += __builtin_popcount(inside & ~((inside << 1) | in));
+
+    uint32_t runStarts = inside & ~(inside << 1);
+    uint32_t seenOut = 0;
+    for (int v = 0; v < 6; v++) {
+        /* positions of each word that come after an occurrence of the vowel */
+        uint32_t after = ((vowel[v] << 1) | (in & (text->seen >> v))) & inside;
+        uint32_t before = inside & ~after;
+        before &= ((runStarts & before) + before) ^ before;
+        text->counts.vowels[v] += __builtin_popcount(vowel[v] & before);
+        seenOut |= ((((inside & ~before) | vowel[v]) >> top) & 1) << v;
+    }
+
+    text->inWord = (inside >> top) & 1;
+    text->seen = text->inWord ? seenOut : 0;
+}
+
+/**
+ *  \brief SSE2 version of the ascii kernel, 16 bytes per block.
+ */
+static size_t countAsciiSSE2(const unsigned char *p, size_t n, struct cle_text *text){
+    size_t i = 0;
+    const __m128i caseBit = _mm_set1_epi8(0x20);
+
+    for (; i + 16 <= n; i += 16) {
+        __m128i b = _mm_loadu_si128((const __m128i *) (p + i));
+        if (_mm_movemask_epi8(b) != 0) break;                   /* bytes >= 0x80, leave the block to the utf-8 path */
+
+        __m128i lower = _mm_or_si128(b, caseBit);
+        __m128i letter = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)), _mm_cmplt_epi8(lower, _mm_set1_epi8('z' + 1)));
+        __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(b, _mm_set1_epi8('0' - 1)), _mm_cmplt_epi8(b, _mm_set1_epi8('9' + 1)));
+        __m128i under = _mm_cmpeq_epi8(b, _mm_set1_epi8('_'));
+        uint32_t word = (uint32_t) _mm_movemask_epi8(_mm_or_si128(_mm_or_si128(letter, digit), under));
+        uint32_t apos = (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(b, _mm_set1_epi8('\'')));
+        uint32_t vowel[6];
+        for (int v = 0; v < 6; v++) {
+            vowel[v] = (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(lower, _mm_set1_epi8(asciiVowels[v])));
+        }
+
+        countAsciiBlock(word, apos, vowel, 16, text);
+    }
+    return i;
+}
+
+/**
+ *  \brief AVX2 version of the ascii kernel, 32 bytes per block.
+ */
+__attribute__((target("avx2")))
+static size_t countAsciiAVX2(const unsigned char *p, size_t n, struct cle_text *text){
+    size_t i = 0;
+    const __m256i caseBit = _mm256_set1_epi8(0x20);
+
+    for (; i + 32 <= n; i += 32) {
+        __m256i b = _mm256_loadu_si256((const __m256i *) (p + i));
+        if (_mm256_movemask_epi8(b) != 0) break;                /* bytes >= 0x80, leave the block to the utf-8 path */
+
+        __m256i lower = _mm256_or_si256(b, caseBit);
+        __m256i letter = _mm256_and_si256(_mm256_cmpgt_epi8(lower, _mm256_set1_epi8('a' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), lower));
+        __m256i digit = _mm256_and_si256(_mm256_cmpgt_epi8(b, _mm256_set1_epi8('0' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), b));
+        __m256i under = _mm256_cmpeq_epi8(b, _mm256_set1_epi8('_'));
+        uint32_t word = (uint32_t) _mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(letter, digit), under));
+        uint32_t apos = (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(b, _mm256_set1_epi8('\'')));
+        uint32_t vowel[6];
+        for (int v = 0; v < 6; v++) {
+            vowel[v] = (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(lower, _mm256_set1_epi8(asciiVowels[v])));
+        }
+
+        countAsciiBlock(word, apos, vowel, 32, text);
+    }
+    return i;
+}
+#endif
+
+/**
+ *  \brief Count the words of a pure ascii span with the vectorized kernel.
+ *
+ *  It stops at the first block containing a byte >= 0x80 (or at the last incomplete block), which must then be
+ *  processed by the scalar utf-8 path.
+ *
+ *  \return number of bytes processed
+ */
+static size_t countAscii(const unsigned char *p, size_t n, struct cle_text *text){
+#if defined(__x86_64__) || defined(__i386__)
+    if (__builtin_cpu_supports("avx2")) return countAsciiAVX2(p, n, text);
+    return countAsciiSSE2(p, n, text);
+#else
+    return 0;
+#endif
+}
+
+void cle_text_init(struct cle_text *text){
+    memset(text, 0, sizeof(struct cle_text));
+    text->decoder.state = UTF8_ACCEPT;
+}
+
+void cle_text_feed(struct cle_text *text, const unsigned char *buffer, size_t length){
+    size_t i = 0;
+
+    text->bytes += length;
+
+    /* continuation bytes at the start of the text are ignored by the decoder, but they are kept because they may
+       complete a character that started in the text on the left */
+    while (i < length && !text->headDone) {
+        if ((buffer[i] & 0xC0) != 0x80) {
+            text->headDone = true;
+            break;
+        }
+        text->head[text->headSize++] = buffer[i++];
+        if (text->headSize == sizeof(text->head)) text->headDone = true;
+    }
+
+    while (i < length) {
+        /* pure ascii blocks go through the vectorized kernel, as long as no utf-8 sequence is pending and the lead
+           of the text is known */
+        if (text->decoder.state == UTF8_ACCEPT && text->leadDone) {
+            i += countAscii(buffer + i, length - i, text);
+        }
+
+        /* the block that stopped the kernel goes through the scalar utf-8 path */
+        size_t blockEnd = (i + 16 < length) ? i + 16 : length;
+        for (; i < blockEnd; i++) {
+            int c = cle_text_decode(buffer[i], &text->decoder);
+            if (c != -1) countCharacter(text, c);
+        }
+    }
+}
+
+void cle_text_merge(struct cle_text *left, const struct cle_text *right){
+    /* the head of the right text completes the character the left text ends with, if any */
+    cle_text_feed(left, right->head, right->headSize);
+    if (right->bytes == right->headSize) return;
+    if (right->headDone) left->headDone = true;
+
+    /* the first word of the right text continues the word the left text ends with */
+    bool joined = left->inWord && right->leadWord;
+    left->counts.words += right->counts.words - (joined ? 1 : 0);
+    for (int v = 0; v < 6; v++) {
+        left->counts.vowels[v] += right->counts.vowels[v] - ((joined && (left->seen & right->leadSeen & (1u << v))) ? 1 : 0);
+    }
+
+    /* a right text made only of word characters and apostrophes leaves the word of the left text open */
+    if (!right->leadDone && left->inWord) {
+        left->seen |= right->leadSeen;
+    }
+    else {
+        left->inWord = right->inWord;
+        left->seen = right->seen;
+    }
+    left->decoder = right->decoder;
+
+    /* a left text without a character that ends words leads into the right one */
+    if (!left->leadDone) {
+        left->leadDone = right->leadDone;
+        left->leadWord = left->leadWord || right->leadWord;
+        left->leadSeen |= right->leadSeen;
+    }
+    left->bytes += right->bytes - right->headSize;
+}
+
+void cle_text_finish(const struct cle_text *text, struct cle_text_counts *counts){
+    *counts = text->counts;
+}
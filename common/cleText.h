@@ -0,0 +1,119 @@
+/**
+ *  \file cleText.h (interface file)
+ *
+ *  \brief Problem name: Count Words.
+ *
+ *  Streaming text statistics shared by the text processing programs.
+ *
+ *  The text is fed in any number of byte ranges of any size: the utf-8 decoder state, the open word and the vowels
+ *  already counted in it are carried from one call to the next, so no range has to start or end at a separator.
+ *  Adjacent ranges may also be processed by different threads (or processes) into states of their own, which are
+ *  then combined in order with cle_text_merge:
+ *
+ *     struct cle_text text;
+ *     struct cle_text_counts counts;
+ *
+ *     cle_text_init(&text);
+ *     cle_text_feed(&text, buffer, size);      (any number of times)
+ *     cle_text_finish(&text, &counts);
+ */
+
+#ifndef CLE_TEXT_H
+#define CLE_TEXT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "charTables.h"
+
+/** \brief state of the utf-8 decoder */
+struct State {
+    unsigned int state;        /* utf-8 decoder state, UTF8_ACCEPT when no multi-byte sequence is pending */
+    unsigned int codepoint;    /* code point being decoded */
+};
+
+/** \brief word statistics of a text */
+struct cle_text_counts {
+    long words;                /* number of words */
+    long vowels[6];            /* number of words containing each vowel (a,e,i,o,u,y) */
+};
+
+/** \brief statistics of the text fed so far, with the state needed to go on */
+struct cle_text {
+    struct State decoder;              /* utf-8 decoder, a character may be divided between two ranges */
+    bool inWord;                       /* flag telling if a word is open (it is already counted) */
+    unsigned int seen;                 /* bit v is set if vowel v was already counted in the open word */
+    struct cle_text_counts counts;     /* statistics of the text fed so far */
+    long bytes;                        /* number of bytes fed */
+
+    /* start of the text, so that the text on its left can be merged with it */
+    unsigned char head[3];             /* leading continuation bytes, they may complete a character on the left */
+    int headSize;                      /* number of bytes of head */
+    bool headDone;                     /* flag telling if the head is complete */
+    bool leadDone;                     /* flag telling if a character that ends words was decoded */
+    bool leadWord;                     /* flag telling if a word character was decoded before it */
+    unsigned int leadSeen;             /* bit v is set if vowel v was decoded before it */
+};
+
+/**
+ *  \brief Feed a byte of data to the table driven utf-8 decoder.
+ *
+ *  A byte that interrupts an unfinished multi-byte sequence is decoded again as the start of a new character,
+ *  invalid bytes are ignored.
+ *
+ *  \param byte next byte of the text
+ *  \param state decoder state
+ *
+ *  \return the Unicode code point when the byte completes a character, -1 otherwise
+ */
+static inline int cle_text_decode(unsigned char byte, struct State *state) {
+    unsigned int previous = state->state;
+
+    if (utf8_decode(&state->state, &state->codepoint, byte) == UTF8_ACCEPT) return state->codepoint;
+
+    if (state->state == UTF8_REJECT) {
+        state->state = UTF8_ACCEPT;
+        if (previous != UTF8_ACCEPT) return cle_text_decode(byte, state);
+    }
+
+    return -1;
+}
+
+/**
+ *  \brief Start the statistics of a new text.
+ *
+ *  \param text state to be initialized
+ */
+extern void cle_text_init(struct cle_text *text);
+
+/**
+ *  \brief Feed the next bytes of the text.
+ *
+ *  \param text state of the text
+ *  \param buffer next bytes of the text
+ *  \param length number of bytes
+ */
+extern void cle_text_feed(struct cle_text *text, const unsigned char *buffer, size_t length);
+
+/**
+ *  \brief Append the text of another state.
+ *
+ *  The right text must follow the left one in the original text and both must have been started with cle_text_init
+ *  at their first byte. A word divided between both is counted once.
+ *
+ *  \param left state of the text on the left (updated to the state of both texts)
+ *  \param right state of the text on the right
+ */
+extern void cle_text_merge(struct cle_text *left, const struct cle_text *right);
+
+/**
+ *  \brief Get the statistics of the text, once all of it was fed.
+ *
+ *  An unfinished utf-8 sequence at the end of the text is ignored.
+ *
+ *  \param text state of the text
+ *  \param counts statistics of the text
+ */
+extern void cle_text_finish(const struct cle_text *text, struct cle_text_counts *counts);
+
+#endif /* CLE_TEXT_H */
@@ -0,0 +1,151 @@
+/**
+ *  \file genCharTables.c
+ *
+ *  \brief Problem name: Count Words.
+ *
+ *  Generator of the lookup tables declared in charTables.h, the C source is written to the standard output.
+ *
+ *  The character classes are computed from the original is_alpha_numeric / is_vowel rules, so the table driven
+ *  programs count exactly the same words as before.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include "charTables.h"
+
+/** \brief number of byte classes of the utf-8 decoder */
+#define N_BYTE_CLASSES 12
+
+/** \brief number of states of the utf-8 decoder */
+#define N_STATES 9
+
+/** \brief decoder states, the value stored in the tables is the state times N_BYTE_CLASSES */
+enum { ACCEPT, REJECT, NEED1, NEED2, NEED3, NEED2_E0, NEED2_ED, NEED3_F0, NEED3_F4 };
+
+/**
+ *  \brief Class of a byte.
+ *
+ *  The class of a leading byte is chosen so that (0xFF >> class) masks its payload bits.
+ */
+static int byteClass(int b){
+    if (b < 0x80) return 0;
+    if (b < 0x90) return 1;                     /* continuation 80..8F */
+    if (b < 0xA0) return 9;                     /* continuation 90..9F */
+    if (b < 0xC0) return 7;                     /* continuation A0..BF */
+    if (b < 0xC2) return 8;                     /* overlong two byte sequence */
+    if (b < 0xE0) return 2;
+    if (b == 0xE0) return 10;
+    if (b == 0xED) return 4;                    /* would encode a surrogate */
+    if (b < 0xF0) return 3;
+    if (b == 0xF0) return 11;
+    if (b < 0xF4) return 6;
+    if (b == 0xF4) return 5;
+    return 8;                                   /* above U+10FFFF */
+}
+
+/**
+ *  \brief Next state of the decoder.
+ */
+static int transition(int state, int cls){
+    bool cont = (cls == 1 || cls == 9 || cls == 7);
+
+    switch (state) {
+        case ACCEPT:
+            switch (cls) {
+                case 0: return ACCEPT;
+                case 2: return NEED1;
+                case 3: return NEED2;
+                case 10: return NEED2_E0;
+                case 4: return NEED2_ED;
+                case 6: return NEED3;
+                case 11: return NEED3_F0;
+                case 5: return NEED3_F4;
+                default: return REJECT;
+            }
+        case NEED1: return cont ? ACCEPT : REJECT;
+        case NEED2: return cont ? NEED1 : REJECT;
+        case NEED3: return cont ? NEED2 : REJECT;
+        case NEED2_E0: return (cls == 7) ? NEED1 : REJECT;
+        case NEED2_ED: return (cls == 1 || cls == 9) ? NEED1 : REJECT;
+        case NEED3_F0: return (cls == 9 || cls == 7) ? NEED2 : REJECT;
+        case NEED3_F4: return (cls == 1) ? NEED2 : REJECT;
+        default: return REJECT;
+    }
+}
+
+/**
+ *  \brief Original rule telling if a code point is a letter, digit or underscore.
+ */
+static bool isWord(int c){
+    if (c >= 0xE0) c -= 0x20;  // upper case
+
+    // a-z A-Z
+    return ((0x41 <= c && c <= 0x5A) || (0x61 <= c && c <= 0x7A)) ||
+        // cedilla (Ç), underscore (_)
+        c == 0xC7 || c == 0x5F ||
+        // ÀÁÂÃ ÈÉÊ ÌÍ
+        (0xC0 <= c && c <= 0xC3) || (0xC8 <= c && c <= 0xCA) || (0xCC <= c && c <= 0xCD) ||
+        // ÒÓÔÕ ÙÚ
+        (0xD2 <= c && c <= 0xD5) || (0xD9 <= c && c <= 0xDA) ||
+        // 0 1 2 3 4 5 6 7 8 9
+        (0x30 <= c && c <= 0x39);
+}
+
+/**
+ *  \brief Original rule giving the vowel id of a code point (0 if it is not a vowel).
+ */
+static int vowelId(int c){
+    if (c >= 0xE0) c -= 0x20;  // upper case
+
+    if (c == 0x61 || c == 0x41 || (0xC0 <= c && c <= 0xC3)) return 1;   // a ou AÀÁÂÃ
+    if (c == 0x65 || c == 0x45 || (0xC8 <= c && c <= 0xCA)) return 2;   // e ou EÈÉÊ
+    if (c == 0x69 || c == 0x49 || (0xCC <= c && c <= 0xCD)) return 3;   // i ou IÌÍ
+    if (c == 0x6F || c == 0x4F || (0xD2 <= c && c <= 0xD5)) return 4;   // o ou OÒÓÔÕ
+    if (c == 0x75 || c == 0x55 || (0xD9 <= c && c <= 0xDA)) return 5;   // u ou UÙÚ
+    if (c == 0x79 || c == 0x59) return 6;                               // y ou Y
+    return 0;
+}
+
+/**
+ *  \brief Print a table as a C array definition.
+ */
+static void printTable(const char *name, const unsigned char *table, int size){
+    printf("const unsigned char %s[%d] = {\n", name, size);
+    for (int i = 0; i < size; i++) {
+        printf("%s%3d%s", (i % 16 == 0) ? "    " : "", table[i], (i == size - 1) ? "\n" : (i % 16 == 15) ? ",\n" : ", ");
+    }
+    printf("};\n\n");
+}
+
+int main(void){
+    unsigned char classes[256];
+    unsigned char transitions[N_STATES * N_BYTE_CLASSES];
+    unsigned char chars[256];
+
+    if (N_STATES * N_BYTE_CLASSES != sizeof(utf8Transition) || REJECT * N_BYTE_CLASSES != UTF8_REJECT) {
+        fprintf(stderr, "genCharTables: charTables.h does not match the generated tables\n");
+        return EXIT_FAILURE;
+    }
+
+    for (int b = 0; b < 256; b++) {
+        classes[b] = byteClass(b);
+    }
+    for (int s = 0; s < N_STATES; s++) {
+        for (int cls = 0; cls < N_BYTE_CLASSES; cls++) {
+            transitions[s * N_BYTE_CLASSES + cls] = transition(s, cls) * N_BYTE_CLASSES;
+        }
+    }
+    for (int c = 0; c < 256; c++) {
+        chars[c] = (isWord(c) ? CHAR_WORD : 0) | (c == 0x27 ? CHAR_APOSTROPHE : 0) | (isWord(c) ? vowelId(c) : 0);
+    }
+
+    printf("/* Generated by genCharTables, do not edit. */\n\n");
+    printf("#include \"charTables.h\"\n\n");
+    printTable("utf8ByteClass", classes, 256);
+    printTable("utf8Transition", transitions, N_STATES * N_BYTE_CLASSES);
+    printTable("charClassTable", chars, 256);
+
+    return EXIT_SUCCESS;
+}
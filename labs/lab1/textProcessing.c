@@ -4,83 +4,31 @@
 #include <stdbool.h>
 #include <string.h>
 
-char is_vowel(int c){
-    if (c >= 0xE0)  // 0xE0 -> à => if is bigger then 0xE0 it will convert the character in unicode to its uppercase equivalent 
-        c = c - 0x20;  // upper case
-    // a ou AÀÁÂÃ
-    if ( c == 0x41 || (0xC0 <= c && c <= 0xC3))
-        return 'A'; 
-    
-    // e ou EÈÉÊ
-    if (c == 0x45 || (0xC8 <= c && c <= 0xCA))
-        return 'E'; 
-
-    // i ou IÌÍ
-    if ( c == 0x49 || (0xCC <= c && c <= 0xCD))
-        return 'I'; 
-    
-    // o ou OÒÓÔÕ
-    if ( c == 0x4F || (0xD2 <= c && c <= 0xD5))
-        return 'O'; 
-    
-    // u ou UÙÚ
-    if ( c == 0x55 || (0xD9 <= c && c <= 0xDA))
-        return 'U';
-
-    // y ou Y
-    if (c == 0x79 || c == 0x59)
-        return 'Y';
-    
-    return 'n';
-}
-
-int is_alpha_numeric(int c, bool inWord){
-    if (c >= 0xE0) c -= 0x20;  // upper case
-
-    if (c == 0x1FF9 || c == 0x1FF8) c = 0x27;  // convert single quotation marks to apostrophe
-
-    if (c == 0x27 && inWord == false)   // if an apostrophe is alone then is not considered to be counted as a word
-        return false;
-
-    // a-z A-Z
-    return ((0x41 <= c && c <= 0x5A) || (0x61 <= c && c <= 0x7A)) || 
-        // apostrophe ('), cedilla (Ç), underscore (_)
-        c == 0x27 || c == 0xC7 || c == 0x5F ||
-        // ÀÁÂÃ ÈÉÊ ÌÍ
-        (0xC0 <= c && c <= 0xC3) || (0xC8 <= c && c <= 0xCA) || (0xCC <= c && c <= 0xCD) ||
-        // ÒÓÔÕ ÙÚ
-        (0xD2 <= c && c <= 0xD5) || (0xD9 <= c && c <= 0xDA) ||
-        // 1 2 3 4 5 6 7 8 9
-        (0x30 <= c && c <= 0x39);
-}
-
+#include "charTables.h"
+
+/**
+ *  \brief Reads the next character of the file with the table driven utf-8 decoder.
+ *
+ *  Invalid byte sequences are skipped.
+ *
+ *  \return the Unicode code point of the character or EOF
+ */
 int f_getc(FILE *fp) {
-	// reads the first byte 
-	int bytes, ch = fgetc(fp);
-	// if the first byte is EOF, returns EOF
-	if (ch == EOF) return EOF;
-
-	// if the first byte is a single-byte character
-	// returns that byte as the Unicode code point
-	if ((ch & 0x80) == 0) return ch;
+	unsigned int state = UTF8_ACCEPT, codepoint = 0;
+	int ch;
 
-	// determine the size of the utf-8 character sequence
-	// bytes will increment if (ch & (0x80 >> bytes)) is not 0
-	for (bytes = 1; ch & (0x80 >> bytes); bytes++);
+	while ((ch = fgetc(fp)) != EOF) {
+		unsigned int previous = state;
 
-	// extracting the most significant bits of the first byte of the sequence
-	ch &= (1 << (7 - bytes)) - 1;
+		if (utf8_decode(&state, &codepoint, ch) == UTF8_ACCEPT) return codepoint;
 
-	// combining the first byte with the subsequent sequence
-	for (; bytes > 1; bytes--) {
-		// reading the next byte 
-		int c = fgetc(fp);
-		// returning EOF to indicate an error has ocurred
-		if (c == EOF) return EOF;
-		// combining c with ch 
-		ch = (ch << 6) | (c & 0x3F);
+		if (state == UTF8_REJECT) {
+			state = UTF8_ACCEPT;
+			// a truncated sequence does not swallow the byte that interrupted it
+			if (previous != UTF8_ACCEPT) ungetc(ch, fp);
+		}
 	}
-	return ch;
+	return EOF;
 }
 
 int main(int argc, char *argv[]) {
@@ -88,8 +36,8 @@ int main(int argc, char *argv[]) {
         int words = 0; int as = 0; int es = 0; int is = 0; int os = 0; int us = 0; int ys = 0;
         int previousVowelCheck[6] = {0,0,0,0,0,0};
         bool inWord = false;
-        int byte, lbyte;
-        char vowel;
+        int byte;
+        int vowel;
         FILE *fp;
 
         fp = fopen(argv[i], "rb");
@@ -103,33 +51,34 @@ int main(int argc, char *argv[]) {
 
         while (1){
             while (EOF != (byte = f_getc(fp))){
-                if (is_alpha_numeric(byte, inWord)){
+                unsigned char cls = char_class(byte);
+                if ((cls & CHAR_WORD) || ((cls & CHAR_APOSTROPHE) && inWord)){
                     if (inWord == false){
                         inWord = true;
                         words++;
                     }
-                    vowel = is_vowel(byte);
-                    if (vowel == 'A' && previousVowelCheck[0] == 0){
+                    vowel = cls & CHAR_VOWEL;
+                    if (vowel == 1 && previousVowelCheck[0] == 0){
                         as++;
                         previousVowelCheck[0] = 1;
                     }
-                    else if (vowel == 'E' && previousVowelCheck[1] == 0){
+                    else if (vowel == 2 && previousVowelCheck[1] == 0){
                         es++;
                         previousVowelCheck[1] = 1;
                     }
-                    else if (vowel == 'I' && previousVowelCheck[2] == 0){
+                    else if (vowel == 3 && previousVowelCheck[2] == 0){
                         is++;
                         previousVowelCheck[2] = 1;
                     }
-                    else if (vowel == 'O' && previousVowelCheck[3] == 0){
+                    else if (vowel == 4 && previousVowelCheck[3] == 0){
                         os++;
                         previousVowelCheck[3] = 1;
                     }
-                    else if (vowel == 'U' && previousVowelCheck[4] == 0){
+                    else if (vowel == 5 && previousVowelCheck[4] == 0){
                         us++;
                         previousVowelCheck[4] = 1;
                     }
-                    else if (vowel == 'Y' && previousVowelCheck[5] == 0){
+                    else if (vowel == 6 && previousVowelCheck[5] == 0){
                         ys++;
                         previousVowelCheck[5] = 1;
                     }